@@ -0,0 +1,238 @@
+#include "chunked.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "half_float.h"
+#include "program_cache.h"
+
+namespace {
+
+const int POOL_SLOTS = 3;   // A/B panel pairs in flight
+const int TILE_ALIGN = 64;  // tiles stay multiples of every variant's block size
+
+using Clock = std::chrono::high_resolution_clock;
+
+int roundUp(int x, int a) {
+    return (x + a - 1) / a * a;
+}
+
+size_t elementSize(const KernelVariant& v) {
+    return v.halfStorage ? sizeof(uint16_t) : sizeof(float);
+}
+
+size_t panelBytesA(const KernelVariant& v, const ChunkTile& t) { return (size_t)t.M * t.K * elementSize(v); }
+size_t panelBytesB(const KernelVariant& v, const ChunkTile& t) { return (size_t)t.K * t.N * elementSize(v); }
+size_t blockBytesC(const ChunkTile& t) { return (size_t)t.M * t.N * sizeof(float); }
+
+size_t poolBytes(const KernelVariant& v, const ChunkTile& t) {
+    return POOL_SLOTS * (panelBytesA(v, t) + panelBytesB(v, t)) + 2 * blockBytesC(t);
+}
+
+GLint64 maxShaderStorageBlock() {
+    GLint64 size = 0;
+    glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &size);
+    return size;
+}
+
+// Returns the ms spent blocked, or -1 if the wait failed
+double waitFence(GLsync& fence) {
+    auto start = Clock::now();
+    GLenum status;
+    do {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    } while (status == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(fence);
+    fence = 0;
+    if (status == GL_WAIT_FAILED) return -1;
+    std::chrono::duration<double, std::milli> d = Clock::now() - start;
+    return d.count();
+}
+
+// Copy rows [r0, r0 + rows) x columns [c0, c0 + cols) of a row-major matrix
+// with `stride` columns into a zero-padded tileRows x tileCols panel
+void packPanel(const float* src, int stride, int r0, int rows, int c0, int cols,
+               int tileRows, int tileCols, bool half, void* dst) {
+    for (int r = 0; r < tileRows; r++) {
+        int valid = r < rows ? cols : 0;
+        const float* row = src + (size_t)(r0 + r) * stride + c0;
+        if (half) {
+            uint16_t* out = (uint16_t*)dst + (size_t)r * tileCols;
+            floatToHalf(row, out, valid);
+            memset(out + valid, 0, (tileCols - valid) * sizeof(uint16_t));
+        } else {
+            float* out = (float*)dst + (size_t)r * tileCols;
+            memcpy(out, row, valid * sizeof(float));
+            memset(out + valid, 0, (tileCols - valid) * sizeof(float));
+        }
+    }
+}
+
+// Map `buffer` for an unsynchronized overwrite; the caller has waited on its fence
+void* mapForWrite(GLuint buffer, size_t bytes) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    return glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bytes,
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+} // namespace
+
+bool chunkedSupported(const KernelVariant& v, std::string* why) {
+    if (!v.bFromTexture) return true;
+    if (why) *why = "texture variants are not supported in chunked mode";
+    return false;
+}
+
+bool fitsShaderStorageBlock(const KernelVariant& v, const Shape& s) {
+    GLint64 limit = maxShaderStorageBlock();
+    return (GLint64)(std::max(s.sizeA(), s.sizeB()) * elementSize(v)) <= limit &&
+           (GLint64)(s.sizeC() * sizeof(float)) <= limit;
+}
+
+ChunkTile chooseChunkTile(const KernelVariant& v, const Shape& s, int requested, size_t budgetBytes) {
+    auto clampTile = [&](int t) {
+        return ChunkTile{ std::min(t, roundUp(s.M, TILE_ALIGN)), std::min(t, roundUp(s.N, TILE_ALIGN)),
+                          std::min(t, roundUp(s.K, TILE_ALIGN)) };
+    };
+    if (requested > 0) return clampTile(roundUp(requested, TILE_ALIGN));
+
+    const GLint64 limit = maxShaderStorageBlock();
+    int t = roundUp(std::max(s.M, std::max(s.N, s.K)), TILE_ALIGN);
+    for (; t > TILE_ALIGN; t -= TILE_ALIGN) {
+        ChunkTile c = clampTile(t);
+        bool fitsBlock = (GLint64)std::max(std::max(panelBytesA(v, c), panelBytesB(v, c)), blockBytesC(c)) <= limit;
+        if (fitsBlock && poolBytes(v, c) <= budgetBytes) break;
+    }
+    return clampTile(t);
+}
+
+ChunkedResult runChunked(const KernelVariant& v, const Shape& s, const Specialization& sp,
+                         const ChunkTile& tile, const std::vector<float>& A,
+                         const std::vector<float>& B, std::vector<float>& C, ProgramCache& cache) {
+    ChunkedResult r = { tile, 0, 0, 0.0, 0.0, poolBytes(v, tile), 0, false };
+
+    // Every dispatch sees the padded tile shape; only the first K-chunk overwrites C
+    const Shape ts = { tile.M, tile.N, tile.K };
+    Specialization overwrite = sp, accumulate = sp;
+    overwrite.accumulate = false;
+    accumulate.accumulate = true;
+    GemmKernel first, rest;
+    if (!buildGemmKernel(v, ts, overwrite, cache, first) || !buildGemmKernel(v, ts, accumulate, cache, rest)) {
+        return r;
+    }
+
+    const size_t bytesA = panelBytesA(v, tile), bytesB = panelBytesB(v, tile), bytesC = blockBytesC(tile);
+    struct Slot { GLuint a, b; GLsync fence; } slots[POOL_SLOTS];
+    struct Block { GLuint c; GLsync fence; int row0, col0; } blocks[2];
+    for (Slot& slot : slots) {
+        GLuint buf[2];
+        glGenBuffers(2, buf);
+        slot = { buf[0], buf[1], 0 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.a);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytesA, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.b);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytesB, NULL, GL_STREAM_DRAW);
+    }
+    for (Block& block : blocks) {
+        block = { 0, 0, 0, 0 };
+        glGenBuffers(1, &block.c);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, block.c);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytesC, NULL, GL_STREAM_READ);
+    }
+
+    // Copy the valid part of a finished C block into the host matrix
+    auto readBack = [&](Block& block) {
+        double w = waitFence(block.fence);
+        if (w < 0) return false;
+        r.fenceWaitMs += w;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, block.c);
+        const float* ptr = (const float*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bytesC, GL_MAP_READ_BIT);
+        if (!ptr) return false;
+        int rows = std::min(tile.M, s.M - block.row0), cols = std::min(tile.N, s.N - block.col0);
+        for (int row = 0; row < rows; row++) {
+            memcpy(&C[(size_t)(block.row0 + row) * s.N + block.col0], ptr + (size_t)row * tile.N,
+                   cols * sizeof(float));
+        }
+        return glUnmapBuffer(GL_SHADER_STORAGE_BUFFER) == GL_TRUE;
+    };
+
+    const int blocksN = (s.N + tile.N - 1) / tile.N;
+    const int chunksK = (s.K + tile.K - 1) / tile.K;
+    r.blocks = ((s.M + tile.M - 1) / tile.M) * blocksN;
+
+    // Drivers may compile on first dispatch; keep that out of the timing.
+    // The panels hold garbage, but the first K-chunk of every block overwrites C.
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, slots[0].a);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, slots[0].b);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, blocks[0].c);
+    first.dispatch();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    rest.dispatch();
+    glFinish();
+
+    bool ok = true;
+    int step = 0;
+    auto start = Clock::now();
+    for (int b = 0; b < r.blocks && ok; b++) {
+        // This buffer last held block b-2, which was read back in iteration b-1
+        Block& block = blocks[b % 2];
+        block.row0 = (b / blocksN) * tile.M;
+        block.col0 = (b % blocksN) * tile.N;
+
+        for (int kc = 0; kc < chunksK && ok; kc++, step++) {
+            Slot& slot = slots[step % POOL_SLOTS];
+            if (slot.fence) {
+                double w = waitFence(slot.fence);
+                if (w < 0) { ok = false; break; }
+                r.fenceWaitMs += w;
+            }
+
+            int k0 = kc * tile.K, kValid = std::min(tile.K, s.K - k0);
+            void* pa = mapForWrite(slot.a, bytesA);
+            if (pa) packPanel(A.data(), s.K, block.row0, std::min(tile.M, s.M - block.row0), k0, kValid,
+                              tile.M, tile.K, v.halfStorage, pa);
+            ok = pa && glUnmapBuffer(GL_SHADER_STORAGE_BUFFER) == GL_TRUE;
+            void* pb = ok ? mapForWrite(slot.b, bytesB) : nullptr;
+            if (pb) packPanel(B.data(), s.N, k0, kValid, block.col0, std::min(tile.N, s.N - block.col0),
+                              tile.K, tile.N, v.halfStorage, pb);
+            ok = ok && pb && glUnmapBuffer(GL_SHADER_STORAGE_BUFFER) == GL_TRUE;
+            if (!ok) break;
+
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, slot.a);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, slot.b);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, block.c);
+            (kc == 0 ? first : rest).dispatch();
+            // The next chunk reads back what this one accumulated into C
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            r.dispatches++;
+            r.uploadBytes += bytesA + bytesB;
+        }
+        if (!ok) break;
+
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        block.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // Overlap: block b computes while block b-1 is copied out
+        if (b > 0) ok = readBack(blocks[(b - 1) % 2]);
+    }
+    if (ok && r.blocks > 0) ok = readBack(blocks[(r.blocks - 1) % 2]);
+    if (!ok) std::cerr << "Error: chunked " << v.name << " failed to map or wait" << std::endl;
+
+    std::chrono::duration<double> d = Clock::now() - start;
+    r.seconds = d.count();
+    r.ok = ok;
+
+    for (Slot& slot : slots) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.a);
+        glDeleteBuffers(1, &slot.b);
+    }
+    for (Block& block : blocks) {
+        if (block.fence) glDeleteSync(block.fence);
+        glDeleteBuffers(1, &block.c);
+    }
+    return r;
+}
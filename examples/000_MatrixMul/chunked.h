@@ -0,0 +1,53 @@
+#ifndef CHUNKED_H
+#define CHUNKED_H
+
+#include <string>
+#include <vector>
+
+#include "variants.h"
+
+class ProgramCache;
+
+// Chunked execution for problems whose full A, B and C do not fit in one
+// SSBO (GL_MAX_SHADER_STORAGE_BLOCK_SIZE) or in the GPU's share of memory.
+//
+// C is tiled into tileM x tileN blocks. For each block, the matching A row
+// panel and B column panel are streamed through a small pool of buffers one
+// tileK-wide chunk at a time, and the kernel (built with ACCUMULATE for all
+// but the first chunk) adds into the block's C buffer. Edge panels are
+// zero-padded so every dispatch runs the same specialized program.
+//
+// Pool slots are guarded by fences: the CPU packs chunk i+1 (unsynchronized
+// map) while the GPU computes chunk i, and block b-1 is read back while
+// block b computes.
+
+struct ChunkTile {
+    int M, N, K;
+};
+
+struct ChunkedResult {
+    ChunkTile tile;
+    int blocks;           // C blocks
+    int dispatches;       // blocks x K-chunks
+    double seconds;
+    double fenceWaitMs;   // time the CPU spent blocked on pool or C fences
+    size_t gpuBytes;      // buffer memory held at once
+    size_t uploadBytes;   // A and B panel bytes streamed, including padding
+    bool ok;
+};
+
+// Whether the variant can run chunked (texture variants cannot); `why` gets the reason
+bool chunkedSupported(const KernelVariant& v, std::string* why = nullptr);
+
+// Whether plain A, B and C buffers of this shape fit in one SSBO each
+bool fitsShaderStorageBlock(const KernelVariant& v, const Shape& s);
+
+// Largest tile (multiple of 64, at most `requested` if non-zero) whose pool
+// fits in `budgetBytes` and whose panels fit in one SSBO, clamped to the shape
+ChunkTile chooseChunkTile(const KernelVariant& v, const Shape& s, int requested, size_t budgetBytes);
+
+ChunkedResult runChunked(const KernelVariant& v, const Shape& s, const Specialization& sp,
+                         const ChunkTile& tile, const std::vector<float>& A,
+                         const std::vector<float>& B, std::vector<float>& C, ProgramCache& cache);
+
+#endif // CHUNKED_H
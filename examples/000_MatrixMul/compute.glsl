@@ -1,10 +1,13 @@
 #version 430 core
 
-// Launch 32x32 threads per group (1024 threads total per group)
-layout(local_size_x = 32, local_size_y = 32, local_size_z = 1) in;
+// Problem shape and tuning are injected by the host as #defines (see
+// variants.cpp), so the compiler can constant-fold indexing and unroll:
+//   M, N, K           C (M x N) = A (M x K) * B (K x N), all row-major
+//   LOCAL_X, LOCAL_Y  workgroup size (32x32 by default)
+//   UNROLL            K-loop unroll factor
+//   ACCUMULATE        C += A * B, for K split across dispatches (chunked mode)
 
- // Matrix Dimensions (passed as a uniform)
-uniform int WIDTH;
+layout(local_size_x = LOCAL_X, local_size_y = LOCAL_Y, local_size_z = 1) in;
 
 // Input Buffer A
 layout(std430, binding = 0) buffer BufferA {
@@ -26,16 +29,27 @@ layout(std430, binding = 2) buffer BufferC {
     uint col = gl_GlobalInvocationID.x;
     uint row = gl_GlobalInvocationID.y;
 
-    if (col >= WIDTH || row >= WIDTH) return;
+    // Guard the partial workgroups at the right and bottom edges
+    if (col >= N || row >= M) return;
 
     float sum = 0.0;
     
     // Dot product of Row A and Column B
-    for (int k = 0; k < WIDTH; k++) {
-        // A is Row-Major: A[row * WIDTH + k]
-        // B is Row-Major: B[k * WIDTH + col]
-        sum += A[row * WIDTH + k] * B[k * WIDTH + col];
+    // A is Row-Major: A[row * K + k]
+    // B is Row-Major: B[k * N + col]
+    int k = 0;
+    for (; k + UNROLL <= K; k += UNROLL) {
+        for (int u = 0; u < UNROLL; u++) {
+            sum += A[row * K + k + u] * B[(k + u) * N + col];
+        }
+    }
+    for (; k < K; k++) {
+        sum += A[row * K + k] * B[k * N + col];
     }
 
-    C[row * WIDTH + col] = sum;
+#ifdef ACCUMULATE
+    C[row * N + col] += sum;
+#else
+    C[row * N + col] = sum;
+#endif
 }
@@ -0,0 +1,85 @@
+#version 430 core
+
+// Register-blocked variant.
+// Each invocation computes a ROWS x 4 block of C held in vec4 registers.
+// Every B vector fetched is reused ROWS times and every A vector 4 times.
+// Shape defines as in compute.glsl; N and K must be multiples of 4.
+//
+// Variant defines:
+//   ROWS            rows of C per invocation (4 or 8)
+//   B_FROM_TEXTURE  read B through an RGBA32F texture (N/4 x K)
+//                   so loads go through the texture cache
+//   HALF_STORAGE    A and B hold fp16 pairs packed with packHalf2x16,
+//                   halving the bytes moved; accumulation stays fp32
+
+#define N4 (N / 4)
+#define K4 (K / 4)
+
+layout(local_size_x = LOCAL_X, local_size_y = LOCAL_Y, local_size_z = 1) in;
+
+#ifdef HALF_STORAGE
+#define VEC4_STORAGE uvec2
+vec4 unpackHalf4(uvec2 p) { return vec4(unpackHalf2x16(p.x), unpackHalf2x16(p.y)); }
+#else
+#define VEC4_STORAGE vec4
+#define unpackHalf4(v) (v)
+#endif
+
+layout(std430, binding = 0) buffer BufferA {
+    VEC4_STORAGE A[];
+};
+
+#ifdef B_FROM_TEXTURE
+layout(binding = 0) uniform sampler2D texB;
+#define LOAD_B(k, c4) texelFetch(texB, ivec2(c4, k), 0)
+#else
+layout(std430, binding = 1) buffer BufferB {
+    VEC4_STORAGE B[];
+};
+#define LOAD_B(k, c4) unpackHalf4(B[(k) * N4 + (c4)])
+#endif
+
+layout(std430, binding = 2) buffer BufferC {
+    vec4 C[];
+};
+
+vec4 acc[ROWS];
+
+void step(int c4, int row0, int k4) {
+    int k = k4 * 4;
+    vec4 b0 = LOAD_B(k + 0, c4);
+    vec4 b1 = LOAD_B(k + 1, c4);
+    vec4 b2 = LOAD_B(k + 2, c4);
+    vec4 b3 = LOAD_B(k + 3, c4);
+
+    for (int i = 0; i < ROWS; i++) {
+        // Clamp instead of branching; out-of-range rows are never stored
+        int r = min(row0 + i, M - 1);
+        vec4 a = unpackHalf4(A[r * K4 + k4]);
+        acc[i] += a.x * b0 + a.y * b1 + a.z * b2 + a.w * b3;
+    }
+}
+
+void main() {
+    int c4 = int(gl_GlobalInvocationID.x);
+    int row0 = int(gl_GlobalInvocationID.y) * ROWS;
+
+    if (c4 >= N4 || row0 >= M) return;
+
+    for (int i = 0; i < ROWS; i++) acc[i] = vec4(0.0);
+
+    int k4 = 0;
+    for (; k4 + UNROLL <= K4; k4 += UNROLL) {
+        for (int u = 0; u < UNROLL; u++) step(c4, row0, k4 + u);
+    }
+    for (; k4 < K4; k4++) step(c4, row0, k4);
+
+    for (int i = 0; i < ROWS; i++) {
+        if (row0 + i >= M) break;
+#ifdef ACCUMULATE
+        C[(row0 + i) * N4 + c4] += acc[i];
+#else
+        C[(row0 + i) * N4 + c4] = acc[i];
+#endif
+    }
+}
@@ -0,0 +1,59 @@
+#version 430 core
+
+// Shared-memory tiled variant.
+// Each TILE x TILE workgroup stages one block of A and B in shared memory
+// per step, so every global element is loaded once per workgroup instead
+// of once per invocation. Shape defines as in compute.glsl; the tile size
+// is the (square) workgroup size.
+
+#define TILE LOCAL_X
+
+layout(local_size_x = TILE, local_size_y = TILE, local_size_z = 1) in;
+
+layout(std430, binding = 0) buffer BufferA {
+    float A[];
+};
+
+layout(std430, binding = 1) buffer BufferB {
+    float B[];
+};
+
+layout(std430, binding = 2) buffer BufferC {
+    float C[];
+};
+
+shared float tileA[TILE][TILE];
+shared float tileB[TILE][TILE];
+
+void main() {
+    uint lx = gl_LocalInvocationID.x;
+    uint ly = gl_LocalInvocationID.y;
+    uint col = gl_GlobalInvocationID.x;
+    uint row = gl_GlobalInvocationID.y;
+
+    // No early return here: every invocation must reach barrier()
+    float sum = 0.0;
+
+    for (int t = 0; t < K; t += TILE) {
+        // Cooperative load, zero-padded at the matrix edges
+        uint ak = t + lx;
+        uint bk = t + ly;
+        tileA[ly][lx] = (row < M && ak < K) ? A[row * K + ak] : 0.0;
+        tileB[ly][lx] = (bk < K && col < N) ? B[bk * N + col] : 0.0;
+        barrier();
+
+        // Constant trip count: the compiler unrolls this without UNROLL
+        for (int k = 0; k < TILE; k++) {
+            sum += tileA[ly][k] * tileB[k][lx];
+        }
+        barrier();
+    }
+
+    if (col < N && row < M) {
+#ifdef ACCUMULATE
+        C[row * N + col] += sum;
+#else
+        C[row * N + col] = sum;
+#endif
+    }
+}
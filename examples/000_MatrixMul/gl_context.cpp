@@ -0,0 +1,341 @@
+#include "gl_context.h"
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef GPGPU_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef GPGPU_HAVE_GBM
+#include <gbm.h>
+#endif
+
+#ifdef GPGPU_HAVE_GLFW
+#include <GLFW/glfw3.h>
+#endif
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#ifndef EGL_PLATFORM_GBM_KHR
+#define EGL_PLATFORM_GBM_KHR 0x31D7
+#endif
+
+bool parseContextBackend(const char* name, ContextBackend& out) {
+    if (strcmp(name, "auto") == 0) out = ContextBackend::Auto;
+    else if (strcmp(name, "surfaceless") == 0) out = ContextBackend::EglSurfaceless;
+    else if (strcmp(name, "gbm") == 0) out = ContextBackend::EglGbm;
+    else if (strcmp(name, "glfw") == 0) out = ContextBackend::Glfw;
+    else return false;
+    return true;
+}
+
+// ============================================================================
+// EGL (headless)
+// ============================================================================
+
+#ifdef GPGPU_HAVE_EGL
+
+namespace {
+
+struct EglState {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+    int drmFd = -1;
+#ifdef GPGPU_HAVE_GBM
+    gbm_device* gbm = nullptr;
+#endif
+};
+
+bool hasExtension(const char* list, const char* name) {
+    if (!list) return false;
+    size_t len = strlen(name);
+    for (const char* p = list; (p = strstr(p, name)) != nullptr; p += len) {
+        if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) return true;
+    }
+    return false;
+}
+
+void destroyEgl(EglState* s) {
+    if (s->display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(s->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (s->surface != EGL_NO_SURFACE) eglDestroySurface(s->display, s->surface);
+        if (s->context != EGL_NO_CONTEXT) eglDestroyContext(s->display, s->context);
+        eglTerminate(s->display);
+    }
+#ifdef GPGPU_HAVE_GBM
+    if (s->gbm) gbm_device_destroy(s->gbm);
+#endif
+    if (s->drmFd >= 0) close(s->drmFd);
+    delete s;
+}
+
+// Open the first DRM render node that gives us a GBM device
+bool openGbmDisplay(EglState* s, PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay) {
+#ifdef GPGPU_HAVE_GBM
+    for (int minor = 128; minor < 136; minor++) {
+        std::string path = "/dev/dri/renderD" + std::to_string(minor);
+        int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) continue;
+        gbm_device* gbm = gbm_create_device(fd);
+        if (!gbm) {
+            close(fd);
+            continue;
+        }
+        s->drmFd = fd;
+        s->gbm = gbm;
+        s->display = getPlatformDisplay(EGL_PLATFORM_GBM_KHR, gbm, NULL);
+        return s->display != EGL_NO_DISPLAY;
+    }
+    std::cerr << "EGL: no usable /dev/dri/renderD* node" << std::endl;
+    return false;
+#else
+    (void)s; (void)getPlatformDisplay;
+    std::cerr << "EGL: built without GBM support" << std::endl;
+    return false;
+#endif
+}
+
+bool createEgl(ContextBackend backend, const ContextRequest& req, EglState* s) {
+    const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!getPlatformDisplay || !hasExtension(clientExts, "EGL_EXT_platform_base")) {
+        std::cerr << "EGL: EGL_EXT_platform_base not supported" << std::endl;
+        return false;
+    }
+
+    if (backend == ContextBackend::EglSurfaceless) {
+        if (!hasExtension(clientExts, "EGL_MESA_platform_surfaceless")) {
+            std::cerr << "EGL: EGL_MESA_platform_surfaceless not supported" << std::endl;
+            return false;
+        }
+        s->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    } else if (!openGbmDisplay(s, getPlatformDisplay)) {
+        return false;
+    }
+
+    EGLint major, minor;
+    if (s->display == EGL_NO_DISPLAY || !eglInitialize(s->display, &major, &minor)) {
+        std::cerr << "EGL: eglInitialize failed (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return false;
+    }
+
+    if (!eglBindAPI(req.gles ? EGL_OPENGL_ES_API : EGL_OPENGL_API)) {
+        std::cerr << "EGL: requested client API not available" << std::endl;
+        return false;
+    }
+
+    // No surface is ever rendered to; a config is only needed when the
+    // driver lacks EGL_KHR_no_config_context or surfaceless contexts.
+    const char* exts = eglQueryString(s->display, EGL_EXTENSIONS);
+    bool surfaceless = hasExtension(exts, "EGL_KHR_surfaceless_context");
+    EGLConfig config = (EGLConfig)0;
+    if (!surfaceless || !hasExtension(exts, "EGL_KHR_no_config_context")) {
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, req.gles ? EGL_OPENGL_ES2_BIT : EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLint count = 0;
+        if (!eglChooseConfig(s->display, configAttribs, &config, 1, &count) || count == 0) {
+            std::cerr << "EGL: no matching config" << std::endl;
+            return false;
+        }
+    }
+
+    EGLint ctxAttribs[16];
+    int n = 0;
+    if (req.gles && req.major < 3) {
+        ctxAttribs[n++] = EGL_CONTEXT_CLIENT_VERSION; ctxAttribs[n++] = req.major;
+    } else {
+        ctxAttribs[n++] = EGL_CONTEXT_MAJOR_VERSION_KHR; ctxAttribs[n++] = req.major;
+        ctxAttribs[n++] = EGL_CONTEXT_MINOR_VERSION_KHR; ctxAttribs[n++] = req.minor;
+        if (!req.gles) {
+            ctxAttribs[n++] = EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR;
+            ctxAttribs[n++] = EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR;
+        }
+    }
+    ctxAttribs[n] = EGL_NONE;
+
+    s->context = eglCreateContext(s->display, config, EGL_NO_CONTEXT, ctxAttribs);
+    if (s->context == EGL_NO_CONTEXT) {
+        std::cerr << "EGL: eglCreateContext failed for " << (req.gles ? "OpenGL ES " : "OpenGL ")
+                  << req.major << "." << req.minor << " (0x" << std::hex << eglGetError() << std::dec << ")"
+                  << std::endl;
+        return false;
+    }
+
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        s->surface = eglCreatePbufferSurface(s->display, config, pbufferAttribs);
+        if (s->surface == EGL_NO_SURFACE) {
+            std::cerr << "EGL: eglCreatePbufferSurface failed" << std::endl;
+            return false;
+        }
+    }
+
+    if (!eglMakeCurrent(s->display, s->surface, s->surface, s->context)) {
+        std::cerr << "EGL: eglMakeCurrent failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+#endif // GPGPU_HAVE_EGL
+
+// ============================================================================
+// GLFW (hidden window fallback)
+// ============================================================================
+
+#ifdef GPGPU_HAVE_GLFW
+
+static void glfw_error_callback(int error, const char* description) {
+    std::cerr << "GLFW Error " << error << ": " << description << std::endl;
+}
+
+static GLFWwindow* createGlfw(const ContextRequest& req) {
+    glfwSetErrorCallback(glfw_error_callback);
+
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return nullptr;
+    }
+
+    // NOTE: Raspberry Pi 3B (VideoCore IV) does not natively support 4.3!
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, req.major);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, req.minor);
+    if (req.gles) {
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+    } else {
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(640, 480, "Hidden", NULL, NULL);
+    if (!window) {
+        std::cerr << "Failed to create GLFW window. Check your GPU drivers." << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+
+    glfwMakeContextCurrent(window);
+    return window;
+}
+
+#endif // GPGPU_HAVE_GLFW
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+// OpenGL ES 2.0 has framebuffer objects and shader precision queries in core,
+// but glad's desktop loader only resolves them for GL 3.0/4.1 or the ARB
+// extensions, which an ES context does not advertise. Always reload them so no
+// pointer from an earlier desktop context survives.
+static void loadGles2Entries(GLADloadproc loader) {
+    glad_glGenFramebuffers = (PFNGLGENFRAMEBUFFERSPROC)loader("glGenFramebuffers");
+    glad_glDeleteFramebuffers = (PFNGLDELETEFRAMEBUFFERSPROC)loader("glDeleteFramebuffers");
+    glad_glBindFramebuffer = (PFNGLBINDFRAMEBUFFERPROC)loader("glBindFramebuffer");
+    glad_glFramebufferTexture2D = (PFNGLFRAMEBUFFERTEXTURE2DPROC)loader("glFramebufferTexture2D");
+    glad_glCheckFramebufferStatus = (PFNGLCHECKFRAMEBUFFERSTATUSPROC)loader("glCheckFramebufferStatus");
+    glad_glGetShaderPrecisionFormat = (PFNGLGETSHADERPRECISIONFORMATPROC)loader("glGetShaderPrecisionFormat");
+}
+
+static bool tryBackend(ContextBackend backend, const ContextRequest& req, GLContext& ctx) {
+    auto start = std::chrono::high_resolution_clock::now();
+    GLADloadproc loader = nullptr;
+    (void)req;  // unused when built without any backend
+
+    switch (backend) {
+        case ContextBackend::EglSurfaceless:
+        case ContextBackend::EglGbm: {
+#ifdef GPGPU_HAVE_EGL
+            EglState* s = new EglState();
+            if (!createEgl(backend, req, s)) {
+                destroyEgl(s);
+                return false;
+            }
+            ctx.native = s;
+            ctx.description = backend == ContextBackend::EglSurfaceless ? "EGL surfaceless" : "EGL GBM";
+            loader = (GLADloadproc)eglGetProcAddress;
+            break;
+#else
+            std::cerr << "Built without EGL support" << std::endl;
+            return false;
+#endif
+        }
+        case ContextBackend::Glfw: {
+#ifdef GPGPU_HAVE_GLFW
+            GLFWwindow* window = createGlfw(req);
+            if (!window) return false;
+            ctx.native = window;
+            ctx.description = "GLFW hidden window";
+            loader = (GLADloadproc)glfwGetProcAddress;
+            break;
+#else
+            std::cerr << "Built without GLFW support" << std::endl;
+            return false;
+#endif
+        }
+        default:
+            return false;
+    }
+    ctx.backend = backend;
+
+    if (!gladLoadGLLoader(loader)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        destroyGLContext(ctx);
+        return false;
+    }
+    if (req.gles) loadGles2Entries(loader);
+
+    std::chrono::duration<double, std::milli> ms = std::chrono::high_resolution_clock::now() - start;
+    ctx.createMs = ms.count();
+    return true;
+}
+
+bool createGLContext(ContextBackend backend, const ContextRequest& req, GLContext& ctx) {
+    ctx = GLContext{ backend, "", 0.0, nullptr };
+
+    if (backend != ContextBackend::Auto) return tryBackend(backend, req, ctx);
+
+    const ContextBackend order[] = {
+        ContextBackend::EglSurfaceless, ContextBackend::EglGbm, ContextBackend::Glfw
+    };
+    for (ContextBackend b : order) {
+        if (tryBackend(b, req, ctx)) return true;
+    }
+    std::cerr << "Failed to create an OpenGL context with any backend" << std::endl;
+    return false;
+}
+
+void destroyGLContext(GLContext& ctx) {
+    if (!ctx.native) return;
+    switch (ctx.backend) {
+#ifdef GPGPU_HAVE_EGL
+        case ContextBackend::EglSurfaceless:
+        case ContextBackend::EglGbm:
+            destroyEgl(static_cast<EglState*>(ctx.native));
+            break;
+#endif
+#ifdef GPGPU_HAVE_GLFW
+        case ContextBackend::Glfw:
+            glfwDestroyWindow(static_cast<GLFWwindow*>(ctx.native));
+            glfwTerminate();
+            break;
+#endif
+        default:
+            break;
+    }
+    ctx.native = nullptr;
+}
@@ -0,0 +1,38 @@
+#ifndef GL_CONTEXT_H
+#define GL_CONTEXT_H
+
+#include <string>
+
+// How the GL context is obtained. EGL paths need no window system, so they
+// work on headless nodes and in CI under Mesa's llvmpipe.
+enum class ContextBackend {
+    Auto,            // surfaceless, then GBM, then GLFW
+    EglSurfaceless,  // EGL_MESA_platform_surfaceless
+    EglGbm,          // GBM device on a DRM render node (/dev/dri/renderD*)
+    Glfw             // hidden GLFW window (needs X11/Wayland)
+};
+
+// Parse "auto", "surfaceless", "gbm" or "glfw". Returns false if unknown.
+bool parseContextBackend(const char* name, ContextBackend& out);
+
+// Requested client API and version
+struct ContextRequest {
+    int major;
+    int minor;
+    bool gles;  // OpenGL ES instead of desktop core profile
+};
+
+struct GLContext {
+    ContextBackend backend;  // backend that actually succeeded
+    std::string description; // e.g. "EGL surfaceless"
+    double createMs;         // time spent creating the context
+    void* native;            // backend-specific state
+};
+
+// Create a context, make it current and load GL entry points with glad.
+// Prints the reason and returns false on failure.
+bool createGLContext(ContextBackend backend, const ContextRequest& req, GLContext& ctx);
+
+void destroyGLContext(GLContext& ctx);
+
+#endif // GL_CONTEXT_H
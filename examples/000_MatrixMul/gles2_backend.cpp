@@ -0,0 +1,165 @@
+#include "gles2_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "shader_utils.h"
+
+namespace {
+
+const char* VERTEX_FILE = "gles2_quad.glsl";
+const char* FRAGMENT_FILE = "gles2_gemm.glsl";
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point& last) {
+    Clock::time_point now = Clock::now();
+    std::chrono::duration<double, std::milli> d = now - last;
+    last = now;
+    return d.count();
+}
+
+// NPOT textures are only complete in ES 2.0 with CLAMP_TO_EDGE and no mipmaps
+GLuint createFloatTexture(int width, int height, const float* data) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    return tex;
+}
+
+GLuint buildGemmProgram(const Shape& s, int chunk) {
+    std::string vs = loadShader(VERTEX_FILE);
+    std::string fs = loadShader(FRAGMENT_FILE);
+    if (vs.empty() || fs.empty()) {
+        std::cerr << "Error: " << (vs.empty() ? VERTEX_FILE : FRAGMENT_FILE) << " not found!" << std::endl;
+        return 0;
+    }
+    fs = injectDefines(fs, { "M " + std::to_string(s.M), "N " + std::to_string(s.N),
+                             "K " + std::to_string(s.K), "CHUNK " + std::to_string(chunk) });
+    return buildRenderProgram(vs, fs, "position");
+}
+
+} // namespace
+
+bool gles2Supports(const Shape& s, std::string* why) {
+    const char* reason = nullptr;
+
+    // The byte encoding needs full fp32 range and precision in the fragment shader
+    GLint range[2] = { 0, 0 }, precision = 0;
+    glGetShaderPrecisionFormat(GL_FRAGMENT_SHADER, GL_HIGH_FLOAT, range, &precision);
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+
+    if (s.M <= 0 || s.N <= 0 || s.K <= 0) reason = "empty shape";
+    else if (range[1] < 127 || precision < 23) reason = "no highp float in fragment shaders";
+    else if (std::max(s.M, std::max(s.N, s.K)) > maxSize) reason = "matrix larger than GL_MAX_TEXTURE_SIZE";
+
+    if (reason && why) *why = reason;
+    return reason == nullptr;
+}
+
+bool runGles2(const Shape& s, int chunk, const std::vector<float>& A, const std::vector<float>& B,
+              std::vector<float>& C, int warmup, int iterations, std::vector<PhaseSample>& samples,
+              ProgramBuildInfo& build) {
+    Clock::time_point t = Clock::now();
+    GLuint program = buildGemmProgram(s, chunk);
+    build = { false, false, msSince(t) };
+    if (!program) return false;
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "texA"), 0);
+    glUniform1i(glGetUniformLocation(program, "texB"), 1);
+    glUniform1i(glGetUniformLocation(program, "texAcc"), 2);
+    GLint kBaseLoc = glGetUniformLocation(program, "kBase");
+
+    const GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(0);
+
+    // Two N x M accumulators; pass p reads acc[p % 2] and renders into the other
+    GLuint acc[2], fbo[2];
+    glGenFramebuffers(2, fbo);
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        acc[i] = createFloatTexture(s.N, s.M, NULL);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, acc[i], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Error: RGBA8 framebuffer incomplete" << std::endl;
+            ok = false;
+        }
+    }
+    glViewport(0, 0, s.N, s.M);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);  // all-zero bytes decode to 0.0f
+
+    const int passes = (s.K + chunk - 1) / chunk;
+    GLuint texA = 0, texB = 0;
+    for (int iter = 0; iter < warmup + iterations && ok; iter++) {
+        PhaseSample sample = {};
+        Clock::time_point start = Clock::now();
+        t = start;
+
+        // Upload: textures are recreated every iteration, as a one-shot multiply would
+        if (texA) glDeleteTextures(1, &texA);
+        if (texB) glDeleteTextures(1, &texB);
+        glActiveTexture(GL_TEXTURE0);
+        texA = createFloatTexture(s.K, s.M, A.data());
+        glActiveTexture(GL_TEXTURE1);
+        texB = createFloatTexture(s.N, s.K, B.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[0]);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glFinish();
+        sample.hostMs[PHASE_UPLOAD] = msSince(t);
+
+        // Dispatch: one full-screen pass per K-chunk
+        glActiveTexture(GL_TEXTURE2);
+        for (int p = 0; p < passes; p++) {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo[(p + 1) % 2]);
+            glBindTexture(GL_TEXTURE_2D, acc[p % 2]);
+            glUniform1f(kBaseLoc, (float)(p * chunk));
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+        glFinish();
+        sample.hostMs[PHASE_DISPATCH] = msSince(t);
+
+        // Readback: the bytes of each texel are the float itself
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[passes % 2]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, s.N, s.M, GL_RGBA, GL_UNSIGNED_BYTE, C.data());
+        sample.hostMs[PHASE_READBACK] = msSince(t);
+
+        GLenum err = glGetError();
+        if (err != GL_NO_ERROR) {
+            std::cerr << "Error: GLES2 pass failed (GL error 0x" << std::hex << err << std::dec << ")" << std::endl;
+            ok = false;
+        }
+
+        std::chrono::duration<double, std::milli> total = Clock::now() - start;
+        for (int p = 0; p < PHASE_COUNT; p++) sample.gpuMs[p] = sample.hostMs[p];
+        sample.kernelMs = sample.hostMs[PHASE_DISPATCH];
+        sample.gpuTotalMs = sample.hostTotalMs = total.count();
+        if (iter >= warmup) samples.push_back(sample);
+    }
+
+    if (texA) glDeleteTextures(1, &texA);
+    if (texB) glDeleteTextures(1, &texB);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(2, fbo);
+    glDeleteTextures(2, acc);
+    glDeleteBuffers(1, &vbo);
+    glDeleteProgram(program);
+    return ok;
+}
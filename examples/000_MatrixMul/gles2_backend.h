@@ -0,0 +1,31 @@
+#ifndef GLES2_BACKEND_H
+#define GLES2_BACKEND_H
+
+#include <string>
+#include <vector>
+
+#include "phase_timer.h"
+#include "program_cache.h"
+#include "variants.h"
+
+// Classic render-to-texture GEMM on OpenGL ES 2.0, the only GPU API that
+// VideoCore IV exposes. Needs a current ES 2.0 context (ContextRequest with
+// gles = true). Floats travel as raw IEEE-754 bytes in RGBA8 textures, so the
+// host side assumes a little-endian CPU (ARM and x86 both are).
+
+const int GLES2_DEFAULT_CHUNK = 64;  // k-steps per render pass
+
+// Whether the current context can run this shape (highp fragment floats,
+// texture size); `why` gets the reason
+bool gles2Supports(const Shape& s, std::string* why = nullptr);
+
+// Upload A and B as RGBA8 textures, run ceil(K / chunk) passes ping-ponging
+// between two accumulator FBOs, and read C back with glReadPixels,
+// `warmup + iterations` times. ES 2.0 has no timer queries, so phases are
+// host-timed with glFinish at each boundary and gpuMs mirrors hostMs.
+// Only the timed iterations are appended to `samples`. False on error.
+bool runGles2(const Shape& s, int chunk, const std::vector<float>& A, const std::vector<float>& B,
+              std::vector<float>& C, int warmup, int iterations, std::vector<PhaseSample>& samples,
+              ProgramBuildInfo& build);
+
+#endif // GLES2_BACKEND_H
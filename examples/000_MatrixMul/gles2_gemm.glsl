@@ -0,0 +1,67 @@
+#version 100
+
+// Fragment-shader GEMM for GPUs without compute shaders (VideoCore IV).
+// One fragment computes one element of C for a chunk of CHUNK k-steps and
+// adds the partial sum read from the previous pass (ping-pong FBOs).
+//
+// Every float is stored as its 4 IEEE-754 bytes in an RGBA8 texel (R = low
+// byte), so the host uploads and reads back raw float arrays unchanged.
+// Denormals flush to zero; Inf/NaN are not represented.
+//
+// Injected defines:
+//   M, N, K  C (M x N) = A (M x K) * B (K x N); texture row = matrix row
+//   CHUNK    k-steps per pass
+
+precision highp float;
+
+uniform sampler2D texA;    // K x M texels
+uniform sampler2D texB;    // N x K texels
+uniform sampler2D texAcc;  // N x M texels, partial C from the previous pass
+uniform float kBase;       // first k of this pass
+
+float decodeFloat(vec4 texel) {
+    vec4 b = floor(texel * 255.0 + 0.5);
+    float e = mod(b.a, 128.0) * 2.0 + floor(b.b / 128.0);
+    if (e == 0.0) return 0.0;
+    float m = mod(b.b, 128.0) * 65536.0 + b.g * 256.0 + b.r;
+    float v = exp2(e - 127.0) * (1.0 + m / 8388608.0);
+    return b.a >= 128.0 ? -v : v;
+}
+
+vec4 encodeFloat(float v) {
+    float a = abs(v);
+    if (a < 1.17549435e-38) return vec4(0.0);
+
+    float e = floor(log2(a));
+    float m = a * exp2(-e);
+    // log2/exp2 may be off by one ulp around powers of two
+    if (m >= 2.0) { m *= 0.5; e += 1.0; }
+    if (m < 1.0) { m *= 2.0; e -= 1.0; }
+
+    float mantissa = floor((m - 1.0) * 8388608.0 + 0.5);
+    if (mantissa >= 8388608.0) { mantissa = 0.0; e += 1.0; }
+    float biased = clamp(e + 127.0, 1.0, 254.0);
+
+    float b0 = mod(mantissa, 256.0);
+    float b1 = mod(floor(mantissa / 256.0), 256.0);
+    float b2 = floor(mantissa / 65536.0) + mod(biased, 2.0) * 128.0;
+    float b3 = floor(biased / 2.0) + (v < 0.0 ? 128.0 : 0.0);
+    return vec4(b0, b1, b2, b3) / 255.0;
+}
+
+void main() {
+    // gl_FragCoord is at the texel centre: (col + 0.5, row + 0.5)
+    vec2 size = vec2(float(N), float(M));
+    float sum = decodeFloat(texture2D(texAcc, gl_FragCoord.xy / size));
+
+    for (int i = 0; i < CHUNK; i++) {
+        float k = kBase + float(i);
+        if (k >= float(K)) break;
+        float t = (k + 0.5) / float(K);
+        float a = decodeFloat(texture2D(texA, vec2(t, gl_FragCoord.y / float(M))));
+        float b = decodeFloat(texture2D(texB, vec2(gl_FragCoord.x / float(N), t)));
+        sum += a * b;
+    }
+
+    gl_FragColor = encodeFloat(sum);
+}
@@ -0,0 +1,8 @@
+#version 100
+
+// Full-screen quad for the GLES2 backend; one fragment per element of C
+attribute vec2 position;
+
+void main() {
+    gl_Position = vec4(position, 0.0, 1.0);
+}
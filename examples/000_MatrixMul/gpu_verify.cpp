@@ -0,0 +1,90 @@
+#include "gpu_verify.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "program_cache.h"
+#include "shader_utils.h"
+
+namespace {
+
+const char* VERIFY_FILE = "verify.glsl";
+const int VERIFY_LOCAL = 256;  // local_size_x in verify.glsl
+
+GLuint buildStage(const KernelVariant& v, const Shape& s, const char* stage, ProgramCache& cache) {
+    std::string source = loadShader(VERIFY_FILE);
+    if (source.empty()) {
+        std::cerr << "Error: " << VERIFY_FILE << " not found!" << std::endl;
+        return 0;
+    }
+    std::vector<std::string> defines = { stage, "M " + std::to_string(s.M), "N " + std::to_string(s.N),
+                                         "K " + std::to_string(s.K) };
+    if (v.halfStorage) defines.push_back("HALF_STORAGE");
+    if (v.bFromTexture) defines.push_back("B_FROM_TEXTURE");
+    return cache.getComputeProgram(injectDefines(source, defines));
+}
+
+} // namespace
+
+double gpuVerifyTolerance(const Shape& s) {
+    const double unitRoundoff = 1.0 / (1 << 24);
+    return unitRoundoff * std::sqrt((double)s.K + s.N);
+}
+
+VerifyResult verifyOnGpu(const KernelVariant& v, const Shape& s, ProgramCache& cache) {
+    VerifyResult r = { 0.0, 0.0, gpuVerifyTolerance(s), 0.0, false };
+    GLuint bx = buildStage(v, s, "STAGE_BX", cache);
+    GLuint residual = buildStage(v, s, "STAGE_RESIDUAL", cache);
+    if (!bx || !residual) return r;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<float> x(s.N);
+    const GLuint zero[2] = { 0, 0 };
+
+    GLuint buf[3];  // x, y, (maxBits, maxAbsBits)
+    glGenBuffers(3, buf);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf[0]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, x.size() * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf[1]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (size_t)s.K * 2 * sizeof(float), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf[2]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zero), zero, GL_DYNAMIC_READ);
+    for (int i = 0; i < 3; i++) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3 + i, buf[i]);
+
+    // Both maxima accumulate across the vectors through atomicMax
+    for (int pass = 0; pass < GPU_VERIFY_VECTORS; pass++) {
+        // Random x in [-1, 1]; signs keep cancellations in C*x realistic
+        for (float& e : x) e = 2.0f * rand() / RAND_MAX - 1.0f;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf[0]);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, x.size() * sizeof(float), x.data());
+
+        glUseProgram(bx);
+        glDispatchCompute((s.K + VERIFY_LOCAL - 1) / VERIFY_LOCAL, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glUseProgram(residual);
+        glDispatchCompute((s.M + VERIFY_LOCAL - 1) / VERIFY_LOCAL, 1, 1);
+        // y is rewritten by the next pass's first stage
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    GLuint bits[2] = { 0, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf[2]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(bits), bits);
+    glDeleteBuffers(3, buf);
+
+    float maxResidual, maxAbsResidual;
+    memcpy(&maxResidual, &bits[0], sizeof(maxResidual));
+    memcpy(&maxAbsResidual, &bits[1], sizeof(maxAbsResidual));
+    std::chrono::duration<double, std::milli> ms = std::chrono::high_resolution_clock::now() - start;
+    r.maxResidual = maxResidual;
+    r.maxAbsResidual = maxAbsResidual;
+    r.ms = ms.count();
+    r.ok = maxResidual <= r.tolerance;
+    return r;
+}
@@ -0,0 +1,34 @@
+#ifndef GPU_VERIFY_H
+#define GPU_VERIFY_H
+
+#include <glad/glad.h>
+
+#include "variants.h"
+
+class ProgramCache;
+
+// Largest accepted residual |C*x - A*(B*x)| / (|A|*(|B|*|x|)): the
+// statistical fp32 rounding of the check's own K- and N-long dot products,
+// with no safety factor. One wrong element of C only shifts its row's
+// residual by about error*|x_j| / (|A|*|B|*|x|), so any slack here directly
+// raises the smallest error the check can see.
+double gpuVerifyTolerance(const Shape& s);
+
+// Independent random x vectors per check. One wrong element of C is seen
+// through |x_j|, so a few draws keep a small |x_j| from hiding it.
+const int GPU_VERIFY_VECTORS = 3;
+
+struct VerifyResult {
+    double maxResidual;     // normalised, compared against tolerance
+    double maxAbsResidual;  // |C*x - A*(B*x)| itself, to compare with C's error scale
+    double tolerance;
+    double ms;  // host time for both passes and the 4-byte readback
+    bool ok;    // ran and maxResidual <= tolerance
+};
+
+// Check the C the kernel left in its buffers without reading C back:
+// Freivalds' test with GPU_VERIFY_VECTORS random x (verify.glsl). A, B and C must still be
+// bound as the variant bound them (SSBOs 0-2, texture unit 0 for B).
+VerifyResult verifyOnGpu(const KernelVariant& v, const Shape& s, ProgramCache& cache);
+
+#endif // GPU_VERIFY_H
@@ -0,0 +1,117 @@
+#include "half_float.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define HALF_F16C 1
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || (defined(__ARM_FP) && (__ARM_FP & 2)))
+#include <arm_neon.h>
+#define HALF_NEON 1
+#endif
+
+namespace {
+
+inline uint32_t asUint(float f) { uint32_t u; memcpy(&u, &f, sizeof(u)); return u; }
+inline float asFloat(uint32_t u) { float f; memcpy(&f, &u, sizeof(f)); return f; }
+
+// Round to nearest even; overflow goes to infinity, NaNs stay quiet NaNs
+uint16_t toHalf(float f) {
+    const uint32_t infinity = 255u << 23;
+    const uint32_t halfOverflow = (127u + 16) << 23;            // 65536.0f
+    const uint32_t denormMagic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+    uint32_t x = asUint(f);
+    uint32_t sign = x & 0x80000000u;
+    x ^= sign;
+
+    uint16_t h;
+    if (x >= halfOverflow) {
+        h = x > infinity ? 0x7e00 : 0x7c00;
+    } else if (x < (113u << 23)) {
+        // Below the smallest normal half: let the FPU round into the subnormal range
+        h = (uint16_t)(asUint(asFloat(x) + asFloat(denormMagic)) - denormMagic);
+    } else {
+        uint32_t mantissaOdd = (x >> 13) & 1;
+        x += ((uint32_t)(15 - 127) << 23) + 0xfff + mantissaOdd;
+        h = (uint16_t)(x >> 13);
+    }
+    return h | (uint16_t)(sign >> 16);
+}
+
+float toFloat(uint16_t h) {
+    const uint32_t shiftedExp = 0x7c00u << 13;
+
+    uint32_t x = (h & 0x7fffu) << 13;
+    uint32_t exp = x & shiftedExp;
+    x += (127u - 15) << 23;
+    if (exp == shiftedExp) {
+        x += (128u - 16) << 23;                        // Inf/NaN
+    } else if (exp == 0) {
+        x += 1u << 23;                                 // zero/subnormal: renormalize
+        x = asUint(asFloat(x) - asFloat(113u << 23));
+    }
+    return asFloat(x | ((uint32_t)(h & 0x8000u) << 16));
+}
+
+#ifdef HALF_F16C
+bool hasF16C() {
+    static const bool supported = __builtin_cpu_supports("f16c") && __builtin_cpu_supports("avx");
+    return supported;
+}
+
+__attribute__((target("avx,f16c")))
+size_t floatToHalfF16C(const float* src, uint16_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dst + i), h);
+    }
+    return i;
+}
+
+__attribute__((target("avx,f16c")))
+size_t halfToFloatF16C(const uint16_t* src, float* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+void floatToHalf(const float* src, uint16_t* dst, size_t count) {
+    size_t i = 0;
+#if defined(HALF_F16C)
+    if (hasF16C()) i = floatToHalfF16C(src, dst, count);
+#elif defined(HALF_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+    }
+#endif
+    for (; i < count; i++) dst[i] = toHalf(src[i]);
+}
+
+void halfToFloat(const uint16_t* src, float* dst, size_t count) {
+    size_t i = 0;
+#if defined(HALF_F16C)
+    if (hasF16C()) i = halfToFloatF16C(src, dst, count);
+#elif defined(HALF_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+#endif
+    for (; i < count; i++) dst[i] = toFloat(src[i]);
+}
+
+const char* halfConversionPath() {
+#if defined(HALF_F16C)
+    return hasF16C() ? "F16C" : "scalar";
+#elif defined(HALF_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,18 @@
+#ifndef HALF_FLOAT_H
+#define HALF_FLOAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// IEEE binary16 conversion for the fp16 storage variants. Element 2i lands in
+// the low 16 bits of word i, matching packHalf2x16/unpackHalf2x16 in GLSL.
+//
+// Uses F16C (x86, detected at runtime) or NEON (ARM) eight/four lanes at a
+// time, with a scalar round-to-nearest-even fallback for the tail.
+void floatToHalf(const float* src, uint16_t* dst, size_t count);
+void halfToFloat(const uint16_t* src, float* dst, size_t count);
+
+// "F16C", "NEON" or "scalar"
+const char* halfConversionPath();
+
+#endif // HALF_FLOAT_H
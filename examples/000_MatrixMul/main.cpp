@@ -1,102 +1,465 @@
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
 #include <vector>
 #include <chrono>
+#include <string>
 #include <fstream>
-#include <sstream>
 #include <cstring>
 #include <cmath>
 
+#include "chunked.h"
+#include "gl_context.h"
+#include "gles2_backend.h"
+#include "gpu_verify.h"
+#include "half_float.h"
+#include "phase_timer.h"
+#include "program_cache.h"
+#include "report.h"
+#include "streaming.h"
+#include "variants.h"
+
 // --- Configuration ---
-const int WIDTH = 1024;
-const int SIZE = WIDTH * WIDTH;
+const int DEFAULT_SIZE = 1024;
+const int DEFAULT_UNROLL = 4;
+const int DEFAULT_GPU_MEM_MB = 64;  // chunked-mode buffer budget
 
-// --- ERROR CALLBACK ---
-void glfw_error_callback(int error, const char* description) {
-    std::cerr << "GLFW Error " << error << ": " << description << std::endl;
+void cpu_matrix_mult(const std::vector<float>& A, const std::vector<float>& B, std::vector<float>& C,
+                     const Shape& s) {
+    for (int row = 0; row < s.M; row++) {
+        for (int col = 0; col < s.N; col++) {
+            float sum = 0.0f;
+            for (int k = 0; k < s.K; k++) {
+                sum += A[(size_t)row * s.K + k] * B[(size_t)k * s.N + col];
+            }
+            C[(size_t)row * s.N + col] = sum;
+        }
+    }
 }
 
-std::string loadShader(const char* filename) {
-    std::ifstream file(filename);
-    if (!file) return "";
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+// "MxNxK" or "XxY"; returns false unless exactly `count` positive numbers are given
+static bool parseDims(const char* text, int* dims, int count) {
+    for (int i = 0; i < count; i++) {
+        char* end;
+        long d = strtol(text, &end, 10);
+        if (end == text || d <= 0 || d > (1 << 20)) return false;
+        dims[i] = (int)d;
+        if (i + 1 < count && *end != 'x') return false;
+        text = end + 1;
+        if (i + 1 == count && *end != '\0') return false;
+    }
+    return true;
 }
 
-void cpu_matrix_mult(const std::vector<float>& A, const std::vector<float>& B, std::vector<float>& C) {
-    for (int row = 0; row < WIDTH; row++) {
-        for (int col = 0; col < WIDTH; col++) {
-            float sum = 0.0f;
-            for (int k = 0; k < WIDTH; k++) {
-                sum += A[row * WIDTH + k] * B[k * WIDTH + col];
+static const char* buildKind(const ProgramBuildInfo& b) {
+    return b.reused ? "reused" : b.fromCache ? "binary cache" : "compiled";
+}
+
+// Bytes of A and B one upload moves for this variant
+static size_t inputBytes(const KernelVariant& v, const Shape& s) {
+    return (s.sizeA() + s.sizeB()) * (v.halfStorage ? sizeof(uint16_t) : sizeof(float));
+}
+
+// Error of a GPU result against the CPU reference
+struct Accuracy {
+    double maxAbs;
+    double meanAbs;
+    double maxRel;  // relative to |reference|, for elements with |reference| > 1e-6
+};
+
+static Accuracy compareResults(const std::vector<float>& ref, const std::vector<float>& out) {
+    Accuracy a = { 0.0, 0.0, 0.0 };
+    for (size_t i = 0; i < ref.size(); i++) {
+        double err = std::abs((double)ref[i] - out[i]);
+        a.maxAbs = std::max(a.maxAbs, err);
+        a.meanAbs += err;
+        if (std::abs(ref[i]) > 1e-6f) a.maxRel = std::max(a.maxRel, err / std::abs(ref[i]));
+    }
+    if (!ref.empty()) a.meanAbs /= ref.size();
+    return a;
+}
+
+// Print the GPU banner for the current context; returns the renderer string
+static std::string printContextBanner(const GLContext& ctx) {
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    const GLubyte* vendor = glGetString(GL_VENDOR);
+    const GLubyte* version = glGetString(GL_VERSION);
+    std::cout << "=========================================" << std::endl;
+    std::cout << "  GPU: " << (renderer ? (const char*)renderer : "Unknown") << std::endl;
+    std::cout << "  Vendor: " << (vendor ? (const char*)vendor : "Unknown") << std::endl;
+    std::cout << "  Version: " << (version ? (const char*)version : "Unknown") << std::endl;
+    std::cout << "  Context: " << ctx.description << " (" << ctx.createMs << " ms)" << std::endl;
+    std::cout << "=========================================" << std::endl;
+    return renderer ? (const char*)renderer : "Unknown";
+}
+
+// Upload, dispatch and read back one variant `warmup + iterations` times.
+// Only the timed iterations are appended to `samples`. If `verify` is set,
+// the last result is also checked on the GPU. Returns false on error.
+bool runVariant(const KernelVariant& v, const Shape& shape, const Specialization& spec,
+                const std::vector<float>& A, const std::vector<float>& B, std::vector<float>& C,
+                int warmup, int iterations, std::vector<PhaseSample>& samples,
+                ProgramCache& cache, ProgramBuildInfo& build, VerifyResult* verify) {
+    GemmKernel kernel;
+    if (!buildGemmKernel(v, shape, spec, cache, kernel, &build)) return false;
+    std::cout << "Program: " << build.ms << " ms (" << buildKind(build) << ", workgroup "
+              << kernel.localX << "x" << kernel.localY << ")" << std::endl;
+
+    GLuint ssboA, ssboB, ssboC;
+    glGenBuffers(1, &ssboA); glGenBuffers(1, &ssboB); glGenBuffers(1, &ssboC);
+    GLuint texB = 0;
+    std::vector<uint16_t> halfA, halfB;
+    if (v.halfStorage) {
+        halfA.resize(shape.sizeA());
+        halfB.resize(shape.sizeB());
+    }
+
+    PhaseTimer timer;
+    bool ok = true;
+    for (int iter = 0; iter < warmup + iterations && ok; iter++) {
+        timer.start();
+
+        // Upload: storage is reallocated every iteration, as a one-shot multiply would.
+        // fp16 variants convert here, so the conversion is charged to the upload.
+        const void* dataA = A.data();
+        const void* dataB = B.data();
+        size_t elementSize = sizeof(float);
+        if (v.halfStorage) {
+            floatToHalf(A.data(), halfA.data(), halfA.size());
+            floatToHalf(B.data(), halfB.data(), halfB.size());
+            dataA = halfA.data();
+            dataB = halfB.data();
+            elementSize = sizeof(uint16_t);
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboA);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, shape.sizeA() * elementSize, dataA, GL_STATIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssboA);
+
+        if (v.bFromTexture) {
+            if (texB) glDeleteTextures(1, &texB);
+            glActiveTexture(GL_TEXTURE0);
+            texB = createTextureB(B.data(), shape);
+        } else {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboB);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, shape.sizeB() * elementSize, dataB, GL_STATIC_DRAW);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssboB);
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboC);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, shape.sizeC() * sizeof(float), NULL, GL_DYNAMIC_COPY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssboC);
+        timer.endPhase(PHASE_UPLOAD);
+
+        // Dispatch
+        timer.beginKernel();
+        kernel.dispatch();
+        timer.endKernel();
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timer.endPhase(PHASE_DISPATCH);
+
+        // Readback
+        float* ptr = (float*)glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
+        if (ptr) memcpy(C.data(), ptr, shape.sizeC() * sizeof(float));
+        else ok = false;
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        timer.endPhase(PHASE_READBACK);
+
+        PhaseSample sample = timer.collect();
+        if (iter >= warmup) samples.push_back(sample);
+    }
+
+    // Verify while A, B and C are still bound as the kernel saw them
+    if (ok && verify) *verify = verifyOnGpu(v, shape, cache);
+
+    if (texB) glDeleteTextures(1, &texB);
+    glDeleteBuffers(1, &ssboA); glDeleteBuffers(1, &ssboB); glDeleteBuffers(1, &ssboC);
+
+    if (!ok) std::cerr << "Error: glMapBuffer failed for " << v.name << std::endl;
+    return ok;
+}
+
+// Stream `batches` independent multiplies through each selected variant,
+// persistent-mapped ring versus the per-pair glBufferData/glMapBuffer path.
+int runStreamBenchmark(const std::vector<const KernelVariant*>& selected, const Shape& shape,
+                       const Specialization& spec, int batches, const std::string& jsonPath,
+                       const char* renderer, ProgramCache& cache) {
+    if (!streamingSupported()) {
+        std::cerr << "Error: streaming needs glBufferStorage (GL 4.4 or ARB_buffer_storage)" << std::endl;
+        return -1;
+    }
+
+    struct Row { const char* name; StreamResult ring, naive; };
+    std::vector<Row> rows;
+    int failures = 0;
+    for (const KernelVariant* v : selected) {
+        std::string why;
+        if (v->bFromTexture || v->halfStorage) why = "not supported in streaming mode";
+        if (!why.empty() || !variantSupports(*v, shape, spec, &why)) {
+            std::cout << "Skipping " << v->name << " (" << why << ")" << std::endl;
+            continue;
+        }
+        GemmKernel kernel;
+        if (!buildGemmKernel(*v, shape, spec, cache, kernel)) {
+            failures++;
+            continue;
+        }
+
+        std::cout << "Streaming " << batches << " matrix pairs [" << v->name << "]..." << std::endl;
+        Row row = { v->name, runStreaming(kernel, batches), runStreamingNaive(kernel, batches) };
+
+        for (const StreamResult* r : { &row.ring, &row.naive }) {
+            if (!r->ok || r->maxError > 0.1) failures++;
+        }
+        std::cout << "  Triple-buffered: " << row.ring.matricesPerSecond << " matrices/s"
+                  << " (CPU blocked " << row.ring.fenceWaitMs << " ms, max error " << row.ring.maxError << ")" << std::endl;
+        std::cout << "  Per-pair upload: " << row.naive.matricesPerSecond << " matrices/s"
+                  << " (max error " << row.naive.maxError << ")" << std::endl;
+        rows.push_back(row);
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        if (!out) std::cerr << "Error: cannot write " << jsonPath << std::endl;
+
+        JsonWriter json(out);
+        json.beginObject();
+        json.value("renderer", renderer);
+        json.value("m", shape.M);
+        json.value("n", shape.N);
+        json.value("k", shape.K);
+        json.value("batches", batches);
+        json.beginArray("streaming");
+        for (const Row& row : rows) {
+            json.beginObject();
+            json.value("name", row.name);
+            for (const StreamResult* r : { &row.ring, &row.naive }) {
+                json.beginObject(r == &row.ring ? "triple_buffered" : "per_pair");
+                json.value("ok", r->ok);
+                json.value("seconds", r->seconds);
+                json.value("matrices_per_second", r->matricesPerSecond);
+                json.value("fence_wait_ms", r->fenceWaitMs);
+                json.value("max_error", r->maxError);
+                json.endObject();
+            }
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+    }
+    return failures ? -1 : 0;
+}
+
+// Run each selected variant in chunked mode over the full shape, comparing
+// against the CPU reference when one is given.
+int runChunkedBenchmark(const std::vector<const KernelVariant*>& selected, const Shape& shape,
+                        const Specialization& spec, int tileRequest, size_t budgetBytes,
+                        const std::vector<float>& A, const std::vector<float>& B,
+                        const std::vector<float>* reference, const std::string& jsonPath,
+                        const char* renderer, ProgramCache& cache) {
+    struct Row { const char* name; ChunkedResult result; bool compared; Accuracy accuracy; };
+    std::vector<Row> rows;
+    std::vector<float> C(shape.sizeC());
+    int failures = 0;
+    for (const KernelVariant* v : selected) {
+        ChunkTile tile = chooseChunkTile(*v, shape, tileRequest, budgetBytes);
+        std::string why;
+        if (!chunkedSupported(*v, &why) || !variantSupports(*v, Shape{ tile.M, tile.N, tile.K }, spec, &why)) {
+            std::cout << "Skipping " << v->name << " (" << why << ")" << std::endl;
+            continue;
+        }
+
+        std::cout << "Chunked [" << v->name << "]: tile " << tile.M << "x" << tile.N << "x" << tile.K << "..."
+                  << std::endl;
+        std::fill(C.begin(), C.end(), 0.0f);
+        Row row = { v->name, runChunked(*v, shape, spec, tile, A, B, C, cache), false, { 0.0, 0.0, 0.0 } };
+        const ChunkedResult& r = row.result;
+        if (!r.ok) {
+            failures++;
+            continue;
+        }
+        std::cout << "  " << r.seconds * 1e3 << " ms (" << shape.flops() / (r.seconds * 1e9) << " GFLOPS), "
+                  << r.dispatches << " dispatches over " << r.blocks << " blocks, GPU buffers "
+                  << r.gpuBytes / (1024.0 * 1024.0) << " MB, uploaded " << r.uploadBytes / (1024.0 * 1024.0)
+                  << " MB, CPU blocked " << r.fenceWaitMs << " ms" << std::endl;
+
+        if (reference) {
+            row.compared = true;
+            row.accuracy = compareResults(*reference, C);
+            bool correct = row.accuracy.maxAbs <= 0.1;
+            std::cout << "  Results Match: " << (correct ? "YES" : "NO") << " (max abs error "
+                      << row.accuracy.maxAbs << ")" << std::endl;
+            if (!correct) failures++;
+        }
+        rows.push_back(row);
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        if (!out) std::cerr << "Error: cannot write " << jsonPath << std::endl;
+
+        JsonWriter json(out);
+        json.beginObject();
+        json.value("renderer", renderer);
+        json.value("m", shape.M);
+        json.value("n", shape.N);
+        json.value("k", shape.K);
+        json.value("gpu_budget_bytes", (double)budgetBytes);
+        json.beginArray("chunked");
+        for (const Row& row : rows) {
+            const ChunkedResult& r = row.result;
+            json.beginObject();
+            json.value("name", row.name);
+            json.value("tile_m", r.tile.M);
+            json.value("tile_n", r.tile.N);
+            json.value("tile_k", r.tile.K);
+            json.value("blocks", r.blocks);
+            json.value("dispatches", r.dispatches);
+            json.value("seconds", r.seconds);
+            json.value("gflops", shape.flops() / (r.seconds * 1e9));
+            json.value("fence_wait_ms", r.fenceWaitMs);
+            json.value("gpu_bytes", (double)r.gpuBytes);
+            json.value("upload_bytes", (double)r.uploadBytes);
+            if (row.compared) {
+                json.value("match", row.accuracy.maxAbs <= 0.1);
+                json.value("max_abs_error", row.accuracy.maxAbs);
             }
-            C[row * WIDTH + col] = sum;
+            json.endObject();
         }
+        json.endArray();
+        json.endObject();
     }
+    return failures ? -1 : 0;
 }
 
 int main(int argc, char* argv[]) {
     bool skipCPU = false;
+    bool gpuVerify = false;
+    std::string variantName = "all";
+    std::string jsonPath;
+    int warmup = 1;
+    int iterations = 3;
+    int streamBatches = 0;
+    bool chunked = false;
+    int chunkTile = 0;
+    int gpuMemMB = DEFAULT_GPU_MEM_MB;
+    Shape shape = { DEFAULT_SIZE, DEFAULT_SIZE, DEFAULT_SIZE };
+    Specialization spec = { DEFAULT_UNROLL, 0, 0, false };
+    ContextBackend contextBackend = ContextBackend::Auto;
+    std::string gpuBackend = "all";
+    int gles2Chunk = GLES2_DEFAULT_CHUNK;
+    std::string cacheDir = ProgramCache::defaultDirectory();
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--skip-cpu") == 0) skipCPU = true;
+        else if (strcmp(argv[i], "--gpu-verify") == 0) gpuVerify = true;
+        else if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc) variantName = argv[++i];
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) streamBatches = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--chunked") == 0) chunked = true;
+        else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc) chunkTile = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--gpu-mem") == 0 && i + 1 < argc) gpuMemMB = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            int n;
+            if (!parseDims(argv[++i], &n, 1)) {
+                std::cerr << "Invalid --size '" << argv[i] << "'" << std::endl;
+                return -1;
+            }
+            shape = { n, n, n };
+        }
+        else if (strcmp(argv[i], "--shape") == 0 && i + 1 < argc) {
+            int d[3];
+            if (!parseDims(argv[++i], d, 3)) {
+                std::cerr << "Invalid --shape '" << argv[i] << "' (expected MxNxK)" << std::endl;
+                return -1;
+            }
+            shape = { d[0], d[1], d[2] };
+        }
+        else if (strcmp(argv[i], "--unroll") == 0 && i + 1 < argc) spec.unroll = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--local") == 0 && i + 1 < argc) {
+            int d[2];
+            if (!parseDims(argv[++i], d, 2)) {
+                std::cerr << "Invalid --local '" << argv[i] << "' (expected XxY)" << std::endl;
+                return -1;
+            }
+            spec.localX = d[0];
+            spec.localY = d[1];
+        }
+        else if (strcmp(argv[i], "--context") == 0 && i + 1 < argc) {
+            if (!parseContextBackend(argv[++i], contextBackend)) {
+                std::cerr << "Unknown context backend '" << argv[i] << "' (auto|surfaceless|gbm|glfw)" << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            gpuBackend = argv[++i];
+            if (gpuBackend != "all" && gpuBackend != "compute" && gpuBackend != "gles2") {
+                std::cerr << "Unknown backend '" << gpuBackend << "' (all|compute|gles2)" << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--gles2-chunk") == 0 && i + 1 < argc) gles2Chunk = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc) cacheDir = argv[++i];
+        else if (strcmp(argv[i], "--no-shader-cache") == 0) cacheDir.clear();
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) jsonPath = argv[++i];
+        else if (strcmp(argv[i], "--list-variants") == 0) {
+            for (const KernelVariant& v : kernelVariants()) {
+                std::cout << std::left << std::setw(8) << v.name << " " << v.description << std::endl;
+            }
+            return 0;
+        }
     }
 
-    // 1. Setup Error Callback & Init
-    glfwSetErrorCallback(glfw_error_callback);
-    
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
+    std::vector<const KernelVariant*> selected;
+    if (variantName == "all") {
+        for (const KernelVariant& v : kernelVariants()) selected.push_back(&v);
+    } else if (const KernelVariant* v = findVariant(variantName)) {
+        selected.push_back(v);
+    } else {
+        std::cerr << "Unknown variant '" << variantName << "' (see --list-variants)" << std::endl;
         return -1;
     }
 
-    // 2. Request Specific Context (4.3 Core) to ensure compatibility
-    // NOTE: Raspberry Pi 3B (VideoCore IV) does not natively support 4.3!
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
-
-    GLFWwindow* window = glfwCreateWindow(640, 480, "Hidden", NULL, NULL);
-    if (!window) {
-        std::cerr << "Failed to create GLFW window. Check your GPU drivers." << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    
-    glfwMakeContextCurrent(window);
-    
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
-        glfwTerminate();
-        return -1;
+    const bool useCompute = gpuBackend != "gles2";
+    const bool useGles2 = gpuBackend != "compute";
+
+    // --- STREAMING MODE (compute only; replaces the one-shot benchmark) ---
+    if (streamBatches > 0) {
+        if (!useCompute) {
+            std::cerr << "Error: --stream needs the compute backend" << std::endl;
+            return -1;
+        }
+        GLContext ctx;
+        if (!createGLContext(contextBackend, ContextRequest{ 4, 3, false }, ctx)) {
+            return -1;
+        }
+        std::string renderer = printContextBanner(ctx);
+        ProgramCache programCache(cacheDir);
+        if (programCache.enabled()) std::cout << "Shader cache: " << programCache.directory() << std::endl;
+        int rc = runStreamBenchmark(selected, shape, spec, streamBatches, jsonPath, renderer.c_str(), programCache);
+        programCache.releasePrograms();
+        destroyGLContext(ctx);
+        return rc;
     }
 
-    // --- IDENTIFY GPU ---
-    const GLubyte* renderer = glGetString(GL_RENDERER);
-    const GLubyte* vendor = glGetString(GL_VENDOR);
-    std::cout << "=========================================" << std::endl;
-    std::cout << "  GPU: " << (renderer ? (const char*)renderer : "Unknown") << std::endl;
-    std::cout << "  Vendor: " << (vendor ? (const char*)vendor : "Unknown") << std::endl;
-    std::cout << "=========================================" << std::endl;
+    std::cout << "Shape: C(" << shape.M << "x" << shape.N << ") = A(" << shape.M << "x" << shape.K
+              << ") * B(" << shape.K << "x" << shape.N << "), unroll " << spec.unroll << std::endl;
 
     // --- DATA GENERATION ---
-    std::vector<float> A(SIZE);
-    std::vector<float> B(SIZE);
-    std::vector<float> C_CPU(SIZE);
-    std::vector<float> C_GPU(SIZE);
+    std::vector<float> A(shape.sizeA());
+    std::vector<float> B(shape.sizeB());
+    std::vector<float> C_CPU(shape.sizeC());
+    std::vector<float> C_GPU(shape.sizeC());
 
-    for (int i = 0; i < SIZE; i++) {
-        A[i] = static_cast<float>(rand()) / RAND_MAX;
-        B[i] = static_cast<float>(rand()) / RAND_MAX;
-    }
+    for (float& x : A) x = static_cast<float>(rand()) / RAND_MAX;
+    for (float& x : B) x = static_cast<float>(rand()) / RAND_MAX;
 
     // --- CPU BENCH ---
     if (!skipCPU) {
         std::cout << "Starting CPU Matrix Multiplication..." << std::endl;
         auto startCPU = std::chrono::high_resolution_clock::now();
-        cpu_matrix_mult(A, B, C_CPU);
+        cpu_matrix_mult(A, B, C_CPU, shape);
         auto endCPU = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double, std::milli> msCPU = endCPU - startCPU;
         std::cout << "CPU Time: " << msCPU.count() << " ms" << std::endl;
@@ -104,72 +467,314 @@ int main(int argc, char* argv[]) {
         std::cout << "Skipping CPU Benchmark..." << std::endl;
     }
 
-    // --- GPU BENCH ---
-    std::string sourceStr = loadShader("compute.glsl");
-    if (sourceStr.empty()) {
-        std::cerr << "Error: compute.glsl not found!" << std::endl;
-        return -1;
+    // --- CHUNKED MODE (compute only; replaces the one-shot benchmark) ---
+    if (chunked) {
+        if (!useCompute) {
+            std::cerr << "Error: --chunked needs the compute backend" << std::endl;
+            return -1;
+        }
+        GLContext ctx;
+        if (!createGLContext(contextBackend, ContextRequest{ 4, 3, false }, ctx)) {
+            return -1;
+        }
+        std::string renderer = printContextBanner(ctx);
+        ProgramCache programCache(cacheDir);
+        int rc = runChunkedBenchmark(selected, shape, spec, chunkTile, (size_t)gpuMemMB << 20, A, B,
+                                     skipCPU ? nullptr : &C_CPU, jsonPath, renderer.c_str(), programCache);
+        programCache.releasePrograms();
+        destroyGLContext(ctx);
+        return rc;
     }
-    const char* src = sourceStr.c_str();
 
-    GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(shader, 1, &src, NULL);
-    glCompileShader(shader);
+    // --- GPU BENCH ---
+    struct Result {
+        std::string name;
+        const char* backend;
+        const char* storage;  // "fp32" or "fp16"
+        size_t inputBytes;    // A + B bytes per upload
+        std::vector<PhaseSample> samples;
+        const char* match;
+        ProgramBuildInfo build;
+        Accuracy accuracy;
+        bool verified;  // GPU check ran
+        VerifyResult verify;
+    };
+    // What each backend's context cost, for the startup lines and the report
+    struct BackendRun {
+        bool ran;
+        std::string renderer;
+        std::string context;
+        double contextMs;
+        double programMs;
+        int programs;
+        int cached;
+    };
+    std::vector<Result> results;
+    BackendRun computeRun = { false, "", "", 0.0, 0.0, 0, 0 }, gles2Run = computeRun;
+    const double flops = shape.flops();
+    int failures = 0;
 
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cerr << "Shader Error: " << infoLog << std::endl;
-        return -1;
-    }
+    // Print the times of a finished run and compare it against the CPU reference
+    auto finishResult = [&](Result& r, BackendRun& run) {
+        std::vector<double> kernel, endToEnd;
+        for (const PhaseSample& s : r.samples) {
+            kernel.push_back(s.kernelMs);
+            endToEnd.push_back(s.hostTotalMs);
+        }
+        SampleStats k = computeStats(kernel), e = computeStats(endToEnd);
+        std::cout << "GPU Time: kernel " << k.mean << " ms (" << flops / (k.mean * 1e6) << " GFLOPS), "
+                  << "end-to-end " << e.mean << " ms (" << flops / (e.mean * 1e6) << " GFLOPS)" << std::endl;
 
-    GLuint program = glCreateProgram();
-    glAttachShader(program, shader);
-    glLinkProgram(program);
-    glUseProgram(program);
+        if (!skipCPU) {
+            r.accuracy = compareResults(C_CPU, C_GPU);
+            bool correct = r.accuracy.maxAbs <= 0.1;
+            std::cout << "Results Match: " << (correct ? "YES" : "NO") << " (max abs error " << r.accuracy.maxAbs
+                      << ", mean " << r.accuracy.meanAbs << ", max rel " << r.accuracy.maxRel << ")" << std::endl;
+            if (!correct) failures++;
+            r.match = correct ? "YES" : "NO";
+        }
+        if (r.verified) {
+            std::cout << "GPU Verify: " << (r.verify.ok ? "PASS" : "FAIL") << " (max residual "
+                      << r.verify.maxResidual << ", tolerance " << r.verify.tolerance << "; max |Cx - ABx| "
+                      << r.verify.maxAbsResidual << " over " << GPU_VERIFY_VECTORS << " vectors, " << r.verify.ms
+                      << " ms)" << std::endl;
+            if (!r.verify.ok) failures++;
+            // Without the CPU reference, the GPU check decides the Match column
+            if (skipCPU) r.match = r.verify.ok ? "YES" : "NO";
+        }
 
-    std::cout << "Starting GPU Matrix Multiplication..." << std::endl;
-    auto startGPU = std::chrono::high_resolution_clock::now();
+        run.programMs += r.build.ms;
+        run.programs++;
+        if (r.build.fromCache) run.cached++;
+        results.push_back(r);
+    };
 
-    GLuint ssboA, ssboB, ssboC;
-    glGenBuffers(1, &ssboA); glGenBuffers(1, &ssboB); glGenBuffers(1, &ssboC);
+    // 1. Compute shaders: 4.3 core context (EGL headless by default, GLFW as fallback)
+    // NOTE: Raspberry Pi 3B (VideoCore IV) does not natively support 4.3!
+    GLContext ctx;
+    if (useCompute && createGLContext(contextBackend, ContextRequest{ 4, 3, false }, ctx)) {
+        computeRun = { true, printContextBanner(ctx), ctx.description, ctx.createMs, 0.0, 0, 0 };
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboA);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, SIZE * sizeof(float), A.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssboA);
+        ProgramCache programCache(cacheDir);
+        if (programCache.enabled()) std::cout << "Shader cache: " << programCache.directory() << std::endl;
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboB);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, SIZE * sizeof(float), B.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssboB);
+        for (const KernelVariant* v : selected) {
+            std::string why;
+            if (!variantSupports(*v, shape, spec, &why)) {
+                std::cout << "Skipping " << v->name << " (" << why << ")" << std::endl;
+                continue;
+            }
+            if (!fitsShaderStorageBlock(*v, shape)) {
+                std::cout << "Skipping " << v->name << " (exceeds GL_MAX_SHADER_STORAGE_BLOCK_SIZE, use --chunked)"
+                          << std::endl;
+                continue;
+            }
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboC);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, SIZE * sizeof(float), NULL, GL_DYNAMIC_COPY);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssboC);
+            std::cout << "Starting GPU Matrix Multiplication [" << v->name << "] ("
+                      << warmup << " warm-up, " << iterations << " timed)..." << std::endl;
+            std::fill(C_GPU.begin(), C_GPU.end(), 0.0f);
+            Result r = { v->name, "compute", v->halfStorage ? "fp16" : "fp32", inputBytes(*v, shape), {}, "-", { false, false, 0.0 }, { 0.0, 0.0, 0.0 },
+                          gpuVerify, { 0.0, 0.0, 0.0, 0.0, false } };
+            if (!runVariant(*v, shape, spec, A, B, C_GPU, warmup, iterations, r.samples, programCache, r.build,
+                            gpuVerify ? &r.verify : nullptr)) {
+                failures++;
+                continue;
+            }
+            finishResult(r, computeRun);
+        }
 
-    glUniform1i(glGetUniformLocation(program, "WIDTH"), WIDTH);
-    glDispatchCompute(WIDTH / 32, WIDTH / 32, 1);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        programCache.releasePrograms();
+        destroyGLContext(ctx);
+    } else if (useCompute) {
+        std::cout << "Compute backend unavailable (needs OpenGL 4.3)" << std::endl;
+        if (!useGles2) return -1;
+    }
 
-    float* ptr = (float*)glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
-    if (ptr) memcpy(C_GPU.data(), ptr, SIZE * sizeof(float));
-    glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    // 2. Fragment shaders: OpenGL ES 2.0, what VideoCore IV actually offers
+    if (useGles2 && createGLContext(contextBackend, ContextRequest{ 2, 0, true }, ctx)) {
+        gles2Run = { true, printContextBanner(ctx), ctx.description, ctx.createMs, 0.0, 0, 0 };
 
-    auto endGPU = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> msGPU = endGPU - startGPU;
-    std::cout << "GPU Time: " << msGPU.count() << " ms" << std::endl;
+        std::string why;
+        if (!gles2Supports(shape, &why)) {
+            std::cout << "Skipping gles2 (" << why << ")" << std::endl;
+        } else {
+            std::cout << "Starting GPU Matrix Multiplication [gles2] (" << (shape.K + gles2Chunk - 1) / gles2Chunk
+                      << " passes of " << gles2Chunk << ", " << warmup << " warm-up, " << iterations << " timed)..."
+                      << std::endl;
+            std::fill(C_GPU.begin(), C_GPU.end(), 0.0f);
+            Result r = { "gles2", "gles2", "fp32", (shape.sizeA() + shape.sizeB()) * sizeof(float), {}, "-",
+                         { false, false, 0.0 }, { 0.0, 0.0, 0.0 }, false, { 0.0, 0.0, 0.0, 0.0, false } };
+            if (runGles2(shape, gles2Chunk, A, B, C_GPU, warmup, iterations, r.samples, r.build)) {
+                std::cout << "Program: " << r.build.ms << " ms (" << buildKind(r.build) << ")" << std::endl;
+                finishResult(r, gles2Run);
+            } else {
+                failures++;
+            }
+        }
+        destroyGLContext(ctx);
+    } else if (useGles2) {
+        std::cout << "GLES2 backend unavailable (needs OpenGL ES 2.0)" << std::endl;
+        if (!computeRun.ran) return -1;
+    }
 
-    if (!skipCPU) {
-        bool correct = true;
-        for (int i = 0; i < SIZE; i++) {
-            if (std::abs(C_CPU[i] - C_GPU[i]) > 0.1f) { 
-                correct = false; break; 
+    // --- SUMMARY (mean over timed iterations; phases from GPU timestamps, host clock for gles2) ---
+    // Without a timestamp counter collect() leaves gpuMs at -1; such runs
+    // report their phases from the host clock instead, and say so
+    auto hostClocked = [](const Result& r) {
+        for (const PhaseSample& s : r.samples) {
+            if (s.gpuMs[0] < 0.0) return true;
+        }
+        return false;
+    };
+    auto phaseMs = [](const PhaseSample& s, int p) { return s.gpuMs[p] >= 0.0 ? s.gpuMs[p] : s.hostMs[p]; };
+    std::vector<std::string> hostClockedNames;
+    const std::streamsize defaultPrecision = std::cout.precision();
+    std::cout << "=========================================" << std::endl;
+    std::cout << std::left << std::setw(8) << "Variant" << std::right
+              << std::setw(10) << "Upload" << std::setw(10) << "Dispatch" << std::setw(10) << "Readback"
+              << std::setw(10) << "E2E(ms)" << std::setw(10) << "Kern GF" << std::setw(10) << "E2E GF"
+              << std::setw(10) << "Up GB/s" << std::setw(10) << "MaxErr" << std::setw(7) << "Match" << std::endl;
+    for (const Result& r : results) {
+        std::vector<double> phase[PHASE_COUNT], kernel, endToEnd;
+        for (const PhaseSample& s : r.samples) {
+            for (int p = 0; p < PHASE_COUNT; p++) phase[p].push_back(phaseMs(s, p));
+            kernel.push_back(s.kernelMs);
+            endToEnd.push_back(s.hostTotalMs);
+        }
+        if (hostClocked(r)) hostClockedNames.push_back(r.name);
+        std::cout << std::left << std::setw(8) << r.name << std::right << std::fixed << std::setprecision(2);
+        for (int p = 0; p < PHASE_COUNT; p++) std::cout << std::setw(10) << computeStats(phase[p]).mean;
+        double k = computeStats(kernel).mean, e = computeStats(endToEnd).mean;
+        double up = computeStats(phase[PHASE_UPLOAD]).mean;
+        std::cout << std::setw(10) << e << std::setprecision(3)
+                  << std::setw(10) << flops / (k * 1e6) << std::setw(10) << flops / (e * 1e6)
+                  << std::setw(10) << r.inputBytes / (up * 1e6);
+        if (skipCPU) std::cout << std::setw(10) << "-";
+        else std::cout << std::setw(10) << std::scientific << std::setprecision(1) << r.accuracy.maxAbs;
+        std::cout << std::setw(7) << r.match << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+    std::cout.precision(defaultPrecision);
+    for (const std::string& name : hostClockedNames) {
+        std::cout << name << ": no GPU timestamps, Upload/Dispatch/Readback are host time" << std::endl;
+    }
+    std::cout << "=========================================" << std::endl;
+
+    // --- STARTUP (cold: programs compiled from source, warm: loaded from the binary cache) ---
+    auto startupKind = [](const BackendRun& run) {
+        return run.programs == 0 ? "-" : run.cached == run.programs ? "warm" : run.cached ? "mixed" : "cold";
+    };
+    if (computeRun.ran) {
+        std::cout << "Startup (" << startupKind(computeRun) << "): context " << computeRun.contextMs
+                  << " ms + programs " << computeRun.programMs << " ms (" << computeRun.cached << "/"
+                  << computeRun.programs << " from cache) = " << computeRun.contextMs + computeRun.programMs
+                  << " ms" << std::endl;
+    }
+    if (gles2Run.ran) {
+        std::cout << "Startup (gles2): context " << gles2Run.contextMs << " ms + program " << gles2Run.programMs
+                  << " ms = " << gles2Run.contextMs + gles2Run.programMs << " ms" << std::endl;
+    }
+
+    // --- MACHINE-READABLE REPORT ---
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        if (!out) std::cerr << "Error: cannot write " << jsonPath << std::endl;
+
+        JsonWriter json(out);
+        json.beginObject();
+        if (computeRun.ran) {
+            json.value("renderer", computeRun.renderer);
+            json.value("context", computeRun.context);
+            json.value("context_create_ms", computeRun.contextMs);
+            json.value("program_build_ms", computeRun.programMs);
+            json.value("startup", startupKind(computeRun));
+            json.value("startup_ms", computeRun.contextMs + computeRun.programMs);
+        }
+        if (gles2Run.ran) {
+            json.beginObject("gles2");
+            json.value("renderer", gles2Run.renderer);
+            json.value("context", gles2Run.context);
+            json.value("context_create_ms", gles2Run.contextMs);
+            json.value("program_build_ms", gles2Run.programMs);
+            json.value("chunk", gles2Chunk);
+            json.endObject();
+        }
+        json.value("m", shape.M);
+        json.value("n", shape.N);
+        json.value("k", shape.K);
+        json.value("unroll", spec.unroll);
+        json.value("flops", flops);
+        json.value("warmup", warmup);
+        json.value("iterations", iterations);
+        json.beginArray("variants");
+        for (const Result& r : results) {
+            std::vector<double> gpu[PHASE_COUNT], host[PHASE_COUNT], kernel, endToEnd;
+            for (const PhaseSample& s : r.samples) {
+                for (int p = 0; p < PHASE_COUNT; p++) {
+                    gpu[p].push_back(phaseMs(s, p));
+                    host[p].push_back(s.hostMs[p]);
+                }
+                kernel.push_back(s.kernelMs);
+                endToEnd.push_back(s.hostTotalMs);
+            }
+            SampleStats k = computeStats(kernel), e = computeStats(endToEnd);
+            const bool hostClock = hostClocked(r);
+
+            json.beginObject();
+            json.value("name", r.name);
+            json.value("backend", r.backend);
+            json.value("program_ms", r.build.ms);
+            json.value("program_from_cache", r.build.fromCache);
+            json.value("storage", r.storage);
+            if (r.verified) {
+                json.beginObject("gpu_verify");
+                json.value("ok", r.verify.ok);
+                json.value("max_residual", r.verify.maxResidual);
+                json.value("max_abs_residual", r.verify.maxAbsResidual);
+                json.value("vectors", GPU_VERIFY_VECTORS);
+                json.value("tolerance", r.verify.tolerance);
+                json.value("ms", r.verify.ms);
+                json.endObject();
+            }
+            if (!skipCPU || r.verified) json.value("match", strcmp(r.match, "YES") == 0);
+            if (!skipCPU) {
+                json.beginObject("accuracy");
+                json.value("max_abs_error", r.accuracy.maxAbs);
+                json.value("mean_abs_error", r.accuracy.meanAbs);
+                json.value("max_rel_error", r.accuracy.maxRel);
+                json.endObject();
+            }
+            json.beginObject("phases");
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                SampleStats g = computeStats(gpu[p]), h = computeStats(host[p]);
+                json.beginObject(phaseName((Phase)p));
+                if (!hostClock) {
+                    json.value("gpu_ms_mean", g.mean);
+                    json.value("gpu_ms_min", g.min);
+                }
+                json.value("host_ms_mean", h.mean);
+                json.value("host_ms_min", h.min);
+                json.endObject();
             }
+            json.endObject();
+            json.value("kernel_ms_mean", k.mean);
+            json.value("kernel_ms_min", k.min);
+            json.value("end_to_end_ms_mean", e.mean);
+            json.value("end_to_end_ms_min", e.min);
+            json.value("kernel_gflops", flops / (k.mean * 1e6));
+            json.value("end_to_end_gflops", flops / (e.mean * 1e6));
+            double inBytes = (double)r.inputBytes;
+            double outBytes = (double)(shape.sizeC() * sizeof(float));
+            json.value("upload_bytes", inBytes);
+            json.value("readback_bytes", outBytes);
+            json.value("transfer_clock", hostClock ? "host" : "gpu");
+            json.value("upload_gbps", inBytes / (computeStats(gpu[PHASE_UPLOAD]).mean * 1e6));
+            json.value("readback_gbps", outBytes / (computeStats(gpu[PHASE_READBACK]).mean * 1e6));
+            json.endObject();
         }
-        std::cout << "Results Match: " << (correct ? "YES" : "NO") << std::endl;
+        json.endArray();
+        json.endObject();
     }
 
-    glfwTerminate();
-    return 0;
+    return failures ? -1 : 0;
 }
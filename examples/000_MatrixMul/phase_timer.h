@@ -0,0 +1,65 @@
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <vector>
+
+// Phases of one end-to-end GPU multiply
+enum Phase {
+    PHASE_UPLOAD = 0,   // buffer (re)allocation and glBufferData of A, B
+    PHASE_DISPATCH,     // glDispatchCompute + glMemoryBarrier
+    PHASE_READBACK,     // glMapBuffer + memcpy + glUnmapBuffer
+    PHASE_COUNT
+};
+
+const char* phaseName(Phase p);
+
+// Timings of one iteration, all in milliseconds.
+// gpuMs comes from GL_TIMESTAMP queries at the phase boundaries, kernelMs
+// from a GL_TIME_ELAPSED query around the dispatch, hostMs from the CPU clock.
+struct PhaseSample {
+    double gpuMs[PHASE_COUNT];
+    double hostMs[PHASE_COUNT];
+    double kernelMs;
+    double gpuTotalMs;
+    double hostTotalMs;
+};
+
+// Records GL_TIMESTAMP/GL_TIME_ELAPSED queries and host timestamps for one
+// iteration. Usage: start(); ... endPhase(PHASE_UPLOAD); beginKernel();
+// dispatch; endKernel(); endPhase(PHASE_DISPATCH); ...; collect().
+class PhaseTimer {
+public:
+    PhaseTimer();
+    ~PhaseTimer();
+
+    // False if the driver has no timestamp counter; GPU fields are then -1
+    bool gpuTimersAvailable() const { return timestampBits > 0; }
+
+    void start();
+    void endPhase(Phase p);
+    void beginKernel();
+    void endKernel();
+
+    // Blocks until all query results are available
+    PhaseSample collect();
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    GLint timestampBits;
+    GLuint stampQueries[PHASE_COUNT + 1];
+    GLuint elapsedQuery;
+    Clock::time_point hostStamps[PHASE_COUNT + 1];
+};
+
+// Mean and minimum of a series of samples
+struct SampleStats {
+    double mean;
+    double min;
+};
+
+SampleStats computeStats(const std::vector<double>& values);
+
+#endif // PHASE_TIMER_H
@@ -0,0 +1,197 @@
+#include "program_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "shader_utils.h"
+
+namespace {
+
+const char MAGIC[8] = { 'G', 'P', 'G', 'P', 'U', 'P', 'B', '2' };
+
+// Followed by the identity string, then the binary
+struct EntryHeader {
+    char magic[8];
+    uint64_t key;
+    uint32_t format;
+    uint32_t identityLength;
+    uint32_t length;
+};
+
+// FNV-1a, 64 bit
+uint64_t hashBytes(const std::string& s, uint64_t h = 14695981039346656037ull) {
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+std::string glString(GLenum name) {
+    const GLubyte* s = glGetString(name);
+    return s ? (const char*)s : "";
+}
+
+} // namespace
+
+ProgramCache::ProgramCache(const std::string& directory) : dir(directory) {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0 && enabled()) {
+        std::cerr << "Warning: driver exposes no program binary formats, shader cache disabled" << std::endl;
+        dir.clear();
+    }
+    driverId = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+
+    if (enabled()) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            std::cerr << "Warning: cannot create shader cache " << dir << ": " << ec.message() << std::endl;
+            dir.clear();
+        }
+    }
+}
+
+std::string ProgramCache::defaultDirectory() {
+    if (const char* xdg = getenv("XDG_CACHE_HOME")) {
+        if (*xdg) return std::string(xdg) + "/gpgpu_mm";
+    }
+    if (const char* home = getenv("HOME")) {
+        if (*home) return std::string(home) + "/.cache/gpgpu_mm";
+    }
+    return "";
+}
+
+uint64_t ProgramCache::keyFor(const std::string& source) const {
+    return hashBytes(source, hashBytes(driverId + '\0'));
+}
+
+// What the entry was built from: the driver and the source's hash. The file
+// name alone is a 64-bit hash, so a collision or a stale entry must still miss.
+std::string ProgramCache::identityFor(const std::string& source) const {
+    char hash[32];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)hashBytes(source));
+    return driverId + "\nsource " + hash;
+}
+
+std::string ProgramCache::pathFor(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return dir + "/" + name;
+}
+
+GLuint ProgramCache::load(uint64_t key, const std::string& identity) const {
+    std::ifstream file(pathFor(key), std::ios::binary | std::ios::ate);
+    if (!file) return 0;
+    const std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+
+    EntryHeader header;
+    if (!file.read((char*)&header, sizeof(header)) ||
+        memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.key != key) {
+        return 0;
+    }
+
+    // The lengths come from the file: check them against what is really there
+    // before allocating, so a damaged entry is a miss and not a huge allocation
+    const std::streamoff remaining = fileSize - (std::streamoff)sizeof(header);
+    if (header.identityLength != identity.size() || header.length == 0 ||
+        (std::streamoff)header.identityLength + header.length != remaining) {
+        return 0;
+    }
+
+    std::string stored(header.identityLength, '\0');
+    if (!file.read(&stored[0], stored.size()) || stored != identity) return 0;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), header.length);
+
+    // Drivers reject binaries from other builds with a failed link status
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::store(uint64_t key, const std::string& identity, GLuint program) const {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+    EntryHeader header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.key = key;
+    header.format = format;
+    header.identityLength = (uint32_t)identity.size();
+    header.length = (uint32_t)length;
+
+    // Write to a temporary name first so a concurrent run never sees half an entry
+    std::string path = pathFor(key);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file) return;
+        file.write((const char*)&header, sizeof(header));
+        file.write(identity.data(), identity.size());
+        file.write(binary.data(), binary.size());
+        if (!file) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+}
+
+GLuint ProgramCache::getComputeProgram(const std::string& source, ProgramBuildInfo* info) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    auto it = programs.find(source);
+    if (it != programs.end()) {
+        if (info) *info = { false, true, 0.0 };
+        return it->second;
+    }
+
+    GLuint program = 0;
+    bool fromCache = false;
+    uint64_t key = 0;
+    std::string identity;
+    if (enabled()) {
+        key = keyFor(source);
+        identity = identityFor(source);
+        program = load(key, identity);
+        fromCache = program != 0;
+    }
+
+    if (!program) {
+        program = buildComputeProgram(source, enabled());
+        if (program && enabled()) store(key, identity, program);
+    }
+
+    if (program) programs.emplace(source, program);
+
+    if (info) {
+        std::chrono::duration<double, std::milli> ms = std::chrono::high_resolution_clock::now() - start;
+        *info = { fromCache, false, ms.count() };
+    }
+    return program;
+}
+
+void ProgramCache::releasePrograms() {
+    for (auto& entry : programs) glDeleteProgram(entry.second);
+    programs.clear();
+}
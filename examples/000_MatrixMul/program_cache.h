@@ -0,0 +1,57 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// How a program was obtained, for cold/warm startup reporting
+struct ProgramBuildInfo {
+    bool fromCache;  // loaded from the on-disk binary cache
+    bool reused;     // already built earlier in this process
+    double ms;
+};
+
+// Cache of linked compute programs, one per generated source (i.e. per
+// variant, shape and specialization).
+//
+// In memory, programs are kept for the lifetime of the context and shared by
+// every caller asking for the same source. On disk, binaries from
+// glGetProgramBinary are keyed by a hash of the final shader source (which
+// includes the injected defines) and the GL vendor, renderer and version
+// strings, so a driver update simply misses and recompiles. Each entry also
+// stores those strings and the source's hash, compared on load, so a file
+// name collision or a damaged entry misses too.
+class ProgramCache {
+public:
+    // An empty directory disables the on-disk cache
+    explicit ProgramCache(const std::string& directory);
+
+    // $XDG_CACHE_HOME/gpgpu_mm, or ~/.cache/gpgpu_mm
+    static std::string defaultDirectory();
+
+    bool enabled() const { return !dir.empty(); }
+    const std::string& directory() const { return dir; }
+
+    // Return the program for this source: built earlier, loaded from disk, or
+    // compiled and stored. Missing, stale or rejected disk entries fall back
+    // to compiling. The cache owns the program. 0 on failure.
+    GLuint getComputeProgram(const std::string& source, ProgramBuildInfo* info = nullptr);
+
+    // Delete all programs; must be called while the context is still current
+    void releasePrograms();
+
+private:
+    uint64_t keyFor(const std::string& source) const;
+    std::string identityFor(const std::string& source) const;
+    std::string pathFor(uint64_t key) const;
+    GLuint load(uint64_t key, const std::string& identity) const;
+    void store(uint64_t key, const std::string& identity, GLuint program) const;
+
+    std::string dir;
+    std::string driverId;
+    std::unordered_map<std::string, GLuint> programs;
+};
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,88 @@
+#include "report.h"
+
+#include <cmath>
+#include <cstdio>
+
+static std::string escape(const std::string& s) {
+    std::string r;
+    for (char c : s) {
+        switch (c) {
+            case '"': r += "\\\""; break;
+            case '\\': r += "\\\\"; break;
+            case '\n': r += "\\n"; break;
+            case '\t': r += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    r += buf;
+                } else {
+                    r += c;
+                }
+        }
+    }
+    return r;
+}
+
+void JsonWriter::prefix(const char* key) {
+    if (!hasItems.empty()) {
+        if (hasItems.back()) out << ",";
+        hasItems.back() = true;
+        out << "\n" << std::string(hasItems.size() * 2, ' ');
+    }
+    if (key) out << "\"" << escape(key) << "\": ";
+}
+
+void JsonWriter::beginObject(const char* key) {
+    prefix(key);
+    out << "{";
+    hasItems.push_back(false);
+}
+
+void JsonWriter::endObject() {
+    bool items = hasItems.back();
+    hasItems.pop_back();
+    if (items) out << "\n" << std::string(hasItems.size() * 2, ' ');
+    out << "}";
+    if (hasItems.empty()) out << "\n";
+}
+
+void JsonWriter::beginArray(const char* key) {
+    prefix(key);
+    out << "[";
+    hasItems.push_back(false);
+}
+
+void JsonWriter::endArray() {
+    bool items = hasItems.back();
+    hasItems.pop_back();
+    if (items) out << "\n" << std::string(hasItems.size() * 2, ' ');
+    out << "]";
+}
+
+void JsonWriter::value(const char* key, const std::string& v) {
+    prefix(key);
+    out << "\"" << escape(v) << "\"";
+}
+
+void JsonWriter::value(const char* key, double v) {
+    prefix(key);
+    // JSON has no NaN/Inf; unavailable measurements are reported as null
+    if (std::isfinite(v)) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.6g", v);
+        out << buf;
+    } else {
+        out << "null";
+    }
+}
+
+void JsonWriter::value(const char* key, int v) {
+    prefix(key);
+    out << v;
+}
+
+void JsonWriter::value(const char* key, bool v) {
+    prefix(key);
+    out << (v ? "true" : "false");
+}
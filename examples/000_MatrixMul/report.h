@@ -0,0 +1,32 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Minimal streaming JSON writer for the machine-readable benchmark report.
+// Commas and nesting are tracked internally; keys are only valid inside objects.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream& out) : out(out) {}
+
+    void beginObject(const char* key = nullptr);
+    void endObject();
+    void beginArray(const char* key = nullptr);
+    void endArray();
+
+    void value(const char* key, const std::string& v);
+    void value(const char* key, const char* v) { value(key, std::string(v)); }
+    void value(const char* key, double v);
+    void value(const char* key, int v);
+    void value(const char* key, bool v);
+
+private:
+    void prefix(const char* key);
+
+    std::ostream& out;
+    std::vector<bool> hasItems; // one entry per open object/array
+};
+
+#endif // REPORT_H
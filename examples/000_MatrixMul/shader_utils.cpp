@@ -0,0 +1,95 @@
+#include "shader_utils.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::string loadShader(const char* filename) {
+    std::ifstream file(filename);
+    if (!file) return "";
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::string injectDefines(const std::string& source, const std::vector<std::string>& defines) {
+    if (defines.empty()) return source;
+
+    std::string block;
+    for (const std::string& d : defines) {
+        block += "#define " + d + "\n";
+    }
+
+    // #version must stay the first statement, so the defines go right after it
+    size_t pos = source.find("#version");
+    if (pos == std::string::npos) return block + source;
+    size_t eol = source.find('\n', pos);
+    if (eol == std::string::npos) return source + "\n" + block;
+    return source.substr(0, eol + 1) + block + source.substr(eol + 1);
+}
+
+// Compile one stage; 0 and the log printed on failure
+static GLuint compileShader(GLenum type, const std::string& source) {
+    const char* src = source.c_str();
+
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cerr << "Shader Error: " << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Link the attached shaders, which are released either way
+static GLuint linkProgram(GLuint program) {
+    glLinkProgram(program);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cerr << "Link Error: " << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+GLuint buildComputeProgram(const std::string& source, bool retrievable) {
+    GLuint shader = compileShader(GL_COMPUTE_SHADER, source);
+    if (!shader) return 0;
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    if (retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glDeleteShader(shader);
+    return linkProgram(program);
+}
+
+GLuint buildRenderProgram(const std::string& vertexSource, const std::string& fragmentSource,
+                          const char* positionAttribute) {
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSource);
+    if (!vs) return 0;
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!fs) {
+        glDeleteShader(vs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glBindAttribLocation(program, 0, positionAttribute);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    return linkProgram(program);
+}
@@ -0,0 +1,24 @@
+#ifndef SHADER_UTILS_H
+#define SHADER_UTILS_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Read a shader file from the working directory ("" if missing)
+std::string loadShader(const char* filename);
+
+// Insert "#define ..." lines directly after the #version directive.
+// Each entry is the text following "#define", e.g. "ROWS 4".
+std::string injectDefines(const std::string& source, const std::vector<std::string>& defines);
+
+// Compile and link a compute program. Returns 0 and prints the log on failure.
+// `retrievable` sets GL_PROGRAM_BINARY_RETRIEVABLE_HINT for the binary cache.
+GLuint buildComputeProgram(const std::string& source, bool retrievable = false);
+
+// Compile and link a vertex + fragment program (GLSL ES 1.00 for the GLES2
+// backend), binding `positionAttribute` to location 0. 0 on failure.
+GLuint buildRenderProgram(const std::string& vertexSource, const std::string& fragmentSource,
+                          const char* positionAttribute);
+
+#endif // SHADER_UTILS_H
@@ -0,0 +1,210 @@
+#include "streaming.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const int RING_SIZE = 3;   // batch i+2 written, i+1 computing, i read back
+const int POOL_SIZE = 4;   // distinct input pairs cycled through the stream
+const int SPOT_CHECKS = 16;
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Stand-in for the producer: a few pre-generated pairs are cycled so that
+// each batch copies fresh data into the GPU buffers.
+struct InputPool {
+    std::vector<std::vector<float>> A, B;
+
+    explicit InputPool(const Shape& s) : A(POOL_SIZE), B(POOL_SIZE) {
+        for (int p = 0; p < POOL_SIZE; p++) {
+            A[p].resize(s.sizeA());
+            B[p].resize(s.sizeB());
+            for (float& x : A[p]) x = static_cast<float>(rand()) / RAND_MAX;
+            for (float& x : B[p]) x = static_cast<float>(rand()) / RAND_MAX;
+        }
+    }
+};
+
+// Compare a few elements of C against CPU dot products (full O(n^3)
+// verification of every batch would dominate the stream).
+double spotCheck(const float* C, const std::vector<float>& A, const std::vector<float>& B,
+                 const Shape& sh, int batch) {
+    double maxError = 0.0;
+    for (int s = 0; s < SPOT_CHECKS; s++) {
+        int row = (batch * 131 + s * 977) % sh.M;
+        int col = (batch * 17 + s * 389) % sh.N;
+        float ref = 0.0f;
+        for (int k = 0; k < sh.K; k++) ref += A[(size_t)row * sh.K + k] * B[(size_t)k * sh.N + col];
+        maxError = std::max(maxError, (double)std::abs(ref - C[(size_t)row * sh.N + col]));
+    }
+    return maxError;
+}
+
+// Returns the ms spent blocked, or -1 if the wait failed
+double waitFence(GLsync& fence) {
+    auto start = Clock::now();
+    GLenum status;
+    do {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    } while (status == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(fence);
+    fence = 0;
+    if (status == GL_WAIT_FAILED) return -1;
+    std::chrono::duration<double, std::milli> d = Clock::now() - start;
+    return d.count();
+}
+
+struct BufferSet {
+    GLuint buf[3];  // A, B, C
+    float* ptr[3];
+    GLsync fence;
+};
+
+bool createSet(BufferSet& s, const Shape& sh) {
+    const GLbitfield inFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLbitfield outFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    const size_t bytes[3] = { sh.sizeA() * sizeof(float), sh.sizeB() * sizeof(float),
+                              sh.sizeC() * sizeof(float) };
+
+    s.fence = 0;
+    glGenBuffers(3, s.buf);
+    for (int i = 0; i < 3; i++) {
+        GLbitfield flags = i < 2 ? inFlags : outFlags;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s.buf[i]);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, bytes[i], NULL, flags);
+        s.ptr[i] = (float*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bytes[i], flags);
+        if (!s.ptr[i]) {
+            std::cerr << "Error: persistent glMapBufferRange failed" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void destroySet(BufferSet& s) {
+    if (s.fence) glDeleteSync(s.fence);
+    for (int i = 0; i < 3; i++) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s.buf[i]);
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    }
+    glDeleteBuffers(3, s.buf);
+}
+
+StreamResult finish(int batches, Clock::time_point start, double waitMs, double maxError, bool ok) {
+    std::chrono::duration<double> d = Clock::now() - start;
+    StreamResult r;
+    r.batches = batches;
+    r.seconds = d.count();
+    r.matricesPerSecond = batches / d.count();
+    r.fenceWaitMs = waitMs;
+    r.maxError = maxError;
+    r.ok = ok;
+    return r;
+}
+
+} // namespace
+
+bool streamingSupported() {
+    return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+StreamResult runStreaming(const GemmKernel& kernel, int batches) {
+    const Shape& sh = kernel.shape;
+    InputPool pool(sh);
+    std::vector<float> result(sh.sizeC());
+
+    BufferSet ring[RING_SIZE];
+    int created = 0;
+    bool ok = true;
+    while (created < RING_SIZE && ok) ok = createSet(ring[created++], sh);
+    if (!ok) {
+        for (int s = 0; s < created; s++) destroySet(ring[s]);
+        return finish(0, Clock::now(), 0.0, 0.0, false);
+    }
+
+    double waitMs = 0.0;
+    double maxError = 0.0;
+    auto start = Clock::now();
+
+    // Iteration t: fill + dispatch batch t, then read back batch t-2.
+    // Slot t%3 last held batch t-3, which was read back in iteration t-1.
+    for (int t = 0; t < batches + 2 && ok; t++) {
+        if (t < batches) {
+            BufferSet& s = ring[t % RING_SIZE];
+            memcpy(s.ptr[0], pool.A[t % POOL_SIZE].data(), sh.sizeA() * sizeof(float));
+            memcpy(s.ptr[1], pool.B[t % POOL_SIZE].data(), sh.sizeB() * sizeof(float));
+
+            for (int i = 0; i < 3; i++) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, s.buf[i]);
+            kernel.dispatch();
+            // Make the shader's writes to C visible through the persistent mapping
+            glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+            s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        int done = t - 2;
+        if (done >= 0) {
+            BufferSet& s = ring[done % RING_SIZE];
+            double w = waitFence(s.fence);
+            if (w < 0) {
+                std::cerr << "Error: glClientWaitSync failed on batch " << done << std::endl;
+                ok = false;
+                break;
+            }
+            waitMs += w;
+            memcpy(result.data(), s.ptr[2], sh.sizeC() * sizeof(float));
+            maxError = std::max(maxError, spotCheck(result.data(), pool.A[done % POOL_SIZE],
+                                                    pool.B[done % POOL_SIZE], sh, done));
+        }
+    }
+
+    StreamResult r = finish(batches, start, waitMs, maxError, ok);
+    for (int s = 0; s < RING_SIZE; s++) destroySet(ring[s]);
+    return r;
+}
+
+StreamResult runStreamingNaive(const GemmKernel& kernel, int batches) {
+    const Shape& sh = kernel.shape;
+    const size_t bytes[3] = { sh.sizeA() * sizeof(float), sh.sizeB() * sizeof(float),
+                              sh.sizeC() * sizeof(float) };
+    InputPool pool(sh);
+    std::vector<float> result(sh.sizeC());
+
+    GLuint ssbo[3];
+    glGenBuffers(3, ssbo);
+
+    bool ok = true;
+    double maxError = 0.0;
+    auto start = Clock::now();
+
+    for (int t = 0; t < batches && ok; t++) {
+        const float* data[3] = { pool.A[t % POOL_SIZE].data(), pool.B[t % POOL_SIZE].data(), NULL };
+        for (int i = 0; i < 3; i++) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[i]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, bytes[i], data[i], i < 2 ? GL_STATIC_DRAW : GL_DYNAMIC_COPY);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, ssbo[i]);
+        }
+        kernel.dispatch();
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        float* ptr = (float*)glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
+        if (ptr) memcpy(result.data(), ptr, bytes[2]);
+        else ok = false;
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+
+        if (ok) {
+            maxError = std::max(maxError, spotCheck(result.data(), pool.A[t % POOL_SIZE],
+                                                    pool.B[t % POOL_SIZE], sh, t));
+        }
+    }
+
+    StreamResult r = finish(batches, start, 0.0, maxError, ok);
+    glDeleteBuffers(3, ssbo);
+    return r;
+}
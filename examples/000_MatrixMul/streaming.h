@@ -0,0 +1,28 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include "variants.h"
+
+// Sustained throughput of a stream of independent multiplies of one shape
+struct StreamResult {
+    int batches;
+    double seconds;
+    double matricesPerSecond;
+    double fenceWaitMs;  // time the CPU spent blocked on the GPU
+    double maxError;     // worst spot-check error against a CPU dot product
+    bool ok;
+};
+
+// Whether glBufferStorage (GL 4.4 / ARB_buffer_storage) is available
+bool streamingSupported();
+
+// Persistent-mapped, triple-buffered path: three A/B/C buffer sets created
+// once with glBufferStorage(PERSISTENT | COHERENT) and guarded by fences, so
+// the CPU fills batch i+2 while the GPU computes i+1 and the CPU reads back i.
+StreamResult runStreaming(const GemmKernel& kernel, int batches);
+
+// Reference: what the one-shot path does per pair (glBufferData + blocking
+// glMapBuffer readback), run over the same stream.
+StreamResult runStreamingNaive(const GemmKernel& kernel, int batches);
+
+#endif // STREAMING_H
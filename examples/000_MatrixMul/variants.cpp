@@ -0,0 +1,107 @@
+#include "variants.h"
+
+#include <iostream>
+
+#include "program_cache.h"
+#include "shader_utils.h"
+
+const std::vector<KernelVariant>& kernelVariants() {
+    static const std::vector<KernelVariant> variants = {
+        { "naive",   "compute.glsl",          {},                             32, 32, 1, 1, false, false, false,
+          "one output per invocation, A and B from SSBOs" },
+        { "tiled",   "compute_tiled.glsl",    {},                             16, 16, 1, 1, false, false, true,
+          "16x16 shared-memory tiles with barrier()" },
+        { "reg4x4",  "compute_regblock.glsl", { "ROWS 4" },                   16, 16, 4, 4, false, false, false,
+          "4x4 block per invocation in vec4 registers" },
+        { "reg8x4",  "compute_regblock.glsl", { "ROWS 8" },                   16, 16, 4, 8, false, false, false,
+          "8x4 block per invocation in vec4 registers" },
+        { "tex4x4",  "compute_regblock.glsl", { "ROWS 4", "B_FROM_TEXTURE" }, 16, 16, 4, 4, true,  false, false,
+          "4x4 register block, B through the texture cache" },
+        { "half4x4", "compute_regblock.glsl", { "ROWS 4", "HALF_STORAGE" },   16, 16, 4, 4, false, true,  false,
+          "reg4x4 with A and B stored as packed fp16" },
+        { "half8x4", "compute_regblock.glsl", { "ROWS 8", "HALF_STORAGE" },   16, 16, 4, 8, false, true,  false,
+          "reg8x4 with A and B stored as packed fp16" },
+    };
+    return variants;
+}
+
+const KernelVariant* findVariant(const std::string& name) {
+    for (const KernelVariant& v : kernelVariants()) {
+        if (name == v.name) return &v;
+    }
+    return nullptr;
+}
+
+static void resolveLocal(const KernelVariant& v, const Specialization& sp, int& lx, int& ly) {
+    lx = sp.localX > 0 ? sp.localX : v.localX;
+    ly = sp.localY > 0 ? sp.localY : v.localY;
+}
+
+bool variantSupports(const KernelVariant& v, const Shape& s, const Specialization& sp, std::string* why) {
+    int lx, ly;
+    resolveLocal(v, sp, lx, ly);
+
+    const char* reason = nullptr;
+    if (s.M <= 0 || s.N <= 0 || s.K <= 0) reason = "empty shape";
+    else if (sp.unroll < 1) reason = "unroll factor must be >= 1";
+    else if (lx * ly > 1024) reason = "workgroup larger than 1024 invocations";
+    // The vec4 kernels load B/C four columns and A four k-steps at a time
+    else if (v.blockX > 1 && (s.N % 4 != 0 || s.K % 4 != 0)) reason = "N and K must be multiples of 4";
+    // Shared tiles are square: the workgroup is the tile
+    else if (v.squareTile && lx != ly) reason = "tiled needs a square workgroup";
+
+    if (reason && why) *why = reason;
+    return reason == nullptr;
+}
+
+std::string generateVariantSource(const KernelVariant& v, const Shape& s, const Specialization& sp) {
+    std::string sourceStr = loadShader(v.file);
+    if (sourceStr.empty()) {
+        std::cerr << "Error: " << v.file << " not found!" << std::endl;
+        return "";
+    }
+
+    int lx, ly;
+    resolveLocal(v, sp, lx, ly);
+
+    std::vector<std::string> defines = v.defines;
+    defines.push_back("M " + std::to_string(s.M));
+    defines.push_back("N " + std::to_string(s.N));
+    defines.push_back("K " + std::to_string(s.K));
+    defines.push_back("LOCAL_X " + std::to_string(lx));
+    defines.push_back("LOCAL_Y " + std::to_string(ly));
+    defines.push_back("UNROLL " + std::to_string(sp.unroll));
+    if (sp.accumulate) defines.push_back("ACCUMULATE");
+    return injectDefines(sourceStr, defines);
+}
+
+bool buildGemmKernel(const KernelVariant& v, const Shape& s, const Specialization& sp,
+                     ProgramCache& cache, GemmKernel& out, ProgramBuildInfo* info) {
+    std::string source = generateVariantSource(v, s, sp);
+    if (source.empty()) return false;
+
+    out.variant = &v;
+    out.shape = s;
+    resolveLocal(v, sp, out.localX, out.localY);
+    out.program = cache.getComputeProgram(source, info);
+    return out.program != 0;
+}
+
+void GemmKernel::dispatch() const {
+    glUseProgram(program);
+    glDispatchCompute(variantGroups(shape.N, localX, variant->blockX),
+                      variantGroups(shape.M, localY, variant->blockY), 1);
+}
+
+GLuint createTextureB(const float* B, const Shape& s) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // Row k of B becomes one texel row: texel (c4, k) = B[k][4*c4 .. 4*c4+3]
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, s.N / 4, s.K, 0, GL_RGBA, GL_FLOAT, B);
+    return tex;
+}
@@ -0,0 +1,78 @@
+#ifndef VARIANTS_H
+#define VARIANTS_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+class ProgramCache;
+struct ProgramBuildInfo;
+
+// One compute-shader GEMM implementation selectable at runtime
+struct KernelVariant {
+    const char* name;
+    const char* file;                 // shader source in the working directory
+    std::vector<std::string> defines; // variant defines, injected after #version
+    int localX, localY;               // default workgroup size
+    int blockX, blockY;               // C elements computed per invocation
+    bool bFromTexture;                // B is sampled from an RGBA32F texture
+    bool halfStorage;                 // A and B uploaded as packed fp16 pairs
+    bool squareTile;                  // workgroup doubles as a square shared tile
+    const char* description;
+};
+
+// Problem shape: C (M x N) = A (M x K) * B (K x N), all row-major
+struct Shape {
+    int M, N, K;
+
+    size_t sizeA() const { return (size_t)M * K; }
+    size_t sizeB() const { return (size_t)K * N; }
+    size_t sizeC() const { return (size_t)M * N; }
+    double flops() const { return 2.0 * M * N * K; }
+};
+
+// Tuning knobs baked into the generated source next to the shape
+struct Specialization {
+    int unroll;          // K-loop unroll factor
+    int localX, localY;  // workgroup size; 0 = the variant's default
+    bool accumulate;     // C += A * B, for K split across dispatches
+};
+
+const std::vector<KernelVariant>& kernelVariants();
+
+// nullptr if no variant has this name
+const KernelVariant* findVariant(const std::string& name);
+
+// Whether the variant can run this shape/specialization; `why` gets the reason
+bool variantSupports(const KernelVariant& v, const Shape& s, const Specialization& sp,
+                     std::string* why = nullptr);
+
+// Variant source with the variant, shape and tuning #defines injected.
+// "" if the shader file is missing.
+std::string generateVariantSource(const KernelVariant& v, const Shape& s, const Specialization& sp);
+
+// A variant specialized and built for one problem shape
+struct GemmKernel {
+    const KernelVariant* variant;
+    Shape shape;
+    int localX, localY;  // resolved workgroup size
+    GLuint program;      // owned by the ProgramCache
+
+    // Bind the program and launch enough workgroups to cover C
+    void dispatch() const;
+};
+
+// Generate and build (or fetch from the cache) the program for one shape
+bool buildGemmKernel(const KernelVariant& v, const Shape& s, const Specialization& sp,
+                     ProgramCache& cache, GemmKernel& out, ProgramBuildInfo* info = nullptr);
+
+// Number of workgroups needed to cover one dimension of C
+inline int variantGroups(int extent, int local, int block) {
+    int perGroup = local * block;
+    return (extent + perGroup - 1) / perGroup;
+}
+
+// Create the N/4 x K RGBA32F texture the texture variants sample B from
+GLuint createTextureB(const float* B, const Shape& s);
+
+#endif // VARIANTS_H
@@ -0,0 +1,90 @@
+#version 430 core
+
+// GPU-side probabilistic check of C = A * B (Freivalds): for a random
+// vector x, C*x must equal A*(B*x) up to rounding. Two matrix-vector passes
+// cost O(MK + KN + MN) instead of the O(MNK) CPU reference, and only the
+// maximum residuals (two uints) are read back.
+//
+// Injected defines:
+//   M, N, K          shape of the multiply being checked
+//   STAGE_BX         pass 1, one invocation per k:  y[k] = (B*x, |B|*|x|)[k]
+//   STAGE_RESIDUAL   pass 2, one invocation per row: |C*x - A*y| / (|A|*|y|)
+//                    and |C*x - A*y|, max-reduced in shared memory, then
+//                    atomicMax into maxBits and maxAbsBits
+//   HALF_STORAGE     A and B hold packed fp16 pairs (as in the variant)
+//   B_FROM_TEXTURE   B lives in the RGBA32F texture (as in the variant)
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// Same bindings as the GEMM, viewed as scalars
+#ifdef HALF_STORAGE
+layout(std430, binding = 0) readonly buffer BufferA { uint A[]; };
+float loadA(int i) { return unpackHalf2x16(A[i >> 1])[i & 1]; }
+#else
+layout(std430, binding = 0) readonly buffer BufferA { float A[]; };
+float loadA(int i) { return A[i]; }
+#endif
+
+#if defined(B_FROM_TEXTURE)
+layout(binding = 0) uniform sampler2D texB;
+float loadB(int k, int col) { return texelFetch(texB, ivec2(col >> 2, k), 0)[col & 3]; }
+#elif defined(HALF_STORAGE)
+layout(std430, binding = 1) readonly buffer BufferB { uint B[]; };
+float loadB(int k, int col) { int i = k * N + col; return unpackHalf2x16(B[i >> 1])[i & 1]; }
+#else
+layout(std430, binding = 1) readonly buffer BufferB { float B[]; };
+float loadB(int k, int col) { return B[k * N + col]; }
+#endif
+
+layout(std430, binding = 2) readonly buffer BufferC { float C[]; };
+layout(std430, binding = 3) readonly buffer BufferX { float x[]; };
+layout(std430, binding = 4) buffer BufferY { vec2 y[]; };
+// Non-negative floats order like their bit patterns, so atomicMax on the bits is a float max
+layout(std430, binding = 5) buffer Result { uint maxBits; uint maxAbsBits; };
+
+#ifdef STAGE_RESIDUAL
+shared vec2 partial[256];
+#endif
+
+void main() {
+    int i = int(gl_GlobalInvocationID.x);
+
+#ifdef STAGE_BX
+    if (i >= K) return;
+    vec2 acc = vec2(0.0);
+    for (int col = 0; col < N; col++) {
+        float b = loadB(i, col);
+        acc += vec2(b * x[col], abs(b * x[col]));
+    }
+    y[i] = acc;
+#endif
+
+#ifdef STAGE_RESIDUAL
+    vec2 residual = vec2(0.0);  // (normalised, absolute)
+    if (i < M) {
+        float ay = 0.0, bound = 0.0, cx = 0.0;
+        for (int k = 0; k < K; k++) {
+            float a = loadA(i * K + k);
+            ay += a * y[k].x;
+            bound += abs(a) * y[k].y;
+        }
+        for (int col = 0; col < N; col++) cx += C[i * N + col] * x[col];
+        residual = vec2(abs(cx - ay) / max(bound, 1e-30), abs(cx - ay));
+        // A NaN or Inf anywhere must fail the check, not vanish in max()
+        if (!(residual.x <= 3.0e38)) residual.x = 3.0e38;
+        if (!(residual.y <= 3.0e38)) residual.y = 3.0e38;
+    }
+
+    uint lid = gl_LocalInvocationID.x;
+    partial[lid] = residual;
+    barrier();
+    for (uint stride = 128u; stride > 0u; stride >>= 1) {
+        if (lid < stride) partial[lid] = max(partial[lid], partial[lid + stride]);
+        barrier();
+    }
+    if (lid == 0u) {
+        atomicMax(maxBits, floatBitsToUint(partial[0].x));
+        atomicMax(maxAbsBits, floatBitsToUint(partial[0].y));
+    }
+#endif
+}
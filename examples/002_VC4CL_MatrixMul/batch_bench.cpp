@@ -0,0 +1,208 @@
+/**
+ * Serial vs pipelined batch of products
+ */
+
+#include "batch_bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_common.h"
+#include "host_buffers.h"
+
+// One buffer set of the bounded pool. Its inputs stay constant for the
+// stream, so non-blocking writes may read them at any time; host_c is
+// consumed before the set is reused.
+typedef struct {
+    cl_mem a, b, c;
+    float* host_a;
+    float* host_b;
+    float* host_c;
+    cl_event written[2];      // A and B uploads
+    cl_event computed;
+    cl_event read;            // NULL while no product is in flight
+} batch_slot_t;
+
+// Upload, compute and readback each get an in-order queue; events order
+// the stages of one product, the queues let different products overlap
+enum { BATCH_UPLOAD, BATCH_COMPUTE, BATCH_READBACK, BATCH_QUEUES };
+
+static void batch_slot_release_events(batch_slot_t* s) {
+    cl_event* events[4] = { &s->written[0], &s->written[1], &s->computed, &s->read };
+    for (int i = 0; i < 4; i++) {
+        if (*events[i]) clReleaseEvent(*events[i]);
+        *events[i] = NULL;
+    }
+}
+
+// What a consumer of the stream does with C before handing the set back
+static double batch_consume(const batch_slot_t* s, size_t count) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) sum += s->host_c[i];
+    return sum;
+}
+
+// Each product waits for the previous one: blocking write, launch, blocking read
+static cl_int batch_run_serial(cl_command_queue queue, cl_kernel kernel, const gemm_geometry_t* g,
+                               const gemm_shape_t* shape, batch_slot_t* slots, int num_slots, int count,
+                               double* checksum) {
+    const size_t a_bytes = (size_t)shape->m * shape->k * sizeof(float);
+    const size_t b_bytes = (size_t)shape->k * shape->n * sizeof(float);
+    const size_t c_count = (size_t)shape->m * shape->n;
+    cl_int err = CL_SUCCESS;
+
+    *checksum = 0.0;
+    for (int i = 0; i < count && err == CL_SUCCESS; i++) {
+        batch_slot_t* s = &slots[i % num_slots];
+        const gemm_launch_t l = { s->a, s->b, s->c, *shape };
+        err = clEnqueueWriteBuffer(queue, s->a, CL_TRUE, 0, a_bytes, s->host_a, 0, NULL, NULL);
+        if (err == CL_SUCCESS) err = clEnqueueWriteBuffer(queue, s->b, CL_TRUE, 0, b_bytes, s->host_b, 0, NULL, NULL);
+        if (err == CL_SUCCESS) err = enqueue_gemm(queue, kernel, g, &l, 0, NULL, NULL);
+        if (err == CL_SUCCESS) {
+            err = clEnqueueReadBuffer(queue, s->c, CL_TRUE, 0, c_count * sizeof(float), s->host_c, 0, NULL, NULL);
+        }
+        if (err == CL_SUCCESS) *checksum += batch_consume(s, c_count);
+    }
+    clFinish(queue);
+    return err;
+}
+
+// Product i goes to set i % num_slots. Before a set is reused, the host
+// waits for its readback and consumes C, which also guarantees the previous
+// kernel is done with A, B and C. Products are consumed in order, so the
+// checksum adds up exactly like the serial one.
+static cl_int batch_run_pipelined(cl_command_queue queues[BATCH_QUEUES], cl_kernel kernel, const gemm_geometry_t* g,
+                                  const gemm_shape_t* shape, batch_slot_t* slots, int num_slots, int count,
+                                  double* checksum) {
+    const size_t a_bytes = (size_t)shape->m * shape->k * sizeof(float);
+    const size_t b_bytes = (size_t)shape->k * shape->n * sizeof(float);
+    const size_t c_count = (size_t)shape->m * shape->n;
+    cl_int err = CL_SUCCESS;
+
+    *checksum = 0.0;
+    for (int i = 0; i < count && err == CL_SUCCESS; i++) {
+        batch_slot_t* s = &slots[i % num_slots];
+        if (s->read) {
+            err = clWaitForEvents(1, &s->read);
+            if (err != CL_SUCCESS) break;
+            *checksum += batch_consume(s, c_count);
+            batch_slot_release_events(s);
+        }
+
+        const gemm_launch_t l = { s->a, s->b, s->c, *shape };
+        err = clEnqueueWriteBuffer(queues[BATCH_UPLOAD], s->a, CL_FALSE, 0, a_bytes, s->host_a,
+                                   0, NULL, &s->written[0]);
+        if (err == CL_SUCCESS) {
+            err = clEnqueueWriteBuffer(queues[BATCH_UPLOAD], s->b, CL_FALSE, 0, b_bytes, s->host_b,
+                                       0, NULL, &s->written[1]);
+        }
+        if (err == CL_SUCCESS) err = enqueue_gemm(queues[BATCH_COMPUTE], kernel, g, &l, 2, s->written, &s->computed);
+        if (err == CL_SUCCESS) {
+            err = clEnqueueReadBuffer(queues[BATCH_READBACK], s->c, CL_FALSE, 0, c_count * sizeof(float), s->host_c,
+                                      1, &s->computed, &s->read);
+        }
+
+        // Commands waiting on another queue's events only make progress
+        // once that queue has been flushed
+        for (int q = 0; q < BATCH_QUEUES; q++) clFlush(queues[q]);
+    }
+
+    // Drain the products still in flight, oldest first
+    const int first = count > num_slots ? count - num_slots : 0;
+    for (int i = first; i < count; i++) {
+        batch_slot_t* s = &slots[i % num_slots];
+        if (!s->read) continue;
+        if (err == CL_SUCCESS) err = clWaitForEvents(1, &s->read);
+        if (err == CL_SUCCESS) *checksum += batch_consume(s, c_count);
+    }
+    for (int q = 0; q < BATCH_QUEUES; q++) clFinish(queues[q]);
+    for (int i = 0; i < num_slots; i++) batch_slot_release_events(&slots[i]);
+    return err;
+}
+
+void run_batch_bench(const batch_bench_params_t* p) {
+    const cl_context context = p->context;
+    const cl_kernel kernel = p->kernel;
+    const gemm_variant_t* v = p->variant;
+    const gemm_shape_t* shape = &p->shape;
+    const int count = p->count;
+    const int num_slots = p->slots;
+    const gemm_geometry_t g = variant_geometry(v, p->config);
+    const size_t a_bytes = (size_t)shape->m * shape->k * sizeof(float);
+    const size_t b_bytes = (size_t)shape->k * shape->n * sizeof(float);
+    const size_t c_bytes = (size_t)shape->m * shape->n * sizeof(float);
+    cl_command_queue queues[BATCH_QUEUES] = { NULL };
+    batch_slot_t* slots = (batch_slot_t*)calloc(num_slots, sizeof(batch_slot_t));
+    double serial_ms = 0.0, pipelined_ms = 0.0, serial_sum = 0.0, pipelined_sum = 0.0;
+    cl_int err = slots ? CL_SUCCESS : CL_OUT_OF_HOST_MEMORY;
+
+    for (int q = 0; q < BATCH_QUEUES && err == CL_SUCCESS; q++) {
+        queues[q] = clCreateCommandQueue(context, p->device, 0, &err);
+    }
+    for (int i = 0; i < num_slots && err == CL_SUCCESS; i++) {
+        batch_slot_t* s = &slots[i];
+        s->a = clCreateBuffer(context, CL_MEM_READ_ONLY, a_bytes, NULL, &err);
+        if (err == CL_SUCCESS) s->b = clCreateBuffer(context, CL_MEM_READ_ONLY, b_bytes, NULL, &err);
+        if (err == CL_SUCCESS) s->c = clCreateBuffer(context, CL_MEM_WRITE_ONLY, c_bytes, NULL, &err);
+        if (err != CL_SUCCESS) break;
+        s->host_a = host_matrix_alloc(a_bytes);
+        s->host_b = host_matrix_alloc(b_bytes);
+        s->host_c = host_matrix_alloc(c_bytes);
+        if (!s->host_a || !s->host_b || !s->host_c) {
+            err = CL_OUT_OF_HOST_MEMORY;
+            break;
+        }
+        fill_matrix(s->host_a, a_bytes / sizeof(float), 2 * i);
+        fill_matrix(s->host_b, b_bytes / sizeof(float), 2 * i + 1);
+    }
+
+    printf("--- Batch Pipeline (variant %s, %d products of %d x %d x %d, %d buffer sets) ---\n",
+           v->name, count, shape->m, shape->n, shape->k, num_slots);
+    printf("Serial: one queue, blocking upload -> kernel -> readback per product\n");
+    printf("Pipelined: upload, compute and readback queues linked by events\n\n");
+
+    // Warm-up: first launch and first touch of every buffer set
+    if (err == CL_SUCCESS) err = batch_run_serial(queues[0], kernel, &g, shape, slots, num_slots, num_slots, &serial_sum);
+    if (err == CL_SUCCESS) {
+        double start = get_time_ms();
+        err = batch_run_serial(queues[0], kernel, &g, shape, slots, num_slots, count, &serial_sum);
+        serial_ms = get_time_ms() - start;
+    }
+    if (err == CL_SUCCESS) {
+        double start = get_time_ms();
+        err = batch_run_pipelined(queues, kernel, &g, shape, slots, num_slots, count, &pipelined_sum);
+        pipelined_ms = get_time_ms() - start;
+    }
+
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Batch run failed (%s)\n\n", cl_error_string(err));
+    } else {
+        const double flops = gemm_flops(shape) * count;
+        const double bytes = (double)(a_bytes + b_bytes + c_bytes) * count;
+        const double ms[2] = { serial_ms, pipelined_ms };
+        const char* names[2] = { "serial", "pipelined" };
+        printf("%-10s %10s %12s %12s %9s %9s\n", "Flow", "Total ms", "ms/product", "products/s", "GFLOPS", "GB/s");
+        for (int f = 0; f < 2; f++) {
+            printf("%-10s %10.2f %12.3f %12.1f %9.3f %9.3f\n", names[f], ms[f], ms[f] / count,
+                   count / (ms[f] * 1e-3), flops / (ms[f] * 1e6), bytes / (ms[f] * 1e6));
+        }
+        const int match = fabs(pipelined_sum - serial_sum) <= 1e-6 * fabs(serial_sum);
+        printf("Pipelined speedup: %.2fx (%s)\n\n", serial_ms / pipelined_ms,
+               match ? "results match" : "results differ!");
+    }
+
+    for (int i = 0; slots && i < num_slots; i++) {
+        batch_slot_release_events(&slots[i]);
+        if (slots[i].a) clReleaseMemObject(slots[i].a);
+        if (slots[i].b) clReleaseMemObject(slots[i].b);
+        if (slots[i].c) clReleaseMemObject(slots[i].c);
+        free(slots[i].host_a);
+        free(slots[i].host_b);
+        free(slots[i].host_c);
+    }
+    free(slots);
+    for (int q = 0; q < BATCH_QUEUES; q++) {
+        if (queues[q]) clReleaseCommandQueue(queues[q]);
+    }
+}
@@ -0,0 +1,36 @@
+/**
+ * Serial vs pipelined batch of products (--batch)
+ *
+ * Streams independent products of one shape through a bounded pool of
+ * buffer sets: once serially on one queue, once with upload, compute and
+ * readback on three queues linked by events, so the transfers of one
+ * product overlap the kernel of another.
+ */
+
+#ifndef BATCH_BENCH_H
+#define BATCH_BENCH_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+
+#include "gemm_kernels.h"
+
+typedef struct {
+    cl_context context;
+    cl_device_id device;
+    cl_kernel kernel;         // built for `variant` under `config`
+    const gemm_variant_t* variant;  // one that reads float B, not B^T or half
+    const gemm_config_t* config;
+    gemm_shape_t shape;
+    int count;                // products streamed
+    int slots;                // buffer sets in the pool, 2 to 8
+} batch_bench_params_t;
+
+// Stream `count` independent products of `shape` through `slots` buffer
+// sets, once serially on one queue and once pipelined over three, and
+// report sustained throughput of both
+void run_batch_bench(const batch_bench_params_t* p);
+
+#endif // BATCH_BENCH_H
@@ -0,0 +1,231 @@
+/**
+ * Pieces shared by the benchmark modes
+ */
+
+#include "bench_common.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// Timing, Errors and Results
+// ============================================================================
+
+double get_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+const char* cl_error_string(cl_int err) {
+    switch (err) {
+        case CL_SUCCESS: return "CL_SUCCESS";
+        case CL_DEVICE_NOT_FOUND: return "CL_DEVICE_NOT_FOUND";
+        case CL_DEVICE_NOT_AVAILABLE: return "CL_DEVICE_NOT_AVAILABLE";
+        case CL_COMPILER_NOT_AVAILABLE: return "CL_COMPILER_NOT_AVAILABLE";
+        case CL_MEM_OBJECT_ALLOCATION_FAILURE: return "CL_MEM_OBJECT_ALLOCATION_FAILURE";
+        case CL_OUT_OF_RESOURCES: return "CL_OUT_OF_RESOURCES";
+        case CL_OUT_OF_HOST_MEMORY: return "CL_OUT_OF_HOST_MEMORY";
+        case CL_BUILD_PROGRAM_FAILURE: return "CL_BUILD_PROGRAM_FAILURE";
+        case CL_INVALID_VALUE: return "CL_INVALID_VALUE";
+        case CL_INVALID_DEVICE: return "CL_INVALID_DEVICE";
+        case CL_INVALID_CONTEXT: return "CL_INVALID_CONTEXT";
+        case CL_INVALID_QUEUE_PROPERTIES: return "CL_INVALID_QUEUE_PROPERTIES";
+        case CL_INVALID_COMMAND_QUEUE: return "CL_INVALID_COMMAND_QUEUE";
+        case CL_INVALID_MEM_OBJECT: return "CL_INVALID_MEM_OBJECT";
+        case CL_INVALID_PROGRAM: return "CL_INVALID_PROGRAM";
+        case CL_INVALID_PROGRAM_EXECUTABLE: return "CL_INVALID_PROGRAM_EXECUTABLE";
+        case CL_INVALID_KERNEL_NAME: return "CL_INVALID_KERNEL_NAME";
+        case CL_INVALID_KERNEL_DEFINITION: return "CL_INVALID_KERNEL_DEFINITION";
+        case CL_INVALID_KERNEL: return "CL_INVALID_KERNEL";
+        case CL_INVALID_ARG_INDEX: return "CL_INVALID_ARG_INDEX";
+        case CL_INVALID_ARG_VALUE: return "CL_INVALID_ARG_VALUE";
+        case CL_INVALID_ARG_SIZE: return "CL_INVALID_ARG_SIZE";
+        case CL_INVALID_KERNEL_ARGS: return "CL_INVALID_KERNEL_ARGS";
+        case CL_INVALID_WORK_DIMENSION: return "CL_INVALID_WORK_DIMENSION";
+        case CL_INVALID_WORK_GROUP_SIZE: return "CL_INVALID_WORK_GROUP_SIZE";
+        case CL_INVALID_WORK_ITEM_SIZE: return "CL_INVALID_WORK_ITEM_SIZE";
+        case CL_INVALID_GLOBAL_OFFSET: return "CL_INVALID_GLOBAL_OFFSET";
+        default: return "Unknown OpenCL error";
+    }
+}
+
+int variant_selected(const char* selection, const gemm_variant_t* v) {
+    return strcmp(selection, "all") == 0 || strcmp(selection, v->name) == 0;
+}
+
+void config_describe(const gemm_variant_t* v, const gemm_config_t* c, char* out, size_t size) {
+    char local[32];
+    if (c->local_x > 0) snprintf(local, sizeof(local), "%dx%d", c->local_x, c->local_y);
+    else snprintf(local, sizeof(local), "auto");
+    const char* flags = c->flags[0] ? c->flags : "(none)";
+
+    switch (v->kind) {
+        case GEMM_SIMPLE:
+        case GEMM_HALF:
+            snprintf(out, size, "vec=%d local=%s flags=%s", c->vec, local, flags);
+            break;
+        case GEMM_TILED:
+            snprintf(out, size, "vec=%d tile=%dx%d k=%d flags=%s", c->vec, c->tile_vecs, c->tile_rows, c->tile_k, flags);
+            break;
+        case GEMM_ROWS:
+            snprintf(out, size, "vec=%d rows=%d local=%s flags=%s", c->vec, c->rows_per_item, local, flags);
+            break;
+        case GEMM_BT:
+            snprintf(out, size, "local=%s flags=%s", local, flags);
+            break;
+    }
+}
+
+void compare_results(const reference_t* ref, const float* actual, variant_result_t* res) {
+    res->max_error = 0.0;
+    res->avg_error = 0.0;
+    res->error_count = 0;
+    for (size_t s = 0; s < ref->count; s++) {
+        size_t i = ref->idx ? ref->idx[s] : s;
+        double error = fabs((double)ref->c[i] - (double)actual[i]);
+        res->avg_error += error;
+        if (!(error <= res->max_error)) res->max_error = error;
+        if (!(error <= 0.001)) res->error_count++;
+    }
+    res->avg_error /= ref->count;
+}
+
+void fill_matrix(float* m, size_t count, int seed) {
+    for (size_t i = 0; i < count; i++) {
+        m[i] = (float)((i * 31 + seed * 7) % 97) / 97.0f;
+    }
+}
+
+double event_span_ms(cl_event first, cl_event last) {
+    cl_ulong begin = 0, end = 0;
+    clGetEventProfilingInfo(first, CL_PROFILING_COMMAND_START, sizeof(begin), &begin, NULL);
+    clGetEventProfilingInfo(last, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+    return (double)(end - begin) * 1e-6;
+}
+
+// ============================================================================
+// CPU Reference
+// ============================================================================
+
+static float cpu_dot(const float* A, const float* B, const gemm_shape_t* s, int row, int col) {
+    float sum = 0.0f;
+    for (int k = 0; k < s->k; k++) {
+        sum += A[(size_t)row * s->k + k] * B[(size_t)k * s->n + col];
+    }
+    return sum;
+}
+
+void cpu_matrix_multiply(const float* A, const float* B, float* C, const gemm_shape_t* s) {
+    for (int row = 0; row < s->m; row++) {
+        for (int col = 0; col < s->n; col++) {
+            C[(size_t)row * s->n + col] = cpu_dot(A, B, s, row, col);
+        }
+    }
+}
+
+double cpu_sample_reference(const float* A, const float* B, float* C, const gemm_shape_t* s,
+                            size_t* idx, size_t count) {
+    const size_t corners[4] = { 0, (size_t)s->n - 1, (size_t)(s->m - 1) * s->n,
+                                (size_t)s->m * s->n - 1 };
+    unsigned long long state = 42;
+    for (size_t i = 0; i < count; i++) {
+        if (i < 4) {
+            idx[i] = corners[i];
+        } else {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            idx[i] = (size_t)((state >> 33) % ((unsigned long long)s->m * s->n));
+        }
+    }
+
+    double start = get_time_ms();
+    for (size_t i = 0; i < count; i++) {
+        C[idx[i]] = cpu_dot(A, B, s, (int)(idx[i] / s->n), (int)(idx[i] % s->n));
+    }
+    return (get_time_ms() - start) / count;
+}
+
+// ============================================================================
+// Timed Launches
+// ============================================================================
+
+// Record one batch of launch events once the queue has drained, so the waits
+// in profile_record() never fall inside a timed interval
+static void record_launches(profile_log_t* log, cl_event* events, const double* enqueue_ms, int count,
+                            const char* name, const char* phase, const char* variant) {
+    for (int l = 0; l < count; l++) {
+        if (events[l]) profile_record(log, events[l], name, phase, variant, 0, enqueue_ms[l]);
+        events[l] = NULL;
+    }
+}
+
+cl_int launch_timed(cl_command_queue queue, cl_kernel kernel, const gemm_geometry_t* g,
+                    const gemm_launch_t* launches, int num_launches, int iterations,
+                    double* total_ms, profile_log_t* log, const char* variant) {
+    cl_event* events = NULL;
+    double* enqueue_ms = NULL;
+    const float poison = NAN;
+    cl_int err = CL_SUCCESS;
+
+    *total_ms = 0.0;
+    if (log) {
+        events = (cl_event*)calloc(num_launches, sizeof(cl_event));
+        enqueue_ms = (double*)calloc(num_launches, sizeof(double));
+        if (!events || !enqueue_ms) {
+            err = CL_OUT_OF_HOST_MEMORY;
+            goto done;
+        }
+    }
+
+    // Poison C so columns a kernel skips show up as errors
+    for (int l = 0; l < num_launches; l++) {
+        const size_t bytes = (size_t)launches[l].shape.m * launches[l].shape.n * sizeof(float);
+        cl_event event = NULL;
+        double enqueue_start = get_time_ms();
+        err = clEnqueueFillBuffer(queue, launches[l].c, &poison, sizeof(poison), 0, bytes, 0, NULL,
+                                  log ? &event : NULL);
+        if (err != CL_SUCCESS) goto done;
+        if (log) profile_record(log, event, "fill C", "fill", variant, bytes, get_time_ms() - enqueue_start);
+    }
+
+    // Warm-up
+    for (int l = 0; l < num_launches; l++) {
+        double enqueue_start = get_time_ms();
+        err = enqueue_gemm(queue, kernel, g, &launches[l], 0, NULL, log ? &events[l] : NULL);
+        if (log) enqueue_ms[l] = get_time_ms() - enqueue_start;
+        if (err != CL_SUCCESS) goto done;
+    }
+    clFinish(queue);
+    if (log) record_launches(log, events, enqueue_ms, num_launches, "warm-up", "warmup", variant);
+
+    // Timed runs
+    for (int iter = 0; iter < iterations; iter++) {
+        double start = get_time_ms();
+
+        for (int l = 0; l < num_launches; l++) {
+            double enqueue_start = get_time_ms();
+            err = enqueue_gemm(queue, kernel, g, &launches[l], 0, NULL, log ? &events[l] : NULL);
+            if (log) enqueue_ms[l] = get_time_ms() - enqueue_start;
+            if (err != CL_SUCCESS) goto done;
+        }
+        clFinish(queue);
+
+        double end = get_time_ms();
+        *total_ms += (end - start);
+        if (log) record_launches(log, events, enqueue_ms, num_launches, "kernel", "kernel", variant);
+    }
+
+done:
+    if (events) {
+        clFinish(queue);
+        for (int l = 0; l < num_launches; l++) {
+            if (events[l]) clReleaseEvent(events[l]);
+        }
+    }
+    free(events);
+    free(enqueue_ms);
+    return err;
+}
@@ -0,0 +1,90 @@
+/**
+ * Pieces shared by the benchmark modes
+ *
+ * Host timing, OpenCL error names, the per-variant result and its check
+ * against the CPU reference, and the timed launch loop. variant_bench.cpp
+ * and the tuner time the kernels with them; the optional modes
+ * (memory_bench.cpp, batch_bench.cpp, coexec.cpp, ...) reuse the rest.
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "gemm_kernels.h"
+#include "profile.h"
+#include "tiling.h"
+
+typedef struct {
+    const gemm_variant_t* variant;
+    gemm_config_t config;
+    const char* config_source;  // "default", "cached" or "tuned"
+    const char* skipped;      // reason the variant did not run, NULL if it ran
+    double avg_ms;
+    double gflops;
+    double max_error;
+    double avg_error;
+    int error_count;
+
+    // --profile only, from event timestamps
+    int profiled;
+    double kernel_ms;         // average START..END of the timed launches
+    double kernel_gflops;
+    double e2e_ms;            // operand uploads + kernel_ms + read of C
+    double e2e_gflops;
+    double enqueue_us;        // host time inside clEnqueueNDRangeKernel
+    double latency_us;        // QUEUED..START: submission overhead on the device side
+} variant_result_t;
+
+// Expected values of C: all of it, or only the sampled elements `idx`
+typedef struct {
+    const float* c;           // M x N; only the sampled entries are valid if idx != NULL
+    const size_t* idx;
+    size_t count;             // number of checked elements
+} reference_t;
+
+double get_time_ms(void);
+
+const char* cl_error_string(cl_int err);
+
+// `selection` is a --variant argument: a variant name or "all"
+int variant_selected(const char* selection, const gemm_variant_t* v);
+
+// Only the parameters the variant actually uses
+void config_describe(const gemm_variant_t* v, const gemm_config_t* c, char* out, size_t size);
+
+// NaN-aware: C is poisoned with NaN before each run, so elements a kernel
+// never wrote count as errors instead of comparing false
+void compare_results(const reference_t* ref, const float* actual, variant_result_t* res);
+
+// Cheap deterministic data; rand() would dominate at small sizes
+void fill_matrix(float* m, size_t count, int seed);
+
+// Device time from the start of `first` to the end of `last`, in ms. Both
+// must have completed on a queue with CL_QUEUE_PROFILING_ENABLE.
+double event_span_ms(cl_event first, cl_event last);
+
+// Scalar C = A * B over the whole shape
+void cpu_matrix_multiply(const float* A, const float* B, float* C, const gemm_shape_t* s);
+
+// For products too large for cpu_matrix_multiply(): only `count` elements
+// of C are computed, the four corners (edge vectors and last rows) plus
+// pseudo-random ones, and their indices are stored in `idx`. Returns the
+// time per element.
+double cpu_sample_reference(const float* A, const float* B, float* C, const gemm_shape_t* s,
+                            size_t* idx, size_t count);
+
+// Poison C, run once to warm up, then time `iterations` multiplies. One
+// multiply is `num_launches` launches (one per tile, or just one untiled).
+// With a profile log every command's event is recorded under `variant`,
+// after the queue has finished, so the timings match a run without it.
+cl_int launch_timed(cl_command_queue queue, cl_kernel kernel, const gemm_geometry_t* g,
+                    const gemm_launch_t* launches, int num_launches, int iterations,
+                    double* total_ms, profile_log_t* log, const char* variant);
+
+#endif // BENCH_COMMON_H
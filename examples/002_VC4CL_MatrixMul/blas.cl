@@ -0,0 +1,197 @@
+// BLAS-1/2 kernels for VC4CL (Raspberry Pi GPU)
+// SGEMV in both orientations, SAXPY, and two-pass reductions (dot, sum,
+// max). Everything streams float16 runs, the QPU's native SIMD width, with
+// scalar loops for the tails. All matrices are row-major; the host side is
+// in gemm_lib.cpp.
+
+#define REDUCE_SUM 0
+#define REDUCE_MAX 1
+
+inline float sum_lanes(const float16 v)
+{
+    const float8 s8 = v.lo + v.hi;
+    const float4 s4 = s8.lo + s8.hi;
+    return s4.x + s4.y + s4.z + s4.w;
+}
+
+// ============================================================================
+// sgemv_n / sgemv_t: y = A x and y = A^T x
+// ============================================================================
+
+// y (M) = A (M x N) x: one row per work-item, dotted with x along the row
+__kernel void sgemv_n(
+    __global const float* A,
+    __global const float* x,
+    __global float* y,
+    const int M,
+    const int N)
+{
+    const int row = get_global_id(0);
+    if (row >= M) return;
+
+    __global const float* a = &A[row * N];
+    float16 acc = 0.0f;
+    int j = 0;
+    for (; j + 16 <= N; j += 16) {
+        acc += vload16(0, &a[j]) * vload16(0, &x[j]);
+    }
+    float sum = sum_lanes(acc);
+    for (; j < N; j++) {
+        sum += a[j] * x[j];
+    }
+    y[row] = sum;
+}
+
+// y (N) = A^T x for A (M x N): 16 entries of y per work-item. Like
+// matmul_simple, each step reads a contiguous run of one row of A, and
+// neighbouring work-items read neighbouring runs.
+__kernel void sgemv_t(
+    __global const float* A,
+    __global const float* x,
+    __global float* y,
+    const int M,
+    const int N)
+{
+    const int col = get_global_id(0) * 16;
+    if (col >= N) return;
+
+    if (col + 16 <= N) {
+        float16 acc = 0.0f;
+        for (int i = 0; i < M; i++) {
+            acc += x[i] * vload16(0, &A[i * N + col]);
+        }
+        vstore16(acc, 0, &y[col]);
+        return;
+    }
+    // Last, partial run of y
+    for (int c = col; c < N; c++) {
+        float sum = 0.0f;
+        for (int i = 0; i < M; i++) {
+            sum += x[i] * A[i * N + c];
+        }
+        y[c] = sum;
+    }
+}
+
+// ============================================================================
+// saxpy: y = alpha x + y
+// ============================================================================
+
+__kernel void saxpy(
+    const int n,
+    const float alpha,
+    __global const float* x,
+    __global float* y)
+{
+    const int i = get_global_id(0) * 16;
+    if (i + 16 <= n) {
+        vstore16(alpha * vload16(0, &x[i]) + vload16(0, &y[i]), 0, &y[i]);
+        return;
+    }
+    for (int j = i; j < n; j++) {
+        y[j] = alpha * x[j] + y[j];
+    }
+}
+
+// ============================================================================
+// Reductions: per-group partials, then one group combines them
+// ============================================================================
+
+// Pass 1 runs a grid of work-groups. Each work-item folds a grid-strided
+// share of float16 vectors into registers, then its lanes into one value.
+// The group combines its items' values in a local-memory tree and writes one
+// partial. Pass 2 is reduce_partial again over the partials, as one group.
+
+inline float reduce_op(const int op, const float a, const float b)
+{
+    return op == REDUCE_MAX ? fmax(a, b) : a + b;
+}
+
+inline float16 reduce_op16(const int op, const float16 a, const float16 b)
+{
+    return op == REDUCE_MAX ? fmax(a, b) : a + b;
+}
+
+// -FLT_MAX rather than -INFINITY, which finite-math builds need not honour
+inline float reduce_identity(const int op)
+{
+    return op == REDUCE_MAX ? -FLT_MAX : 0.0f;
+}
+
+inline float reduce_lanes(const int op, const float16 v)
+{
+    const float8 h8 = op == REDUCE_MAX ? fmax(v.lo, v.hi) : v.lo + v.hi;
+    const float4 h4 = op == REDUCE_MAX ? fmax(h8.lo, h8.hi) : h8.lo + h8.hi;
+    const float2 h2 = op == REDUCE_MAX ? fmax(h4.lo, h4.hi) : h4.lo + h4.hi;
+    return reduce_op(op, h2.x, h2.y);
+}
+
+// Tree over any work-group size (VC4CL allows 12): each step folds the
+// upper part of the active items onto the lower, rounding the count up
+inline float reduce_group(const int op, const float value, __local float* scratch)
+{
+    const int lid = get_local_id(0);
+    int active = get_local_size(0);
+    scratch[lid] = value;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    while (active > 1) {
+        const int half = (active + 1) / 2;
+        if (lid + half < active) {
+            scratch[lid] = reduce_op(op, scratch[lid], scratch[lid + half]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        active = half;
+    }
+    return scratch[0];
+}
+
+// partial[group] = op over this group's share of x (n elements)
+__kernel void reduce_partial(
+    __global const float* x,
+    const int n,
+    const int op,
+    __global float* partial,
+    __local float* scratch)
+{
+    const int gid = get_global_id(0);
+    const int stride = get_global_size(0);
+    const int n16 = n / 16;
+
+    float16 acc = (float16)(reduce_identity(op));
+    for (int v = gid; v < n16; v += stride) {
+        acc = reduce_op16(op, acc, vload16(v, x));
+    }
+    float value = reduce_lanes(op, acc);
+    for (int i = n16 * 16 + gid; i < n; i += stride) {
+        value = reduce_op(op, value, x[i]);
+    }
+
+    value = reduce_group(op, value, scratch);
+    if (get_local_id(0) == 0) partial[get_group_id(0)] = value;
+}
+
+// partial[group] = sum of x[i] * y[i] over this group's share; pass 2 is a
+// REDUCE_SUM reduce_partial
+__kernel void sdot_partial(
+    __global const float* x,
+    __global const float* y,
+    const int n,
+    __global float* partial,
+    __local float* scratch)
+{
+    const int gid = get_global_id(0);
+    const int stride = get_global_size(0);
+    const int n16 = n / 16;
+
+    float16 acc = 0.0f;
+    for (int v = gid; v < n16; v += stride) {
+        acc += vload16(v, x) * vload16(v, y);
+    }
+    float value = sum_lanes(acc);
+    for (int i = n16 * 16 + gid; i < n; i += stride) {
+        value += x[i] * y[i];
+    }
+
+    value = reduce_group(REDUCE_SUM, value, scratch);
+    if (get_local_id(0) == 0) partial[get_group_id(0)] = value;
+}
@@ -0,0 +1,194 @@
+/**
+ * BLAS-1/2 operations on the CPU and the device
+ */
+
+#include "blas_bench.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_common.h"
+#include "gemm_lib.h"
+
+enum { BLAS_OP_GEMV_N, BLAS_OP_GEMV_T, BLAS_OP_AXPY, BLAS_OP_DOT, BLAS_OP_SUM, BLAS_OP_MAX, BLAS_OPS };
+static const char* BLAS_OP_NAMES[BLAS_OPS] = { "sgemv", "sgemv^T", "saxpy", "sdot", "ssum", "smax" };
+
+typedef struct {
+    int m, n;                 // A is m x n; vectors are m * n long
+    const float* A;           // also the first vector operand
+    const float* x;           // sgemv input, max(m, n) entries
+    const float* v;           // second vector operand, and saxpy's initial y
+} blas_data_t;
+
+// Bytes each operation has to move at least once
+static double blas_op_bytes(int op, int m, int n) {
+    const double len = (double)m * n;
+    switch (op) {
+        case BLAS_OP_GEMV_N:
+        case BLAS_OP_GEMV_T: return (len + m + n) * sizeof(float);
+        case BLAS_OP_AXPY: return 3.0 * len * sizeof(float);
+        case BLAS_OP_DOT: return 2.0 * len * sizeof(float);
+        default: return len * sizeof(float);
+    }
+}
+
+// Entries of an operation's result
+static int blas_op_outputs(int op, int m, int n) {
+    switch (op) {
+        case BLAS_OP_GEMV_N: return m;
+        case BLAS_OP_GEMV_T: return n;
+        case BLAS_OP_AXPY: return m * n;
+        default: return 1;
+    }
+}
+
+// One call on the device through `h`, or on the CPU if `h` is NULL. For
+// saxpy `out` must hold the initial y.
+static cl_int blas_op(gemm_handle_t* h, int op, const blas_data_t* d, float* out) {
+    const int len = d->m * d->n;
+    const float alpha = 0.5f;
+    if (h) {
+        switch (op) {
+            case BLAS_OP_GEMV_N: return sgemv(h, 0, d->m, d->n, d->A, d->x, out);
+            case BLAS_OP_GEMV_T: return sgemv(h, 1, d->m, d->n, d->A, d->x, out);
+            case BLAS_OP_AXPY: return saxpy(h, len, alpha, d->A, out);
+            case BLAS_OP_DOT: return sdot(h, len, d->A, d->v, out);
+            case BLAS_OP_SUM: return ssum(h, len, d->A, out);
+            default: return smax(h, len, d->A, out);
+        }
+    }
+
+    switch (op) {
+        case BLAS_OP_GEMV_N:
+            for (int i = 0; i < d->m; i++) {
+                float sum = 0.0f;
+                for (int j = 0; j < d->n; j++) sum += d->A[(size_t)i * d->n + j] * d->x[j];
+                out[i] = sum;
+            }
+            break;
+        case BLAS_OP_GEMV_T:
+            for (int j = 0; j < d->n; j++) out[j] = 0.0f;
+            for (int i = 0; i < d->m; i++) {
+                for (int j = 0; j < d->n; j++) out[j] += d->x[i] * d->A[(size_t)i * d->n + j];
+            }
+            break;
+        case BLAS_OP_AXPY:
+            for (int i = 0; i < len; i++) out[i] += alpha * d->A[i];
+            break;
+        case BLAS_OP_DOT:
+        case BLAS_OP_SUM: {
+            // Double accumulator: the reference for the device's tree sum
+            double sum = 0.0;
+            for (int i = 0; i < len; i++) sum += (double)d->A[i] * (op == BLAS_OP_DOT ? d->v[i] : 1.0f);
+            out[0] = (float)sum;
+            break;
+        }
+        default:
+            out[0] = d->A[0];
+            for (int i = 1; i < len; i++) out[0] = d->A[i] > out[0] ? d->A[i] : out[0];
+            break;
+    }
+    return CL_SUCCESS;
+}
+
+void run_blas_bench(const blas_bench_params_t* p) {
+    const gemm_shape_t* s = &p->shape;
+    const int iterations = p->iterations;
+    const int m = s->m, n = s->k;
+    const size_t len = (size_t)m * n;
+    const size_t x_len = m > n ? m : n;
+    if (len > (size_t)INT_MAX) {
+        printf("--- BLAS-1/2 Benchmark skipped (more than INT_MAX elements) ---\n\n");
+        return;
+    }
+
+    float* A = (float*)malloc(len * sizeof(float));
+    float* v = (float*)malloc(len * sizeof(float));
+    float* x = (float*)malloc(x_len * sizeof(float));
+    float* out_cpu = (float*)malloc(len * sizeof(float));
+    float* out_gpu = (float*)malloc(len * sizeof(float));
+    gemm_handle_t* h = NULL;
+    cl_int err = CL_SUCCESS;
+    if (!A || !v || !x || !out_cpu || !out_gpu) {
+        fprintf(stderr, "Error: Failed to allocate host memory\n\n");
+        goto done;
+    }
+    fill_matrix(A, len, 1);
+    fill_matrix(v, len, 2);
+    fill_matrix(x, x_len, 3);
+
+    {
+        gemm_options_t opt;
+        memset(&opt, 0, sizeof(opt));
+        opt.device = p->device;
+        opt.tune_file = p->tune_file;
+        opt.cache_dir = p->cache_dir;
+        h = gemm_open(&opt, &err);
+    }
+    if (!h) {
+        fprintf(stderr, "Error: gemm_open failed (%s)\n\n", cl_error_string(err));
+        goto done;
+    }
+
+    printf("--- BLAS-1/2 Benchmark (A %d x %d, vectors of %zu, %d iterations) ---\n", m, n, len, iterations);
+    printf("%-8s %9s %9s %9s %9s %9s %11s %10s\n", "Op", "CPU ms", "CPU GB/s", "GPU ms", "GB/s",
+           "Kernel ms", "Kernel GB/s", "Rel error");
+    {
+        const blas_data_t d = { m, n, A, x, v };
+        for (int op = 0; op < BLAS_OPS && err == CL_SUCCESS; op++) {
+            const size_t outputs = (size_t)blas_op_outputs(op, m, n);
+            const double bytes = blas_op_bytes(op, m, n);
+            double cpu_ms = 0.0, gpu_ms = 0.0, kernel_ms = 0.0;
+
+            // One untimed call each builds blas.cl and fills the pool; then
+            // saxpy's y is reset outside the timed calls
+            for (int iter = 0; iter <= iterations && err == CL_SUCCESS; iter++) {
+                if (op == BLAS_OP_AXPY) {
+                    memcpy(out_cpu, v, len * sizeof(float));
+                    memcpy(out_gpu, v, len * sizeof(float));
+                }
+                double start = get_time_ms();
+                blas_op(NULL, op, &d, out_cpu);
+                double mid = get_time_ms();
+                err = blas_op(h, op, &d, out_gpu);
+                double end = get_time_ms();
+                if (iter == 0) continue;
+                cpu_ms += mid - start;
+                gpu_ms += end - mid;
+                gemm_stats_t st;
+                gemm_get_stats(h, &st);
+                kernel_ms += st.last_kernel_ms;
+            }
+            if (err != CL_SUCCESS) break;
+            cpu_ms /= iterations;
+            gpu_ms /= iterations;
+            kernel_ms /= iterations;
+
+            double max_diff = 0.0, max_ref = 0.0;
+            for (size_t i = 0; i < outputs; i++) {
+                double diff = fabs((double)out_gpu[i] - (double)out_cpu[i]);
+                if (!(diff <= max_diff)) max_diff = diff;
+                if (fabs((double)out_cpu[i]) > max_ref) max_ref = fabs((double)out_cpu[i]);
+            }
+            printf("%-8s %9.3f %9.3f %9.3f %9.3f %9.3f %11.3f %10.2e\n", BLAS_OP_NAMES[op],
+                   cpu_ms, bytes / (cpu_ms * 1e6), gpu_ms, bytes / (gpu_ms * 1e6),
+                   kernel_ms, kernel_ms > 0.0 ? bytes / (kernel_ms * 1e6) : 0.0,
+                   max_ref > 0.0 ? max_diff / max_ref : max_diff);
+        }
+    }
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: BLAS call failed (%s)\n", cl_error_string(err));
+    }
+    printf("GPU ms is the whole call (uploads, kernels, read); kernel ms is device time only\n\n");
+
+done:
+    gemm_close(h);
+    free(A);
+    free(v);
+    free(x);
+    free(out_cpu);
+    free(out_gpu);
+}
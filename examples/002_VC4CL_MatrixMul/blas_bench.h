@@ -0,0 +1,26 @@
+/**
+ * BLAS-1/2 operations on the CPU and the device (--blas)
+ *
+ * SGEMV (plain and transposed), SAXPY, SDOT, SSUM and SMAX through a
+ * gemm_lib handle, each against a scalar CPU loop on the same data. These
+ * are memory bound, so throughput is reported in GB/s.
+ */
+
+#ifndef BLAS_BENCH_H
+#define BLAS_BENCH_H
+
+#include "tiling.h"
+
+typedef struct {
+    const char* device;       // index or name as for --device
+    gemm_shape_t shape;       // A is M x K; vectors are M * K long
+    int iterations;
+    const char* tune_file;    // tuned configurations to use if present
+    const char* cache_dir;    // program binary cache; NULL = always compile
+} blas_bench_params_t;
+
+// Each BLAS-1/2 operation on the CPU and through a gemm_lib handle, on A
+// (M x K) and vectors of M * K elements
+void run_blas_bench(const blas_bench_params_t* p);
+
+#endif // BLAS_BENCH_H
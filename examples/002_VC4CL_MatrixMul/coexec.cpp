@@ -0,0 +1,144 @@
+/**
+ * CPU+GPU co-execution of one GEMM
+ */
+
+#include "coexec.h"
+
+#include <stdio.h>
+
+#include "cpu_gemm.h"
+
+// One co-executed multiply: how the rows were split and how long each side took
+typedef struct {
+    int gpu_rows;             // C rows [0, gpu_rows) on the device, the rest on the CPU
+    double wall_ms;
+    double gpu_ms;            // device time, kernel start to readback end
+    double cpu_ms;
+} coexec_step_t;
+
+// Enqueue the device's rows, compute the CPU's rows while they run, then
+// wait. Both halves land in `C`: the device's rows are read straight into
+// its top. `queue` needs CL_QUEUE_PROFILING_ENABLE.
+static cl_int coexec_once(cl_command_queue queue, cl_kernel kernel, const gemm_geometry_t* g,
+                          const gemm_launch_t* whole, const float* A, const float* B, float* C,
+                          int threads, coexec_step_t* step) {
+    const gemm_shape_t* s = &whole->shape;
+    cl_event kernel_event = NULL, read_event = NULL;
+    cl_int err = CL_SUCCESS;
+    step->gpu_ms = step->cpu_ms = 0.0;
+
+    double start = get_time_ms();
+    if (step->gpu_rows > 0) {
+        gemm_launch_t l = *whole;
+        l.shape.m = step->gpu_rows;
+        err = enqueue_gemm(queue, kernel, g, &l, 0, NULL, &kernel_event);
+        if (err == CL_SUCCESS) {
+            err = clEnqueueReadBuffer(queue, whole->c, CL_FALSE, 0, (size_t)step->gpu_rows * s->n * sizeof(float),
+                                      C, 0, NULL, &read_event);
+        }
+        if (err == CL_SUCCESS) err = clFlush(queue);
+    }
+    if (err == CL_SUCCESS && step->gpu_rows < s->m) {
+        double cpu_start = get_time_ms();
+        cpu_gemm_rows(A, B, C, s->n, s->k, step->gpu_rows, s->m, threads);
+        step->cpu_ms = get_time_ms() - cpu_start;
+    }
+    if (err == CL_SUCCESS && read_event) {
+        cl_ulong begin = 0, end = 0;
+        err = clWaitForEvents(1, &read_event);
+        if (err == CL_SUCCESS) {
+            err = clGetEventProfilingInfo(kernel_event, CL_PROFILING_COMMAND_START, sizeof(begin), &begin, NULL);
+            err |= clGetEventProfilingInfo(read_event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+            step->gpu_ms = (double)(end - begin) * 1e-6;
+        }
+    }
+    step->wall_ms = get_time_ms() - start;
+
+    // Never leave a read into C pending on failure
+    if (err != CL_SUCCESS) clFinish(queue);
+    if (kernel_event) clReleaseEvent(kernel_event);
+    if (read_event) clReleaseEvent(read_event);
+    return err;
+}
+
+// Device share of the rows after `step`: each side's rows per ms says where
+// both would finish together. Moving halfway there damps single-run jitter.
+// A side that got no rows has no rate, so the share stays.
+static double coexec_rebalance(double share, const coexec_step_t* step, int m) {
+    if (step->gpu_rows <= 0 || step->gpu_rows >= m || step->gpu_ms <= 0.0 || step->cpu_ms <= 0.0) return share;
+    const double gpu_rate = step->gpu_rows / step->gpu_ms;
+    const double cpu_rate = (m - step->gpu_rows) / step->cpu_ms;
+    return 0.5 * share + 0.5 * gpu_rate / (gpu_rate + cpu_rate);
+}
+
+// Device rows for `share`, in whole work-item row blocks
+static int coexec_gpu_rows(double share, int m, int granule) {
+    int rows = (int)(share * m / granule + 0.5) * granule;
+    return rows < 0 ? 0 : rows > m ? m : rows;
+}
+
+void run_coexec(const coexec_params_t* p) {
+    const cl_kernel kernel = p->kernel;
+    const gemm_variant_t* v = p->variant;
+    const gemm_launch_t* whole = &p->whole;
+    const float* A = p->A;
+    const float* B = p->B;
+    float* C = p->C;
+    const int threads = p->threads;
+    const gemm_shape_t* s = &whole->shape;
+    const gemm_geometry_t g = variant_geometry(v, p->config);
+    const int granule = g.rows_per_item * (g.local_y > 0 ? g.local_y : 1);
+    const double flops = gemm_flops(s);
+    cl_int err;
+
+    cl_command_queue queue = clCreateCommandQueue(p->context, p->device, CL_QUEUE_PROFILING_ENABLE, &err);
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Failed to create co-execution queue (%s)\n\n", cl_error_string(err));
+        return;
+    }
+
+    printf("--- CPU+GPU Co-Execution (variant %s, CPU: %d threads, %s) ---\n", v->name, threads, cpu_gemm_describe());
+
+    // Each side alone; the first run of each warms up
+    coexec_step_t gpu_alone = { s->m, 0.0, 0.0, 0.0 };
+    coexec_step_t cpu_alone = { 0, 0.0, 0.0, 0.0 };
+    for (int r = 0; r < 2; r++) {
+        err = coexec_once(queue, kernel, &g, whole, A, B, C, threads, &gpu_alone);
+        if (err == CL_SUCCESS) err = coexec_once(queue, kernel, &g, whole, A, B, C, threads, &cpu_alone);
+        if (err != CL_SUCCESS) break;
+    }
+
+    double total_ms = 0.0, share = 0.0;
+    if (err == CL_SUCCESS) {
+        // Start from the split at which both alone-rates finish together
+        share = (1.0 / gpu_alone.wall_ms) / (1.0 / gpu_alone.wall_ms + 1.0 / cpu_alone.wall_ms);
+        printf("Alone: GPU %.2f ms, CPU %.2f ms -> initial GPU share %.1f%%\n\n",
+               gpu_alone.wall_ms, cpu_alone.wall_ms, share * 100.0);
+        printf("%5s %9s %9s %9s %9s %9s\n", "Iter", "GPU rows", "GPU ms", "CPU ms", "Wall ms", "GFLOPS");
+    }
+    for (int iter = 0; iter < p->iterations && err == CL_SUCCESS; iter++) {
+        coexec_step_t step = { coexec_gpu_rows(share, s->m, granule), 0.0, 0.0, 0.0 };
+        err = coexec_once(queue, kernel, &g, whole, A, B, C, threads, &step);
+        if (err != CL_SUCCESS) break;
+        total_ms += step.wall_ms;
+        printf("%5d %9d %9.2f %9.2f %9.2f %9.3f\n", iter + 1, step.gpu_rows, step.gpu_ms, step.cpu_ms,
+               step.wall_ms, flops / (step.wall_ms * 1e6));
+        share = coexec_rebalance(share, &step, s->m);
+    }
+
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Co-execution failed (%s)\n\n", cl_error_string(err));
+    } else {
+        variant_result_t check;
+        compare_results(p->ref, C, &check);
+        const double avg_ms = total_ms / p->iterations;
+        const double best_alone = gpu_alone.wall_ms < cpu_alone.wall_ms ? gpu_alone.wall_ms : cpu_alone.wall_ms;
+        printf("\n%-10s %9s %9s\n", "Run", "Avg ms", "GFLOPS");
+        printf("%-10s %9.2f %9.3f\n", "GPU alone", gpu_alone.wall_ms, flops / (gpu_alone.wall_ms * 1e6));
+        printf("%-10s %9.2f %9.3f\n", "CPU alone", cpu_alone.wall_ms, flops / (cpu_alone.wall_ms * 1e6));
+        printf("%-10s %9.2f %9.3f\n", "combined", avg_ms, flops / (avg_ms * 1e6));
+        printf("Final GPU share %.1f%%, %.2fx vs the faster side alone, max error %.6f (%d/%zu > 1e-3)\n\n",
+               share * 100.0, best_alone / avg_ms, check.max_error, check.error_count, p->ref->count);
+    }
+    clReleaseCommandQueue(queue);
+}
@@ -0,0 +1,40 @@
+/**
+ * CPU+GPU co-execution of one GEMM (--coexec)
+ *
+ * The device computes the top rows of C while cpu_gemm.cpp computes the
+ * rest on all cores. The split starts where both sides' alone-rates would
+ * finish together and is rebalanced after every multiply from the time each
+ * side took.
+ */
+
+#ifndef COEXEC_H
+#define COEXEC_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+
+#include "bench_common.h"
+#include "gemm_kernels.h"
+
+typedef struct {
+    cl_context context;
+    cl_device_id device;
+    cl_kernel kernel;         // built for `variant` under `config`
+    const gemm_variant_t* variant;
+    const gemm_config_t* config;
+    gemm_launch_t whole;      // untiled buffers, A and B (or B^T) already uploaded
+    const float* A;           // host copies of the operands, for the CPU's rows
+    const float* B;
+    float* C;                 // receives both sides' rows
+    const reference_t* ref;
+    int iterations;
+    int threads;              // CPU threads
+} coexec_params_t;
+
+// Time each side alone, then `iterations` co-executed multiplies with the
+// split adapted after every one. C ends up holding the last product.
+void run_coexec(const coexec_params_t* p);
+
+#endif // COEXEC_H
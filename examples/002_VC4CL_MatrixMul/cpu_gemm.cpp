@@ -0,0 +1,65 @@
+/**
+ * Multithreaded CPU GEMM over a range of C rows
+ */
+
+#include "cpu_gemm.h"
+
+#include <stddef.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CPU_GEMM_NEON 1
+#endif
+
+// C[row] = sum over k of A[row][k] * B[k]; B rows stream through once per
+// C row while the C row stays in L1
+static void gemm_row(const float* a_row, const float* B, float* c_row, int n, int k) {
+    for (int j = 0; j < n; j++) c_row[j] = 0.0f;
+
+    for (int kk = 0; kk < k; kk++) {
+        const float a = a_row[kk];
+        const float* b_row = &B[(size_t)kk * n];
+        int j = 0;
+#ifdef CPU_GEMM_NEON
+        for (; j + 4 <= n; j += 4) {
+            vst1q_f32(&c_row[j], vmlaq_n_f32(vld1q_f32(&c_row[j]), vld1q_f32(&b_row[j]), a));
+        }
+#endif
+        for (; j < n; j++) c_row[j] += a * b_row[j];
+    }
+}
+
+void cpu_gemm_rows(const float* A, const float* B, float* C, int n, int k,
+                   int row0, int row1, int threads) {
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) num_threads(threads)
+#else
+    (void)threads;
+#endif
+    for (int row = row0; row < row1; row++) {
+        gemm_row(&A[(size_t)row * k], B, &C[(size_t)row * n], n, k);
+    }
+}
+
+int cpu_gemm_max_threads(void) {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+const char* cpu_gemm_describe(void) {
+#if defined(CPU_GEMM_NEON) && defined(_OPENMP)
+    return "NEON, OpenMP";
+#elif defined(CPU_GEMM_NEON)
+    return "NEON, single thread";
+#elif defined(_OPENMP)
+    return "scalar, OpenMP";
+#else
+    return "scalar, single thread";
+#endif
+}
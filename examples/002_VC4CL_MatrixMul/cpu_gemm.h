@@ -0,0 +1,22 @@
+/**
+ * Multithreaded CPU GEMM over a range of C rows
+ *
+ * The CPU half of --coexec. Rows are split over OpenMP threads, and each
+ * row of C is accumulated as a sum of scaled B rows, four columns at a time
+ * with NEON where available. Builds without OpenMP run on one thread.
+ */
+
+#ifndef CPU_GEMM_H
+#define CPU_GEMM_H
+
+// Rows [row0, row1) of C (M x n) = A (M x k) * B (k x n), all row-major
+void cpu_gemm_rows(const float* A, const float* B, float* C, int n, int k,
+                   int row0, int row1, int threads);
+
+// Threads available to cpu_gemm_rows (1 without OpenMP)
+int cpu_gemm_max_threads(void);
+
+// e.g. "NEON, OpenMP"
+const char* cpu_gemm_describe(void);
+
+#endif // CPU_GEMM_H
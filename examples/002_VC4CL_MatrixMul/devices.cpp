@@ -0,0 +1,138 @@
+/**
+ * OpenCL device enumeration and selection
+ */
+
+#include "devices.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int contains_nocase(const char* haystack, const char* needle) {
+    const size_t n = strlen(needle);
+    for (const char* h = haystack; *h; h++) {
+        size_t i = 0;
+        while (i < n && h[i] && tolower((unsigned char)h[i]) == tolower((unsigned char)needle[i])) i++;
+        if (i == n) return 1;
+    }
+    return n == 0;
+}
+
+int device_list(device_entry_t** list, cl_int* err) {
+    *list = NULL;
+    cl_uint num_platforms = 0;
+    *err = clGetPlatformIDs(0, NULL, &num_platforms);
+    if (*err != CL_SUCCESS || num_platforms == 0) return 0;
+
+    cl_platform_id* platforms = (cl_platform_id*)calloc(num_platforms, sizeof(cl_platform_id));
+    if (!platforms) {
+        *err = CL_OUT_OF_HOST_MEMORY;
+        return 0;
+    }
+    clGetPlatformIDs(num_platforms, platforms, NULL);
+
+    int count = 0;
+    for (cl_uint p = 0; p < num_platforms; p++) {
+        cl_uint num_devices = 0;
+        if (clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, NULL, &num_devices) != CL_SUCCESS) continue;
+
+        cl_device_id* devices = (cl_device_id*)calloc(num_devices, sizeof(cl_device_id));
+        device_entry_t* grown = (device_entry_t*)realloc(*list, (count + num_devices) * sizeof(device_entry_t));
+        if (!devices || !grown) {
+            free(devices);
+            if (grown) *list = grown;
+            *err = CL_OUT_OF_HOST_MEMORY;
+            break;
+        }
+        *list = grown;
+        clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, num_devices, devices, NULL);
+
+        for (cl_uint d = 0; d < num_devices; d++) {
+            device_entry_t* e = &(*list)[count++];
+            memset(e, 0, sizeof(*e));
+            e->platform = platforms[p];
+            e->device = devices[d];
+            clGetPlatformInfo(platforms[p], CL_PLATFORM_NAME, sizeof(e->id.platform), e->id.platform, NULL);
+            clGetDeviceInfo(devices[d], CL_DEVICE_NAME, sizeof(e->id.device), e->id.device, NULL);
+            clGetDeviceInfo(devices[d], CL_DRIVER_VERSION, sizeof(e->id.driver), e->id.driver, NULL);
+            clGetDeviceInfo(devices[d], CL_DEVICE_TYPE, sizeof(e->type), &e->type, NULL);
+            clGetDeviceInfo(devices[d], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(e->compute_units), &e->compute_units, NULL);
+            clGetDeviceInfo(devices[d], CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(e->max_work_group_size),
+                            &e->max_work_group_size, NULL);
+            clGetDeviceInfo(devices[d], CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(e->max_alloc), &e->max_alloc, NULL);
+        }
+        free(devices);
+    }
+    free(platforms);
+
+    if (count == 0) {
+        free(*list);
+        *list = NULL;
+        if (*err == CL_SUCCESS) *err = CL_DEVICE_NOT_FOUND;
+    }
+    return count;
+}
+
+int device_find(const device_entry_t* list, int count, const char* selector) {
+    char* end = NULL;
+    long index = strtol(selector, &end, 10);
+    if (end != selector && *end == '\0') return index >= 0 && index < count ? (int)index : -1;
+
+    for (int i = 0; i < count; i++) {
+        char label[sizeof(list[i].id.platform) + sizeof(list[i].id.device) + 2];
+        snprintf(label, sizeof(label), "%s %s", list[i].id.platform, list[i].id.device);
+        if (contains_nocase(label, selector)) return i;
+    }
+    return -1;
+}
+
+int device_default(const device_entry_t* list, int count) {
+    for (int i = 0; i < count; i++) {
+        if (list[i].type & CL_DEVICE_TYPE_GPU) return i;
+    }
+    return count > 0 ? 0 : -1;
+}
+
+int device_parse_set(const device_entry_t* list, int count, const char* spec,
+                     int* indices, int max_indices, const char** bad) {
+    static char token[256];
+    int n = 0;
+
+    if (strcmp(spec, "all") == 0) {
+        for (int i = 0; i < count && n < max_indices; i++) indices[n++] = i;
+        return n;
+    }
+
+    for (const char* p = spec; *p && n < max_indices;) {
+        size_t len = strcspn(p, ",");
+        snprintf(token, sizeof(token), "%.*s", (int)len, p);
+        p += len + (p[len] == ',');
+
+        int index = device_find(list, count, token);
+        if (index < 0) {
+            *bad = token;
+            return -1;
+        }
+        int seen = 0;
+        for (int i = 0; i < n; i++) seen |= indices[i] == index;
+        if (!seen) indices[n++] = index;
+    }
+    return n;
+}
+
+const char* device_type_name(cl_device_type type) {
+    if (type & CL_DEVICE_TYPE_GPU) return "GPU";
+    if (type & CL_DEVICE_TYPE_CPU) return "CPU";
+    if (type & CL_DEVICE_TYPE_ACCELERATOR) return "accelerator";
+    return "other";
+}
+
+void device_print_list(const device_entry_t* list, int count) {
+    printf("%3s  %-11s %-24s %-28s %4s %9s  %s\n", "#", "Type", "Platform", "Device", "CUs", "Alloc MB", "Driver");
+    for (int i = 0; i < count; i++) {
+        const device_entry_t* e = &list[i];
+        printf("%3d  %-11s %-24.24s %-28.28s %4u %9.1f  %s\n", i, device_type_name(e->type), e->id.platform,
+               e->id.device, e->compute_units, e->max_alloc / (1024.0 * 1024.0), e->id.driver);
+    }
+}
@@ -0,0 +1,52 @@
+/**
+ * OpenCL device enumeration and selection
+ *
+ * Lists every device of every platform, so a board with VC4CL and POCL
+ * installed side by side shows both, and picks devices by index or name.
+ */
+
+#ifndef DEVICES_H
+#define DEVICES_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "tune_cache.h"
+
+typedef struct {
+    cl_platform_id platform;
+    cl_device_id device;
+    cl_device_type type;
+    tune_device_t id;         // platform, device and driver names
+    cl_uint compute_units;
+    size_t max_work_group_size;
+    cl_ulong max_alloc;       // CL_DEVICE_MAX_MEM_ALLOC_SIZE
+} device_entry_t;
+
+// All devices of all platforms, platform by platform. Returns the count and
+// a malloc'd array in `list`, or 0 (with `err` set) if there are none.
+int device_list(device_entry_t** list, cl_int* err);
+
+// The entry a --device selector names: a decimal index into the list, or a
+// case-insensitive substring of "platform device". Returns -1 if none.
+int device_find(const device_entry_t* list, int count, const char* selector);
+
+// The first GPU, or the first device if there is no GPU
+int device_default(const device_entry_t* list, int count);
+
+// Parse a comma-separated list of selectors ("all" = every device) into
+// `indices` (distinct, in the order given). Returns the count, or -1 and
+// the offending selector in `bad` (valid until the next call).
+int device_parse_set(const device_entry_t* list, int count, const char* spec,
+                     int* indices, int max_indices, const char** bad);
+
+// "GPU", "CPU", "accelerator" or "other"
+const char* device_type_name(cl_device_type type);
+
+// One line per device for --list-devices
+void device_print_list(const device_entry_t* list, int count);
+
+#endif // DEVICES_H
@@ -0,0 +1,129 @@
+/**
+ * The matmul.cl kernel variants and how to launch them
+ */
+
+#include "gemm_kernels.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const gemm_variant_t GEMM_VARIANTS[GEMM_NUM_VARIANTS] = {
+    { "simple", "matmul_simple", GEMM_SIMPLE, 0,
+      "1 row x VEC columns per work-item, scalar A from global" },
+    { "tiled", "matmul_tiled", GEMM_TILED, 0,
+      "A/B tiles staged in __local memory per work-group" },
+    { "rows", "matmul_rows", GEMM_ROWS, 0,
+      "ROWS_PER_ITEM rows x VEC columns per work-item, B vector reused" },
+    { "bt", "matmul_bt", GEMM_BT, 1,
+      "B transposed on host, float16 dot products along k" },
+    { "half", "matmul_half", GEMM_HALF, 0,
+      "as simple, A and B stored as half (vload_half), fp32 accumulation" },
+};
+
+const gemm_config_t GEMM_DEFAULT_CONFIG = { "-cl-fast-relaxed-math", 16, 4, 2, 16, 4, 0, 0 };
+
+const gemm_variant_t* variant_find(const char* name) {
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        if (strcmp(GEMM_VARIANTS[v].name, name) == 0) return &GEMM_VARIANTS[v];
+    }
+    return NULL;
+}
+
+gemm_geometry_t variant_geometry(const gemm_variant_t* v, const gemm_config_t* c) {
+    gemm_geometry_t g = { c->vec, 1, c->local_x, c->local_y };
+    switch (v->kind) {
+        case GEMM_SIMPLE:
+        case GEMM_HALF:
+            break;
+        case GEMM_TILED:
+            g.local_x = c->tile_vecs;
+            g.local_y = c->tile_rows;
+            break;
+        case GEMM_ROWS:
+            g.rows_per_item = c->rows_per_item;
+            break;
+        case GEMM_BT:
+            g.cols_per_item = 4;
+            break;
+    }
+    return g;
+}
+
+const char* variant_unsupported(const gemm_geometry_t* g, size_t kernel_max_wg) {
+    if (g->local_x > 0 && (size_t)(g->local_x * g->local_y) > kernel_max_wg) {
+        return "work-group larger than the kernel allows";
+    }
+    return NULL;
+}
+
+void gemm_global_size(const gemm_geometry_t* g, const gemm_shape_t* s, size_t global[2]) {
+    global[0] = (size_t)((s->n + g->cols_per_item - 1) / g->cols_per_item);
+    global[1] = (size_t)((s->m + g->rows_per_item - 1) / g->rows_per_item);
+    if (g->local_x > 0) {
+        global[0] = (global[0] + g->local_x - 1) / g->local_x * g->local_x;
+        global[1] = (global[1] + g->local_y - 1) / g->local_y * g->local_y;
+    }
+}
+
+void config_build_options(const gemm_config_t* c, char* out, size_t size) {
+    snprintf(out, size, "%s%s-D VEC=%d -D TILE_ROWS=%d -D TILE_VECS=%d -D TILE_K=%d -D ROWS_PER_ITEM=%d",
+             c->flags, c->flags[0] ? " " : "", c->vec, c->tile_rows, c->tile_vecs, c->tile_k, c->rows_per_item);
+}
+
+cl_int set_gemm_args(cl_kernel kernel, const gemm_launch_t* l) {
+    cl_int err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &l->a);
+    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &l->b);
+    err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &l->c);
+    err |= clSetKernelArg(kernel, 3, sizeof(int), &l->shape.m);
+    err |= clSetKernelArg(kernel, 4, sizeof(int), &l->shape.n);
+    err |= clSetKernelArg(kernel, 5, sizeof(int), &l->shape.k);
+    return err;
+}
+
+cl_int enqueue_gemm(cl_command_queue queue, cl_kernel kernel, const gemm_geometry_t* g,
+                    const gemm_launch_t* l, cl_uint num_waits, const cl_event* waits, cl_event* event) {
+    size_t global_work_size[2];
+    size_t local_work_size[2] = { (size_t)g->local_x, (size_t)g->local_y };
+    gemm_global_size(g, &l->shape, global_work_size);
+
+    cl_int err = set_gemm_args(kernel, l);
+    if (err != CL_SUCCESS) return err;
+    return clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global_work_size,
+                                  g->local_x > 0 ? local_work_size : NULL, num_waits, waits, event);
+}
+
+void transpose_matrix(const float* src, float* dst, int rows, int cols) {
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < cols; col++) {
+            dst[(size_t)col * rows + row] = src[(size_t)row * cols + col];
+        }
+    }
+}
+
+char* load_kernel_source(const char* filename, size_t* length) {
+    FILE* f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot open kernel file '%s': %s\n",
+                filename, strerror(errno));
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    *length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char* source = (char*)malloc(*length + 1);
+    if (!source) {
+        fclose(f);
+        return NULL;
+    }
+
+    size_t read_size = fread(source, 1, *length, f);
+    source[read_size] = '\0';
+    *length = read_size;
+    fclose(f);
+
+    return source;
+}
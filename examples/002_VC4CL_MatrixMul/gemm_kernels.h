@@ -0,0 +1,78 @@
+/**
+ * The matmul.cl kernel variants and how to launch them
+ *
+ * Shared by the benchmark modules and the reusable handle in gemm_lib:
+ * the variant table, the launch shape each variant gets under a tuned
+ * configuration, and the -D options that configuration compiles to.
+ */
+
+#ifndef GEMM_KERNELS_H
+#define GEMM_KERNELS_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "tiling.h"
+#include "tune_cache.h"
+
+typedef enum {
+    GEMM_SIMPLE,    // VEC columns per work-item
+    GEMM_TILED,     // VEC columns per work-item, TILE_VECS x TILE_ROWS groups
+    GEMM_ROWS,      // ROWS_PER_ITEM rows x VEC columns per work-item
+    GEMM_BT,        // 4 columns per work-item, float16 along k
+    GEMM_HALF       // as GEMM_SIMPLE, A and B stored as half
+} gemm_kind_t;
+
+typedef struct {
+    const char* name;         // --variant name
+    const char* kernel;       // kernel function in matmul.cl
+    gemm_kind_t kind;
+    int transposed_b;         // kernel reads B^T, prepared on the host
+    const char* description;
+} gemm_variant_t;
+
+#define GEMM_NUM_VARIANTS 5
+extern const gemm_variant_t GEMM_VARIANTS[GEMM_NUM_VARIANTS];
+
+// Used when the tune cache has no entry for this device: float16 columns,
+// 4x2 work-item tiles over 16 k-steps, 4 rows per item, driver-chosen groups
+extern const gemm_config_t GEMM_DEFAULT_CONFIG;
+
+// Launch shape of a variant under a configuration
+typedef struct {
+    int cols_per_item;        // C columns per work-item (global X = ceil(N / cols_per_item))
+    int rows_per_item;        // C rows per work-item (global Y = ceil(M / rows_per_item))
+    int local_x, local_y;     // work-group size, 0 = let the driver choose
+} gemm_geometry_t;
+
+// The variant called `name`, or NULL
+const gemm_variant_t* variant_find(const char* name);
+
+gemm_geometry_t variant_geometry(const gemm_variant_t* v, const gemm_config_t* c);
+
+// Returns why the launch shape cannot run on this device, or NULL. Any
+// matrix size works: the kernels guard their edges.
+const char* variant_unsupported(const gemm_geometry_t* g, size_t kernel_max_wg);
+
+// Global size covering an M x N result, rounded up to whole work-groups
+void gemm_global_size(const gemm_geometry_t* g, const gemm_shape_t* s, size_t global[2]);
+
+// -D options for matmul.cl; variants with equal options share one program
+void config_build_options(const gemm_config_t* c, char* out, size_t size);
+
+cl_int set_gemm_args(cl_kernel kernel, const gemm_launch_t* l);
+
+// Set the arguments of launch `l` and enqueue it after `waits`
+cl_int enqueue_gemm(cl_command_queue queue, cl_kernel kernel, const gemm_geometry_t* g,
+                    const gemm_launch_t* l, cl_uint num_waits, const cl_event* waits, cl_event* event);
+
+// Whole file as a NUL-terminated string, or NULL (with a message) on error
+char* load_kernel_source(const char* filename, size_t* length);
+
+// src is rows x cols, dst becomes cols x rows
+void transpose_matrix(const float* src, float* dst, int rows, int cols);
+
+#endif // GEMM_KERNELS_H
@@ -0,0 +1,772 @@
+/**
+ * Reusable OpenCL GEMM handle
+ */
+
+#include "gemm_lib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "devices.h"
+#include "gemm_kernels.h"
+#include "program_cache.h"
+
+#define GEMM_POOL_MAX 16
+#define GEMM_POOL_MIN 4         // a dot product: x, y, partials and result
+#define GEMM_POOL_DEFAULT 6     // two calls' worth of A, B and C
+#define GEMM_PATH_MAX 512
+
+// blas.cl kernels, built on the first BLAS call
+enum { BLAS_SGEMV_N, BLAS_SGEMV_T, BLAS_SAXPY, BLAS_REDUCE, BLAS_DOT, BLAS_KERNELS };
+static const char* BLAS_KERNEL_NAMES[BLAS_KERNELS] = {
+    "sgemv_n", "sgemv_t", "saxpy", "reduce_partial", "sdot_partial"
+};
+#define BLAS_REDUCE_SUM 0       // REDUCE_SUM / REDUCE_MAX in blas.cl
+#define BLAS_REDUCE_MAX 1
+#define BLAS_MAX_GROUPS 64      // partials per reduction, combined by one group
+#define BLAS_MAX_LOCAL 64
+
+// primitives.cl kernels, built on the first primitives call
+enum { PRIM_SCAN_BLOCKS, PRIM_SCAN_ADD, PRIM_HIST_PARTIAL, PRIM_HIST_MERGE, PRIM_COMPACT_FLAGS,
+       PRIM_COMPACT_SCATTER, PRIM_KERNELS };
+static const char* PRIM_KERNEL_NAMES[PRIM_KERNELS] = {
+    "scan_blocks", "scan_add", "histogram_partial", "histogram_merge", "compact_flags", "compact_scatter"
+};
+#define PRIM_PER_ITEM 16        // PER_ITEM in primitives.cl
+#define PRIM_MAX_LOCAL 64
+#define PRIM_MAX_GROUPS 64      // histogram partials
+#define PRIM_MAX_LEVELS 8       // scan levels; 16-element blocks reach INT_MAX in 8
+#define PRIM_MAX_BINS 256
+
+typedef struct {
+    cl_mem buf;
+    size_t bytes;
+    int in_use;               // held by the call being enqueued
+} pool_entry_t;
+
+struct gemm_handle {
+    device_entry_t entry;
+    gemm_context_t cl;
+    cl_program program;
+    cl_kernel kernel;
+    const gemm_variant_t* variant;
+    gemm_config_t config;
+    gemm_geometry_t geometry;
+    pool_entry_t pool[GEMM_POOL_MAX];
+    int pool_capacity;
+    float* bt;                // host B^T for the "bt" variant
+    size_t bt_count;
+    gemm_stats_t stats;
+
+    char cache_dir[GEMM_PATH_MAX];  // empty = no binary cache
+    char blas_path[GEMM_PATH_MAX];
+    cl_program blas_program;
+    cl_kernel blas[BLAS_KERNELS];
+    size_t blas_local;        // work-group size of the reductions
+
+    char primitives_path[GEMM_PATH_MAX];
+    cl_program prim_program;
+    cl_kernel prim[PRIM_KERNELS];
+    size_t scan_local;        // work-group size of scan_blocks
+    size_t hist_max_local;    // CL_KERNEL_WORK_GROUP_SIZE of histogram_partial
+    cl_ulong local_mem;       // for the histogram's per-item counters
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Best fit among the idle buffers; otherwise a new one, replacing the
+// smallest idle buffer once the pool is full
+static int pool_acquire(gemm_handle_t* h, size_t bytes, cl_int* err) {
+    int best = -1, smallest_idle = -1, empty = -1;
+    for (int i = 0; i < h->pool_capacity; i++) {
+        pool_entry_t* e = &h->pool[i];
+        if (!e->buf) {
+            if (empty < 0) empty = i;
+            continue;
+        }
+        if (e->in_use) continue;
+        if (e->bytes >= bytes && (best < 0 || e->bytes < h->pool[best].bytes)) best = i;
+        if (smallest_idle < 0 || e->bytes < h->pool[smallest_idle].bytes) smallest_idle = i;
+    }
+    if (best >= 0) {
+        h->pool[best].in_use = 1;
+        h->stats.pool_hits++;
+        *err = CL_SUCCESS;
+        return best;
+    }
+
+    int slot = empty >= 0 ? empty : smallest_idle;
+    if (slot < 0) {
+        *err = CL_OUT_OF_RESOURCES;
+        return -1;
+    }
+    pool_entry_t* e = &h->pool[slot];
+    if (e->buf) {
+        // Commands already enqueued keep their own reference to it
+        clReleaseMemObject(e->buf);
+        h->stats.pool_bytes -= e->bytes;
+        e->buf = NULL;
+    }
+    e->buf = clCreateBuffer(h->cl.context, CL_MEM_READ_WRITE, bytes, NULL, err);
+    if (*err != CL_SUCCESS) {
+        e->buf = NULL;
+        return -1;
+    }
+    e->bytes = bytes;
+    e->in_use = 1;
+    h->stats.pool_misses++;
+    h->stats.pool_bytes += bytes;
+    return slot;
+}
+
+// From the handle's binary cache, if it has one
+static cl_program build(gemm_handle_t* h, const char* source, size_t source_length, const char* options,
+                        build_stats_t* stats, cl_int* err) {
+    return program_build(h->cache_dir[0] ? h->cache_dir : NULL, &h->entry.id, h->cl.context, h->entry.device,
+                         source, source_length, options, 1, stats, err);
+}
+
+cl_int gemm_context_open(cl_device_id device, cl_command_queue_properties properties, gemm_context_t* ctx) {
+    cl_int err;
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->device = device;
+    ctx->context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+    if (err != CL_SUCCESS) {
+        ctx->context = NULL;
+        return err;
+    }
+    ctx->queue = clCreateCommandQueue(ctx->context, device, properties, &err);
+    if (err != CL_SUCCESS) {
+        ctx->queue = NULL;
+        gemm_context_close(ctx);
+    }
+    return err;
+}
+
+void gemm_context_close(gemm_context_t* ctx) {
+    if (ctx->queue) {
+        clFinish(ctx->queue);
+        clReleaseCommandQueue(ctx->queue);
+    }
+    if (ctx->context) clReleaseContext(ctx->context);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+// Device and variant from the options, then everything that lives as long
+// as the handle. Returns CL_SUCCESS or the first error.
+static cl_int setup(gemm_handle_t* h, const gemm_options_t* opt) {
+    cl_int err;
+    device_entry_t* list = NULL;
+    int count = device_list(&list, &err);
+    if (count == 0) {
+        fprintf(stderr, "gemm_open: no OpenCL devices\n");
+        return err;
+    }
+    int index = opt->device ? device_find(list, count, opt->device) : device_default(list, count);
+    if (index < 0) {
+        fprintf(stderr, "gemm_open: no device matches '%s'\n", opt->device);
+        free(list);
+        return CL_DEVICE_NOT_FOUND;
+    }
+    h->entry = list[index];
+    free(list);
+
+    h->variant = variant_find(opt->variant ? opt->variant : "rows");
+    if (!h->variant) {
+        fprintf(stderr, "gemm_open: unknown variant '%s'\n", opt->variant);
+        return CL_INVALID_VALUE;
+    }
+    if (h->variant->kind == GEMM_HALF) {
+        // Would need host conversion per call; the handle takes float operands as is
+        fprintf(stderr, "gemm_open: variant 'half' is not supported\n");
+        return CL_INVALID_VALUE;
+    }
+    h->config = GEMM_DEFAULT_CONFIG;
+    h->stats.config_source = "default";
+    if (opt->tune_file && tune_cache_load(opt->tune_file, &h->entry.id, h->variant->name, &h->config, NULL, NULL)) {
+        h->stats.config_source = "cached";
+    }
+    h->geometry = variant_geometry(h->variant, &h->config);
+
+    // Profiled, so BLAS calls can report device time next to call time
+    err = gemm_context_open(h->entry.device, CL_QUEUE_PROFILING_ENABLE, &h->cl);
+    if (err != CL_SUCCESS) return err;
+
+    size_t source_length = 0;
+    char* source = load_kernel_source(opt->kernel_path ? opt->kernel_path : "matmul.cl", &source_length);
+    if (!source) return CL_INVALID_PROGRAM;
+    char options[320];
+    config_build_options(&h->config, options, sizeof(options));
+    // Only this program counts as "cached"; the BLAS and primitives programs are built later
+    build_stats_t build_stats;
+    memset(&build_stats, 0, sizeof(build_stats));
+    h->program = build(h, source, source_length, options, &build_stats, &err);
+    free(source);
+    if (!h->program) return err;
+    h->stats.program_cached = build_stats.cached > 0;
+
+    h->kernel = clCreateKernel(h->program, h->variant->kernel, &err);
+    if (err != CL_SUCCESS) return err;
+    size_t kernel_max_wg = h->entry.max_work_group_size;
+    clGetKernelWorkGroupInfo(h->kernel, h->entry.device, CL_KERNEL_WORK_GROUP_SIZE,
+                             sizeof(kernel_max_wg), &kernel_max_wg, NULL);
+    const char* unsupported = variant_unsupported(&h->geometry, kernel_max_wg);
+    if (unsupported) {
+        fprintf(stderr, "gemm_open: %s: %s\n", h->variant->name, unsupported);
+        return CL_INVALID_WORK_GROUP_SIZE;
+    }
+    return CL_SUCCESS;
+}
+
+gemm_handle_t* gemm_open(const gemm_options_t* opt, cl_int* err) {
+    double start = now_ms();
+    gemm_handle_t* h = (gemm_handle_t*)calloc(1, sizeof(gemm_handle_t));
+    if (!h) {
+        *err = CL_OUT_OF_HOST_MEMORY;
+        return NULL;
+    }
+    if (opt->cache_dir) snprintf(h->cache_dir, sizeof(h->cache_dir), "%s", opt->cache_dir);
+    snprintf(h->blas_path, sizeof(h->blas_path), "%s", opt->blas_path ? opt->blas_path : "blas.cl");
+    snprintf(h->primitives_path, sizeof(h->primitives_path), "%s",
+             opt->primitives_path ? opt->primitives_path : "primitives.cl");
+    h->pool_capacity = opt->pool_buffers > 0 ? opt->pool_buffers : GEMM_POOL_DEFAULT;
+    if (h->pool_capacity < GEMM_POOL_MIN) h->pool_capacity = GEMM_POOL_MIN;
+    if (h->pool_capacity > GEMM_POOL_MAX) h->pool_capacity = GEMM_POOL_MAX;
+
+    *err = setup(h, opt);
+    if (*err != CL_SUCCESS) {
+        gemm_close(h);
+        return NULL;
+    }
+    h->stats.open_ms = now_ms() - start;
+    return h;
+}
+
+void gemm_close(gemm_handle_t* h) {
+    if (!h) return;
+    if (h->cl.queue) clFinish(h->cl.queue);
+    for (int i = 0; i < GEMM_POOL_MAX; i++) {
+        if (h->pool[i].buf) clReleaseMemObject(h->pool[i].buf);
+    }
+    if (h->kernel) clReleaseKernel(h->kernel);
+    if (h->program) clReleaseProgram(h->program);
+    for (int i = 0; i < BLAS_KERNELS; i++) {
+        if (h->blas[i]) clReleaseKernel(h->blas[i]);
+    }
+    if (h->blas_program) clReleaseProgram(h->blas_program);
+    for (int i = 0; i < PRIM_KERNELS; i++) {
+        if (h->prim[i]) clReleaseKernel(h->prim[i]);
+    }
+    if (h->prim_program) clReleaseProgram(h->prim_program);
+    gemm_context_close(&h->cl);
+    free(h->bt);
+    free(h);
+}
+
+cl_int gemm_async(gemm_handle_t* h, const float* A, const float* B, float* C, int M, int N, int K,
+                  cl_event* done) {
+    if (done) *done = NULL;
+    if (M < 1 || N < 1 || K < 1) return CL_INVALID_VALUE;
+    const size_t a_bytes = (size_t)M * K * sizeof(float);
+    const size_t b_bytes = (size_t)K * N * sizeof(float);
+    const size_t c_bytes = (size_t)M * N * sizeof(float);
+    // Larger problems need the sub-buffer tiling of the benchmark
+    if (a_bytes > h->entry.max_alloc || b_bytes > h->entry.max_alloc || c_bytes > h->entry.max_alloc) {
+        return CL_INVALID_BUFFER_SIZE;
+    }
+
+    cl_int err;
+    int slots[3] = { -1, -1, -1 };
+    slots[0] = pool_acquire(h, a_bytes, &err);
+    if (err == CL_SUCCESS) slots[1] = pool_acquire(h, b_bytes, &err);
+    if (err == CL_SUCCESS) slots[2] = pool_acquire(h, c_bytes, &err);
+
+    if (err == CL_SUCCESS) {
+        err = clEnqueueWriteBuffer(h->cl.queue, h->pool[slots[0]].buf, CL_FALSE, 0, a_bytes, A, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS && h->variant->transposed_b) {
+        // The host B^T is reused by the next call, so this write blocks
+        const size_t count = (size_t)K * N;
+        if (count > h->bt_count) {
+            float* grown = (float*)realloc(h->bt, count * sizeof(float));
+            if (!grown) err = CL_OUT_OF_HOST_MEMORY;
+            else {
+                h->bt = grown;
+                h->bt_count = count;
+            }
+        }
+        if (err == CL_SUCCESS) {
+            transpose_matrix(B, h->bt, K, N);
+            err = clEnqueueWriteBuffer(h->cl.queue, h->pool[slots[1]].buf, CL_TRUE, 0, b_bytes, h->bt, 0, NULL, NULL);
+        }
+    } else if (err == CL_SUCCESS) {
+        err = clEnqueueWriteBuffer(h->cl.queue, h->pool[slots[1]].buf, CL_FALSE, 0, b_bytes, B, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS) {
+        const gemm_launch_t l = { h->pool[slots[0]].buf, h->pool[slots[1]].buf, h->pool[slots[2]].buf, { M, N, K } };
+        err = enqueue_gemm(h->cl.queue, h->kernel, &h->geometry, &l, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[2]].buf, CL_FALSE, 0, c_bytes, C, 0, NULL, done);
+    }
+    if (err == CL_SUCCESS) err = clFlush(h->cl.queue);
+
+    // The queue is in order, so the next call may take these buffers over
+    // while this one is still running
+    for (int i = 0; i < 3; i++) {
+        if (slots[i] >= 0) h->pool[slots[i]].in_use = 0;
+    }
+    if (err == CL_SUCCESS) h->stats.calls++;
+    else if (done && *done) {
+        clReleaseEvent(*done);
+        *done = NULL;
+    }
+    return err;
+}
+
+cl_int gemm(gemm_handle_t* h, const float* A, const float* B, float* C, int M, int N, int K) {
+    cl_event done;
+    cl_int err = gemm_async(h, A, B, C, M, N, K, &done);
+    if (err != CL_SUCCESS) return err;
+    err = clWaitForEvents(1, &done);
+    clReleaseEvent(done);
+    return err;
+}
+
+const tune_device_t* gemm_device(const gemm_handle_t* h) {
+    return &h->entry.id;
+}
+
+void gemm_get_stats(const gemm_handle_t* h, gemm_stats_t* stats) {
+    *stats = h->stats;
+}
+
+// ============================================================================
+// BLAS-1/2
+// ============================================================================
+
+// Build the program at `path` and create its `count` kernels, for the
+// kernel files loaded on first use. On failure nothing is left half-built
+// for the next call to trip over.
+static cl_int build_kernels(gemm_handle_t* h, const char* path, const char* options, const char* const* names,
+                            int count, cl_program* program, cl_kernel* kernels) {
+    size_t source_length = 0;
+    char* source = load_kernel_source(path, &source_length);
+    if (!source) return CL_INVALID_PROGRAM;
+    cl_int err;
+    *program = build(h, source, source_length, options, NULL, &err);
+    free(source);
+    if (!*program) return err;
+
+    for (int i = 0; i < count && err == CL_SUCCESS; i++) {
+        kernels[i] = clCreateKernel(*program, names[i], &err);
+    }
+    if (err != CL_SUCCESS) {
+        for (int i = 0; i < count; i++) {
+            if (kernels[i]) clReleaseKernel(kernels[i]);
+            kernels[i] = NULL;
+        }
+        clReleaseProgram(*program);
+        *program = NULL;
+    }
+    return err;
+}
+
+// CL_KERNEL_WORK_GROUP_SIZE, capped at `limit`
+static size_t kernel_local(const gemm_handle_t* h, cl_kernel k, size_t limit) {
+    size_t max_wg = limit;
+    clGetKernelWorkGroupInfo(k, h->entry.device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(max_wg), &max_wg, NULL);
+    return max_wg < limit ? max_wg : limit;
+}
+
+static cl_int blas_prepare(gemm_handle_t* h) {
+    if (h->blas_program) return CL_SUCCESS;
+
+    // Without -cl-fast-relaxed-math: max reductions keep IEEE fmax
+    cl_int err = build_kernels(h, h->blas_path, "-cl-mad-enable", BLAS_KERNEL_NAMES, BLAS_KERNELS,
+                               &h->blas_program, h->blas);
+    if (err != CL_SUCCESS) return err;
+    h->blas_local = kernel_local(h, h->blas[BLAS_REDUCE], BLAS_MAX_LOCAL);
+    h->blas_local = kernel_local(h, h->blas[BLAS_DOT], h->blas_local);
+    return CL_SUCCESS;
+}
+
+// A pool buffer of `bytes`, filled from `host` (if non-NULL) without blocking
+static cl_int pool_upload(gemm_handle_t* h, const void* host, size_t bytes, int* slot) {
+    cl_int err;
+    if (bytes > h->entry.max_alloc) return CL_INVALID_BUFFER_SIZE;
+    *slot = pool_acquire(h, bytes, &err);
+    if (err == CL_SUCCESS && host) {
+        err = clEnqueueWriteBuffer(h->cl.queue, h->pool[*slot].buf, CL_FALSE, 0, bytes, host, 0, NULL, NULL);
+    }
+    return err;
+}
+
+static void pool_release(gemm_handle_t* h, const int* slots, int count) {
+    for (int i = 0; i < count; i++) {
+        if (slots[i] >= 0) h->pool[slots[i]].in_use = 0;
+    }
+}
+
+static double event_ms(cl_event e) {
+    cl_ulong start = 0, end = 0;
+    clGetEventProfilingInfo(e, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+    clGetEventProfilingInfo(e, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+    return (double)(end - start) * 1e-6;
+}
+
+// 1-D launch; local = 0 lets the driver choose
+static cl_int blas_launch(gemm_handle_t* h, cl_kernel kernel, size_t global, size_t local, cl_event* event) {
+    return clEnqueueNDRangeKernel(h->cl.queue, kernel, 1, NULL, &global, local ? &local : NULL, 0, NULL, event);
+}
+
+// Called after the blocking read has drained the queue: device time of
+// `events` into last_kernel_ms
+static void blas_finish(gemm_handle_t* h, cl_event* events, int count, cl_int err) {
+    h->stats.last_kernel_ms = 0.0;
+    for (int i = 0; i < count; i++) {
+        if (!events[i]) continue;
+        if (err == CL_SUCCESS) h->stats.last_kernel_ms += event_ms(events[i]);
+        clReleaseEvent(events[i]);
+    }
+    if (err == CL_SUCCESS) h->stats.calls++;
+}
+
+cl_int sgemv(gemm_handle_t* h, int trans, int M, int N, const float* A, const float* x, float* y) {
+    if (M < 1 || N < 1) return CL_INVALID_VALUE;
+    cl_int err = blas_prepare(h);
+    if (err != CL_SUCCESS) return err;
+
+    const int x_len = trans ? M : N;
+    const int y_len = trans ? N : M;
+    int slots[3] = { -1, -1, -1 };
+    cl_event event = NULL;
+    err = pool_upload(h, A, (size_t)M * N * sizeof(float), &slots[0]);
+    if (err == CL_SUCCESS) err = pool_upload(h, x, (size_t)x_len * sizeof(float), &slots[1]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, (size_t)y_len * sizeof(float), &slots[2]);
+    if (err == CL_SUCCESS) {
+        cl_kernel k = h->blas[trans ? BLAS_SGEMV_T : BLAS_SGEMV_N];
+        err = clSetKernelArg(k, 0, sizeof(cl_mem), &h->pool[slots[0]].buf);
+        err |= clSetKernelArg(k, 1, sizeof(cl_mem), &h->pool[slots[1]].buf);
+        err |= clSetKernelArg(k, 2, sizeof(cl_mem), &h->pool[slots[2]].buf);
+        err |= clSetKernelArg(k, 3, sizeof(int), &M);
+        err |= clSetKernelArg(k, 4, sizeof(int), &N);
+        // sgemv_t: 16 entries of y per work-item
+        if (err == CL_SUCCESS) err = blas_launch(h, k, trans ? (size_t)(N + 15) / 16 : (size_t)M, 0, &event);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[2]].buf, CL_TRUE, 0, (size_t)y_len * sizeof(float),
+                                  y, 0, NULL, NULL);
+    }
+    pool_release(h, slots, 3);
+    blas_finish(h, &event, 1, err);
+    return err;
+}
+
+cl_int saxpy(gemm_handle_t* h, int n, float alpha, const float* x, float* y) {
+    if (n < 1) return CL_INVALID_VALUE;
+    cl_int err = blas_prepare(h);
+    if (err != CL_SUCCESS) return err;
+
+    const size_t bytes = (size_t)n * sizeof(float);
+    int slots[2] = { -1, -1 };
+    cl_event event = NULL;
+    err = pool_upload(h, x, bytes, &slots[0]);
+    if (err == CL_SUCCESS) err = pool_upload(h, y, bytes, &slots[1]);
+    if (err == CL_SUCCESS) {
+        cl_kernel k = h->blas[BLAS_SAXPY];
+        err = clSetKernelArg(k, 0, sizeof(int), &n);
+        err |= clSetKernelArg(k, 1, sizeof(float), &alpha);
+        err |= clSetKernelArg(k, 2, sizeof(cl_mem), &h->pool[slots[0]].buf);
+        err |= clSetKernelArg(k, 3, sizeof(cl_mem), &h->pool[slots[1]].buf);
+        if (err == CL_SUCCESS) err = blas_launch(h, k, (size_t)(n + 15) / 16, 0, &event);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[1]].buf, CL_TRUE, 0, bytes, y, 0, NULL, NULL);
+    }
+    pool_release(h, slots, 2);
+    blas_finish(h, &event, 1, err);
+    return err;
+}
+
+static cl_int set_reduce_args(cl_kernel k, cl_mem x, int n, int op, cl_mem partial, size_t local) {
+    cl_int err = clSetKernelArg(k, 0, sizeof(cl_mem), &x);
+    err |= clSetKernelArg(k, 1, sizeof(int), &n);
+    err |= clSetKernelArg(k, 2, sizeof(int), &op);
+    err |= clSetKernelArg(k, 3, sizeof(cl_mem), &partial);
+    err |= clSetKernelArg(k, 4, local * sizeof(float), NULL);
+    return err;
+}
+
+// Pass 1 over x (times y if non-NULL) into per-group partials, pass 2 as a
+// single group over the partials
+static cl_int blas_reduce(gemm_handle_t* h, int op, int n, const float* x, const float* y, float* result) {
+    if (n < 1) return CL_INVALID_VALUE;
+    cl_int err = blas_prepare(h);
+    if (err != CL_SUCCESS) return err;
+
+    const size_t bytes = (size_t)n * sizeof(float);
+    const size_t local = h->blas_local;
+    size_t groups = ((size_t)n / 16 + local - 1) / local;
+    if (groups < 1) groups = 1;
+    if (groups > BLAS_MAX_GROUPS) groups = BLAS_MAX_GROUPS;
+
+    int slots[4] = { -1, -1, -1, -1 };
+    cl_event events[2] = { NULL, NULL };
+    err = pool_upload(h, x, bytes, &slots[0]);
+    if (err == CL_SUCCESS && y) err = pool_upload(h, y, bytes, &slots[1]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, groups * sizeof(float), &slots[2]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, sizeof(float), &slots[3]);
+
+    if (err == CL_SUCCESS && y) {
+        cl_kernel k = h->blas[BLAS_DOT];
+        err = clSetKernelArg(k, 0, sizeof(cl_mem), &h->pool[slots[0]].buf);
+        err |= clSetKernelArg(k, 1, sizeof(cl_mem), &h->pool[slots[1]].buf);
+        err |= clSetKernelArg(k, 2, sizeof(int), &n);
+        err |= clSetKernelArg(k, 3, sizeof(cl_mem), &h->pool[slots[2]].buf);
+        err |= clSetKernelArg(k, 4, local * sizeof(float), NULL);
+        if (err == CL_SUCCESS) err = blas_launch(h, k, groups * local, local, &events[0]);
+    } else if (err == CL_SUCCESS) {
+        err = set_reduce_args(h->blas[BLAS_REDUCE], h->pool[slots[0]].buf, n, op, h->pool[slots[2]].buf, local);
+        if (err == CL_SUCCESS) err = blas_launch(h, h->blas[BLAS_REDUCE], groups * local, local, &events[0]);
+    }
+    // Arguments are captured at enqueue, so the same kernel runs pass 2
+    if (err == CL_SUCCESS) {
+        err = set_reduce_args(h->blas[BLAS_REDUCE], h->pool[slots[2]].buf, (int)groups, op,
+                              h->pool[slots[3]].buf, local);
+        if (err == CL_SUCCESS) err = blas_launch(h, h->blas[BLAS_REDUCE], local, local, &events[1]);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[3]].buf, CL_TRUE, 0, sizeof(float), result,
+                                  0, NULL, NULL);
+    }
+    pool_release(h, slots, 4);
+    blas_finish(h, events, 2, err);
+    return err;
+}
+
+cl_int sdot(gemm_handle_t* h, int n, const float* x, const float* y, float* result) {
+    return blas_reduce(h, BLAS_REDUCE_SUM, n, x, y, result);
+}
+
+cl_int ssum(gemm_handle_t* h, int n, const float* x, float* result) {
+    return blas_reduce(h, BLAS_REDUCE_SUM, n, x, NULL, result);
+}
+
+cl_int smax(gemm_handle_t* h, int n, const float* x, float* result) {
+    return blas_reduce(h, BLAS_REDUCE_MAX, n, x, NULL, result);
+}
+
+// ============================================================================
+// Parallel Primitives
+// ============================================================================
+
+static cl_int prim_prepare(gemm_handle_t* h) {
+    if (h->prim_program) return CL_SUCCESS;
+
+    cl_int err = build_kernels(h, h->primitives_path, "", PRIM_KERNEL_NAMES, PRIM_KERNELS,
+                               &h->prim_program, h->prim);
+    if (err != CL_SUCCESS) return err;
+    // scan_add must run with the same groups as scan_blocks
+    h->scan_local = kernel_local(h, h->prim[PRIM_SCAN_BLOCKS], PRIM_MAX_LOCAL);
+    h->scan_local = kernel_local(h, h->prim[PRIM_SCAN_ADD], h->scan_local);
+    h->hist_max_local = kernel_local(h, h->prim[PRIM_HIST_PARTIAL], PRIM_MAX_LOCAL);
+    h->local_mem = 0;
+    clGetDeviceInfo(h->entry.device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(h->local_mem), &h->local_mem, NULL);
+    return CL_SUCCESS;
+}
+
+static size_t blocks_of(size_t n, size_t block) {
+    return (n + block - 1) / block;
+}
+
+// Entries of `aux` a scan of n elements needs: every level's block totals
+static size_t scan_aux_count(const gemm_handle_t* h, size_t n) {
+    const size_t block = h->scan_local * PRIM_PER_ITEM;
+    size_t total = 0;
+    do {
+        n = blocks_of(n, block);
+        total += n;
+    } while (n > 1);
+    return total;
+}
+
+// Exclusive scan of the n ints of `data` in place. Level 0 scans data's
+// blocks into totals in aux; each further level scans the previous level's
+// totals, until one block is left. Then, top-down, every level's scanned
+// totals are added to the blocks below. aux ends with the overall total.
+static cl_int prim_scan(gemm_handle_t* h, cl_mem data, int n, cl_mem aux, cl_event* events, int* num_events) {
+    const size_t local = h->scan_local;
+    const size_t block = local * PRIM_PER_ITEM;
+    int pow2 = 1;
+    while ((size_t)pow2 < local) pow2 *= 2;
+
+    // Level l scans count[l] ints at buf[l] + offset[l] into aux + sums[l]
+    cl_mem buf[PRIM_MAX_LEVELS];
+    int offset[PRIM_MAX_LEVELS], count[PRIM_MAX_LEVELS], sums[PRIM_MAX_LEVELS];
+    int levels = 0;
+    cl_int err = CL_SUCCESS;
+    buf[0] = data;
+    offset[0] = 0;
+    count[0] = n;
+    sums[0] = 0;
+    for (;;) {
+        const int l = levels++;
+        const size_t groups = blocks_of((size_t)count[l], block);
+        cl_kernel k = h->prim[PRIM_SCAN_BLOCKS];
+        err = clSetKernelArg(k, 0, sizeof(cl_mem), &buf[l]);
+        err |= clSetKernelArg(k, 1, sizeof(int), &offset[l]);
+        err |= clSetKernelArg(k, 2, sizeof(int), &count[l]);
+        err |= clSetKernelArg(k, 3, sizeof(cl_mem), &aux);
+        err |= clSetKernelArg(k, 4, sizeof(int), &sums[l]);
+        err |= clSetKernelArg(k, 5, pow2 * sizeof(int), NULL);
+        err |= clSetKernelArg(k, 6, sizeof(int), &pow2);
+        if (err == CL_SUCCESS) err = blas_launch(h, k, groups * local, local, &events[(*num_events)++]);
+        if (err != CL_SUCCESS || groups == 1) break;
+        if (levels == PRIM_MAX_LEVELS) return CL_INVALID_VALUE;
+        buf[levels] = aux;
+        offset[levels] = sums[l];
+        count[levels] = (int)groups;
+        sums[levels] = sums[l] + (int)groups;
+    }
+
+    // The top level is one block; it needs nothing added
+    for (int l = levels - 2; l >= 0 && err == CL_SUCCESS; l--) {
+        const size_t groups = blocks_of((size_t)count[l], block);
+        cl_kernel k = h->prim[PRIM_SCAN_ADD];
+        err = clSetKernelArg(k, 0, sizeof(cl_mem), &buf[l]);
+        err |= clSetKernelArg(k, 1, sizeof(int), &offset[l]);
+        err |= clSetKernelArg(k, 2, sizeof(int), &count[l]);
+        err |= clSetKernelArg(k, 3, sizeof(cl_mem), &aux);
+        err |= clSetKernelArg(k, 4, sizeof(int), &sums[l]);
+        if (err == CL_SUCCESS) err = blas_launch(h, k, groups * local, local, &events[(*num_events)++]);
+    }
+    return err;
+}
+
+cl_int scan_exclusive(gemm_handle_t* h, int n, const int* in, int* out, int* total) {
+    if (n < 1) return CL_INVALID_VALUE;
+    cl_int err = prim_prepare(h);
+    if (err != CL_SUCCESS) return err;
+
+    const size_t aux_count = scan_aux_count(h, (size_t)n);
+    int slots[2] = { -1, -1 };
+    cl_event events[2 * PRIM_MAX_LEVELS] = { NULL };
+    int num_events = 0;
+    err = pool_upload(h, in, (size_t)n * sizeof(int), &slots[0]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, aux_count * sizeof(int), &slots[1]);
+    if (err == CL_SUCCESS) err = prim_scan(h, h->pool[slots[0]].buf, n, h->pool[slots[1]].buf, events, &num_events);
+    if (err == CL_SUCCESS && total) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[1]].buf, CL_FALSE, (aux_count - 1) * sizeof(int),
+                                  sizeof(int), total, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[0]].buf, CL_TRUE, 0, (size_t)n * sizeof(int), out,
+                                  0, NULL, NULL);
+    }
+    pool_release(h, slots, 2);
+    blas_finish(h, events, num_events, err);
+    return err;
+}
+
+cl_int histogram(gemm_handle_t* h, int n, const float* x, float lo, float hi, int bins, unsigned int* counts) {
+    if (n < 1 || bins < 1 || bins > PRIM_MAX_BINS || !(lo < hi)) return CL_INVALID_VALUE;
+    cl_int err = prim_prepare(h);
+    if (err != CL_SUCCESS) return err;
+
+    // Each work-item owns `bins` counters of local memory
+    size_t local = h->hist_max_local;
+    const size_t per_item = (size_t)bins * sizeof(cl_uint);
+    if (h->local_mem > 0 && local * per_item > h->local_mem) local = (size_t)(h->local_mem / per_item);
+    if (local < 1) return CL_OUT_OF_RESOURCES;
+    size_t groups = blocks_of(blocks_of((size_t)n, PRIM_PER_ITEM), local);
+    if (groups > PRIM_MAX_GROUPS) groups = PRIM_MAX_GROUPS;
+
+    const float scale = bins / (hi - lo);
+    const int num_groups = (int)groups;
+    int slots[3] = { -1, -1, -1 };
+    cl_event events[2] = { NULL, NULL };
+    err = pool_upload(h, x, (size_t)n * sizeof(float), &slots[0]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, groups * per_item, &slots[1]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, per_item, &slots[2]);
+    if (err == CL_SUCCESS) {
+        cl_kernel k = h->prim[PRIM_HIST_PARTIAL];
+        err = clSetKernelArg(k, 0, sizeof(cl_mem), &h->pool[slots[0]].buf);
+        err |= clSetKernelArg(k, 1, sizeof(int), &n);
+        err |= clSetKernelArg(k, 2, sizeof(float), &lo);
+        err |= clSetKernelArg(k, 3, sizeof(float), &hi);
+        err |= clSetKernelArg(k, 4, sizeof(float), &scale);
+        err |= clSetKernelArg(k, 5, sizeof(int), &bins);
+        err |= clSetKernelArg(k, 6, sizeof(cl_mem), &h->pool[slots[1]].buf);
+        err |= clSetKernelArg(k, 7, local * per_item, NULL);
+        if (err == CL_SUCCESS) err = blas_launch(h, k, groups * local, local, &events[0]);
+    }
+    if (err == CL_SUCCESS) {
+        cl_kernel k = h->prim[PRIM_HIST_MERGE];
+        err = clSetKernelArg(k, 0, sizeof(cl_mem), &h->pool[slots[1]].buf);
+        err |= clSetKernelArg(k, 1, sizeof(int), &num_groups);
+        err |= clSetKernelArg(k, 2, sizeof(int), &bins);
+        err |= clSetKernelArg(k, 3, sizeof(cl_mem), &h->pool[slots[2]].buf);
+        if (err == CL_SUCCESS) err = blas_launch(h, k, (size_t)bins, 0, &events[1]);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[2]].buf, CL_TRUE, 0, per_item, counts, 0, NULL, NULL);
+    }
+    pool_release(h, slots, 3);
+    blas_finish(h, events, 2, err);
+    return err;
+}
+
+cl_int compact(gemm_handle_t* h, int n, const float* x, float threshold, float* out, int* count) {
+    if (n < 1) return CL_INVALID_VALUE;
+    cl_int err = prim_prepare(h);
+    if (err != CL_SUCCESS) return err;
+
+    const size_t bytes = (size_t)n * sizeof(float);
+    const size_t aux_count = scan_aux_count(h, (size_t)n);
+    const size_t global = blocks_of((size_t)n, PRIM_PER_ITEM);
+    int slots[4] = { -1, -1, -1, -1 };
+    cl_event events[2 * PRIM_MAX_LEVELS + 2] = { NULL };
+    int num_events = 0;
+    err = pool_upload(h, x, bytes, &slots[0]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, (size_t)n * sizeof(int), &slots[1]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, bytes, &slots[2]);
+    if (err == CL_SUCCESS) err = pool_upload(h, NULL, aux_count * sizeof(int), &slots[3]);
+    if (err == CL_SUCCESS) {
+        cl_kernel k = h->prim[PRIM_COMPACT_FLAGS];
+        err = clSetKernelArg(k, 0, sizeof(cl_mem), &h->pool[slots[0]].buf);
+        err |= clSetKernelArg(k, 1, sizeof(int), &n);
+        err |= clSetKernelArg(k, 2, sizeof(float), &threshold);
+        err |= clSetKernelArg(k, 3, sizeof(cl_mem), &h->pool[slots[1]].buf);
+        if (err == CL_SUCCESS) err = blas_launch(h, k, global, 0, &events[num_events++]);
+    }
+    if (err == CL_SUCCESS) err = prim_scan(h, h->pool[slots[1]].buf, n, h->pool[slots[3]].buf, events, &num_events);
+    if (err == CL_SUCCESS) {
+        cl_kernel k = h->prim[PRIM_COMPACT_SCATTER];
+        err = clSetKernelArg(k, 0, sizeof(cl_mem), &h->pool[slots[0]].buf);
+        err |= clSetKernelArg(k, 1, sizeof(cl_mem), &h->pool[slots[1]].buf);
+        err |= clSetKernelArg(k, 2, sizeof(int), &n);
+        err |= clSetKernelArg(k, 3, sizeof(float), &threshold);
+        err |= clSetKernelArg(k, 4, sizeof(cl_mem), &h->pool[slots[2]].buf);
+        if (err == CL_SUCCESS) err = blas_launch(h, k, global, 0, &events[num_events++]);
+    }
+    // The count first: only that many results come back
+    *count = 0;
+    if (err == CL_SUCCESS) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[3]].buf, CL_TRUE, (aux_count - 1) * sizeof(int),
+                                  sizeof(int), count, 0, NULL, NULL);
+    }
+    if (err == CL_SUCCESS && *count > 0) {
+        err = clEnqueueReadBuffer(h->cl.queue, h->pool[slots[2]].buf, CL_TRUE, 0, (size_t)*count * sizeof(float),
+                                  out, 0, NULL, NULL);
+    }
+    pool_release(h, slots, 4);
+    blas_finish(h, events, num_events, err);
+    return err;
+}
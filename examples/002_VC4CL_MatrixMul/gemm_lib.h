@@ -0,0 +1,116 @@
+/**
+ * Reusable OpenCL GEMM handle
+ *
+ * The benchmark builds its context, queue and programs once per process,
+ * which on VC4CL costs far more than a small multiply. A long-lived handle
+ * pays that once: it owns the context, the compiled kernel of one variant
+ * and a pool of device buffers that later calls reuse, so a service can
+ * issue thousands of products against a single setup. The same handle runs
+ * the BLAS-1/2 kernels of blas.cl (SGEMV, SAXPY and reductions) and the
+ * parallel primitives of primitives.cl (scan, histogram and compaction).
+ *
+ * Callers that manage their own programs, kernels and buffers (the
+ * benchmark runs every variant) can open just the context and queue of a
+ * handle with gemm_context_open(), and build through program_build().
+ */
+
+#ifndef GEMM_LIB_H
+#define GEMM_LIB_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "tune_cache.h"
+
+typedef struct {
+    const char* device;       // index or name as for --device; NULL = first GPU
+    const char* variant;      // "simple", "tiled", "rows" or "bt"; NULL = "rows"
+    const char* kernel_path;  // NULL = "matmul.cl" in the working directory
+    const char* tune_file;    // tuned configurations to use if present; NULL = defaults
+    const char* blas_path;    // NULL = "blas.cl" in the working directory
+    const char* primitives_path;  // NULL = "primitives.cl" in the working directory
+    const char* cache_dir;    // program binary cache; NULL = always compile
+    int pool_buffers;         // device buffers kept for reuse, 4 to 16; 0 = 6
+} gemm_options_t;
+
+typedef struct {
+    double open_ms;           // gemm_open: devices, context, queue, program, kernel
+    int program_cached;       // the program came from the binary cache
+    const char* config_source;  // "default" or "cached"
+    unsigned long calls;
+    unsigned long pool_hits;  // operand buffers reused
+    unsigned long pool_misses;  // operand buffers (re)allocated
+    size_t pool_bytes;        // device memory held by the pool
+    double last_kernel_ms;    // device time of the last BLAS or primitives call's kernels
+} gemm_stats_t;
+
+typedef struct gemm_handle gemm_handle_t;
+
+// A device's context and in-order queue, as a handle holds them
+typedef struct {
+    cl_device_id device;
+    cl_context context;
+    cl_command_queue queue;
+} gemm_context_t;
+
+// Create the context and a queue with `properties` (e.g.
+// CL_QUEUE_PROFILING_ENABLE). On failure nothing is left to release.
+cl_int gemm_context_open(cl_device_id device, cl_command_queue_properties properties, gemm_context_t* ctx);
+
+// Waits for the queue, then releases both; a zeroed or closed ctx is ignored
+void gemm_context_close(gemm_context_t* ctx);
+
+// Set up a handle. Returns NULL with `err` set (and a message on stderr)
+// if no device matches, the variant is unknown or the build fails.
+gemm_handle_t* gemm_open(const gemm_options_t* opt, cl_int* err);
+
+// Waits for outstanding work and frees everything; NULL is ignored
+void gemm_close(gemm_handle_t* h);
+
+// C (M x N) = A (M x K) * B (K x N), row-major, blocking
+cl_int gemm(gemm_handle_t* h, const float* A, const float* B, float* C, int M, int N, int K);
+
+// As gemm(), but returns once the work is enqueued and flushed. `done`
+// (if non-NULL) receives an event that completes when C is written; the
+// caller releases it. A, B and C must stay valid until then. Calls run in
+// order, so back-to-back calls may share pool buffers safely.
+cl_int gemm_async(gemm_handle_t* h, const float* A, const float* B, float* C, int M, int N, int K,
+                  cl_event* done);
+
+// BLAS-1/2, built from blas.cl on the first call. All block until the
+// result is in host memory; operands go through the same buffer pool.
+
+// y = A x (trans = 0: x has N entries, y has M) or y = A^T x (trans = 1:
+// x has M, y has N) for row-major A (M x N)
+cl_int sgemv(gemm_handle_t* h, int trans, int M, int N, const float* A, const float* x, float* y);
+
+// y = alpha x + y
+cl_int saxpy(gemm_handle_t* h, int n, float alpha, const float* x, float* y);
+
+// Two-pass reductions of n elements into *result
+cl_int sdot(gemm_handle_t* h, int n, const float* x, const float* y, float* result);
+cl_int ssum(gemm_handle_t* h, int n, const float* x, float* result);
+cl_int smax(gemm_handle_t* h, int n, const float* x, float* result);
+
+// Parallel primitives, built from primitives.cl on the first call. They
+// block and share the pool like the BLAS calls, and use no atomics.
+
+// out[i] = in[0] + ... + in[i-1]; *total (if non-NULL) = the sum of all n.
+// `in` and `out` may be the same array.
+cl_int scan_exclusive(gemm_handle_t* h, int n, const int* in, int* out, int* total);
+
+// counts[b] = elements of x in bin b of `bins` (1 to 256) equal bins over
+// [lo, hi); values outside the range and NaN are not counted
+cl_int histogram(gemm_handle_t* h, int n, const float* x, float lo, float hi, int bins, unsigned int* counts);
+
+// The elements of x greater than `threshold`, in their order, into out
+// (room for n); *count = how many
+cl_int compact(gemm_handle_t* h, int n, const float* x, float threshold, float* out, int* count);
+
+const tune_device_t* gemm_device(const gemm_handle_t* h);
+void gemm_get_stats(const gemm_handle_t* h, gemm_stats_t* stats);
+
+#endif // GEMM_LIB_H
@@ -0,0 +1,94 @@
+/**
+ * Bulk float <-> IEEE half conversion on the host
+ */
+
+#include "half_float.h"
+
+#include <string.h>
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+    (defined(__aarch64__) || (defined(__ARM_FP) && (__ARM_FP & 2)))
+#include <arm_neon.h>
+#define HALF_FLOAT_NEON 1
+#endif
+
+static uint32_t float_bits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static float bits_float(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Round to nearest even; overflow becomes infinity, NaN stays NaN
+static uint16_t to_half(float f) {
+    const uint32_t u = float_bits(f);
+    const uint16_t sign = (uint16_t)((u >> 16) & 0x8000);
+    const int exp = (int)((u >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = u & 0x7fffff;
+
+    if (((u >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);
+    if (exp >= 31) return sign | 0x7c00;
+    if (exp <= 0) {
+        // Subnormal half, or zero below half the smallest subnormal
+        if (exp < -10) return sign;
+        mant |= 0x800000;
+        const int shift = 14 - exp;
+        uint32_t half = mant >> shift;
+        const uint32_t rest = mant & ((1u << shift) - 1);
+        const uint32_t midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1))) half++;
+        return sign | (uint16_t)half;
+    }
+
+    uint32_t half = ((uint32_t)exp << 10) | (mant >> 13);
+    const uint32_t rest = mant & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;   // may carry into infinity
+    return sign | (uint16_t)half;
+}
+
+static float from_half(uint16_t h) {
+    const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    const uint32_t exp = (h >> 10) & 0x1f;
+    const uint32_t mant = h & 0x3ff;
+
+    if (exp == 0x1f) return bits_float(sign | 0x7f800000 | (mant << 13));
+    if (exp == 0) {
+        // Zero or subnormal: mant * 2^-24
+        const float f = (float)mant * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    return bits_float(sign | ((exp - 15 + 127) << 23) | (mant << 13));
+}
+
+void float_to_half(const float* src, uint16_t* dst, size_t count) {
+    size_t i = 0;
+#ifdef HALF_FLOAT_NEON
+    for (; i + 4 <= count; i += 4) {
+        vst1_u16(&dst[i], vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(&src[i]))));
+    }
+#endif
+    for (; i < count; i++) dst[i] = to_half(src[i]);
+}
+
+void half_to_float(const uint16_t* src, float* dst, size_t count) {
+    size_t i = 0;
+#ifdef HALF_FLOAT_NEON
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(&dst[i], vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(&src[i]))));
+    }
+#endif
+    for (; i < count; i++) dst[i] = from_half(src[i]);
+}
+
+const char* half_float_describe(void) {
+#ifdef HALF_FLOAT_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
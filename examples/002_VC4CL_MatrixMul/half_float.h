@@ -0,0 +1,22 @@
+/**
+ * Bulk float <-> IEEE half conversion on the host
+ *
+ * Feeds the half-storage variant: A and B are converted once, uploaded at
+ * half the bytes, and widened back to float by vload_half on the device.
+ * Converts four values at a time with NEON vcvt where the FPU has half
+ * support, with a round-to-nearest-even scalar fallback elsewhere.
+ */
+
+#ifndef HALF_FLOAT_H
+#define HALF_FLOAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+void float_to_half(const float* src, uint16_t* dst, size_t count);
+void half_to_float(const uint16_t* src, float* dst, size_t count);
+
+// "NEON" or "scalar"
+const char* half_float_describe(void);
+
+#endif // HALF_FLOAT_H
@@ -0,0 +1,66 @@
+/**
+ * Matrix buffers in copy or zero-copy mode
+ */
+
+#include "host_buffers.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// VC4CL maps buffers page-wise; most drivers need at least cache-line
+// alignment to use host memory without copying it
+#define HOST_ALIGNMENT 4096
+#define HOST_SIZE_MULTIPLE 64
+
+static const char* MODE_NAMES[NUM_MEM_MODES] = { "copy", "alloc", "use" };
+
+const char* mem_mode_name(mem_mode_t mode) {
+    return mode >= 0 && mode < NUM_MEM_MODES ? MODE_NAMES[mode] : "?";
+}
+
+int mem_mode_parse(const char* name, mem_mode_t* mode) {
+    for (int m = 0; m < NUM_MEM_MODES; m++) {
+        if (strcmp(name, MODE_NAMES[m]) == 0) {
+            *mode = (mem_mode_t)m;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+float* host_matrix_alloc(size_t bytes) {
+    size_t rounded = (bytes + HOST_SIZE_MULTIPLE - 1) / HOST_SIZE_MULTIPLE * HOST_SIZE_MULTIPLE;
+    void* p = NULL;
+    if (posix_memalign(&p, HOST_ALIGNMENT, rounded) != 0) return NULL;
+    return (float*)p;
+}
+
+cl_mem create_matrix_buffer(cl_context context, mem_mode_t mode, cl_mem_flags access,
+                            size_t bytes, float** backing, cl_int* err) {
+    *backing = NULL;
+    switch (mode) {
+        case MEM_ALLOC_HOST_PTR:
+            return clCreateBuffer(context, access | CL_MEM_ALLOC_HOST_PTR, bytes, NULL, err);
+        case MEM_USE_HOST_PTR: {
+            float* host = host_matrix_alloc(bytes);
+            if (!host) {
+                *err = CL_OUT_OF_HOST_MEMORY;
+                return NULL;
+            }
+            cl_mem buf = clCreateBuffer(context, access | CL_MEM_USE_HOST_PTR, bytes, host, err);
+            if (*err != CL_SUCCESS) {
+                free(host);
+                return NULL;
+            }
+            *backing = host;
+            return buf;
+        }
+        default:
+            return clCreateBuffer(context, access, bytes, NULL, err);
+    }
+}
+
+float* map_matrix(cl_command_queue queue, cl_mem buf, cl_map_flags flags, size_t bytes,
+                  cl_event* event, cl_int* err) {
+    return (float*)clEnqueueMapBuffer(queue, buf, CL_TRUE, flags, 0, bytes, 0, NULL, event, err);
+}
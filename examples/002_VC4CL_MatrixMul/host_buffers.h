@@ -0,0 +1,46 @@
+/**
+ * Matrix buffers in copy or zero-copy mode
+ *
+ * The Pi's CPU and QPUs share the same DRAM, so copying A, B and C through
+ * clEnqueueWriteBuffer/clEnqueueReadBuffer moves every byte one extra time.
+ * The zero-copy modes let the driver place the buffer in host-visible memory
+ * (or adopt ours) and access it through clEnqueueMapBuffer instead.
+ */
+
+#ifndef HOST_BUFFERS_H
+#define HOST_BUFFERS_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+typedef enum {
+    MEM_COPY,               // device buffers, explicit write/read copies
+    MEM_ALLOC_HOST_PTR,     // CL_MEM_ALLOC_HOST_PTR: driver-allocated, mapped
+    MEM_USE_HOST_PTR,       // CL_MEM_USE_HOST_PTR: our aligned memory, mapped
+    NUM_MEM_MODES
+} mem_mode_t;
+
+// "copy", "alloc" or "use"
+const char* mem_mode_name(mem_mode_t mode);
+
+// Returns 0 and sets `mode` if `name` is a mode name
+int mem_mode_parse(const char* name, mem_mode_t* mode);
+
+// Page-aligned allocation with the size rounded up to a whole cache line,
+// as CL_MEM_USE_HOST_PTR needs to avoid a hidden copy. Free with free().
+float* host_matrix_alloc(size_t bytes);
+
+// Create a matrix buffer for `mode` with `access` (CL_MEM_READ_ONLY, ...).
+// For MEM_USE_HOST_PTR the backing memory is allocated here and returned in
+// `backing`; free it after releasing the buffer. Otherwise `backing` is NULL.
+cl_mem create_matrix_buffer(cl_context context, mem_mode_t mode, cl_mem_flags access,
+                            size_t bytes, float** backing, cl_int* err);
+
+// Blocking map of the whole buffer. `event` may be NULL.
+float* map_matrix(cl_command_queue queue, cl_mem buf, cl_map_flags flags, size_t bytes,
+                  cl_event* event, cl_int* err);
+
+#endif // HOST_BUFFERS_H
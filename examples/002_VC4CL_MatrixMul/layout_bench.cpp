@@ -0,0 +1,159 @@
+/**
+ * B layouts: row-major, transposed and packed on the device
+ */
+
+#include "layout_bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "program_cache.h"
+
+// B as uploaded (matmul_simple), transposed on the device (transpose_b +
+// matmul_bt), and packed into panels on the device (pack_b +
+// matmul_packed). The conversion runs once per B, so it pays off once a B
+// is reused for enough products: its cost over the per-product saving.
+enum { LAYOUT_ROW_MAJOR, LAYOUT_TRANSPOSED, LAYOUT_PACKED, LAYOUTS };
+static const char* LAYOUT_NAMES[LAYOUTS] = { "row-major", "transposed", "packed" };
+static const char* LAYOUT_PREP[LAYOUTS] = { NULL, "transpose_b", "pack_b" };
+static const char* LAYOUT_GEMM[LAYOUTS] = { "matmul_simple", "matmul_bt", "matmul_packed" };
+static const int LAYOUT_COLS[LAYOUTS] = { 16, 4, 16 };   // C columns per work-item
+
+// Run `kernel` over `global` `iterations` times after a warm-up and return
+// its mean device time
+static cl_int layout_time(cl_command_queue queue, cl_kernel kernel, const size_t global[2], int iterations,
+                          double* mean_ms) {
+    cl_int err = clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global, NULL, 0, NULL, NULL);
+    if (err == CL_SUCCESS) err = clFinish(queue);
+    *mean_ms = 0.0;
+    for (int i = 0; i < iterations && err == CL_SUCCESS; i++) {
+        cl_event e = NULL;
+        err = clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global, NULL, 0, NULL, &e);
+        if (err == CL_SUCCESS) err = clWaitForEvents(1, &e);
+        if (err == CL_SUCCESS) *mean_ms += event_span_ms(e, e);
+        if (e) clReleaseEvent(e);
+    }
+    *mean_ms /= iterations;
+    return err;
+}
+
+void run_layout_bench(const layout_bench_params_t* p) {
+    const cl_context context = p->context;
+    const cl_device_id device = p->device;
+    const gemm_shape_t* s = &p->shape;
+    float* C = p->C;
+    const int iterations = p->iterations;
+    const int panels = (s->n + 15) / 16;
+    const size_t a_bytes = (size_t)s->m * s->k * sizeof(float);
+    const size_t b_bytes = (size_t)s->k * s->n * sizeof(float);
+    const size_t c_bytes = (size_t)s->m * s->n * sizeof(float);
+    const size_t bp_bytes = (size_t)panels * 16 * s->k * sizeof(float);
+    const double flops = gemm_flops(s);
+    cl_command_queue queue = NULL;
+    cl_program program = NULL;
+    cl_kernel prep[LAYOUTS] = { NULL };
+    cl_kernel kernels[LAYOUTS] = { NULL };
+    cl_mem buf_A = NULL, buf_B = NULL, buf_C = NULL;
+    cl_mem buf_layout[LAYOUTS] = { NULL };   // the B each GEMM reads
+    cl_int err;
+
+    printf("--- B Layout Benchmark (%d x %d x %d, conversion once per B) ---\n", s->m, s->n, s->k);
+
+    // Default configuration: matmul_simple at VEC=16, like the packed kernel
+    char options[256];
+    config_build_options(&GEMM_DEFAULT_CONFIG, options, sizeof(options));
+    queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+    if (err == CL_SUCCESS) {
+        program = program_build(p->cache_dir, p->dev, context, device, p->source, p->source_length, options, 1,
+                                NULL, &err);
+    }
+    for (int l = 0; l < LAYOUTS && err == CL_SUCCESS; l++) {
+        kernels[l] = clCreateKernel(program, LAYOUT_GEMM[l], &err);
+        if (err == CL_SUCCESS && LAYOUT_PREP[l]) prep[l] = clCreateKernel(program, LAYOUT_PREP[l], &err);
+    }
+    if (err == CL_SUCCESS) buf_A = clCreateBuffer(context, CL_MEM_READ_ONLY, a_bytes, NULL, &err);
+    if (err == CL_SUCCESS) buf_B = clCreateBuffer(context, CL_MEM_READ_ONLY, b_bytes, NULL, &err);
+    if (err == CL_SUCCESS) buf_C = clCreateBuffer(context, CL_MEM_WRITE_ONLY, c_bytes, NULL, &err);
+    if (err == CL_SUCCESS) buf_layout[LAYOUT_TRANSPOSED] = clCreateBuffer(context, CL_MEM_READ_WRITE, b_bytes, NULL, &err);
+    if (err == CL_SUCCESS) buf_layout[LAYOUT_PACKED] = clCreateBuffer(context, CL_MEM_READ_WRITE, bp_bytes, NULL, &err);
+    if (err == CL_SUCCESS) err = clEnqueueWriteBuffer(queue, buf_A, CL_TRUE, 0, a_bytes, p->A, 0, NULL, NULL);
+    if (err == CL_SUCCESS) err = clEnqueueWriteBuffer(queue, buf_B, CL_TRUE, 0, b_bytes, p->B, 0, NULL, NULL);
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Layout benchmark setup failed (%s)\n\n", cl_error_string(err));
+        goto done;
+    }
+    buf_layout[LAYOUT_ROW_MAJOR] = buf_B;
+
+    {
+        double prep_ms[LAYOUTS] = { 0.0 };
+        double gemm_ms[LAYOUTS] = { 0.0 };
+        variant_result_t check[LAYOUTS];
+        memset(check, 0, sizeof(check));
+
+        for (int l = 0; l < LAYOUTS && err == CL_SUCCESS; l++) {
+            if (prep[l]) {
+                // Over B (K x N): transpose_b takes 4 x 4 blocks, pack_b one
+                // float16 of a panel per work-item
+                const gemm_shape_t b_shape = { s->k, s->n, 0 };
+                const gemm_geometry_t pg = { l == LAYOUT_TRANSPOSED ? 4 : 16, l == LAYOUT_TRANSPOSED ? 4 : 1, 0, 0 };
+                size_t global[2];
+                gemm_global_size(&pg, &b_shape, global);
+                err = clSetKernelArg(prep[l], 0, sizeof(cl_mem), &buf_B);
+                err |= clSetKernelArg(prep[l], 1, sizeof(cl_mem), &buf_layout[l]);
+                err |= clSetKernelArg(prep[l], 2, sizeof(int), &s->k);
+                err |= clSetKernelArg(prep[l], 3, sizeof(int), &s->n);
+                if (err == CL_SUCCESS) err = layout_time(queue, prep[l], global, iterations, &prep_ms[l]);
+            }
+
+            const gemm_geometry_t g = { LAYOUT_COLS[l], 1, 0, 0 };
+            size_t global[2];
+            gemm_global_size(&g, s, global);
+            const gemm_launch_t launch = { buf_A, buf_layout[l], buf_C, *s };
+            const float poison = NAN;
+            if (err == CL_SUCCESS) err = set_gemm_args(kernels[l], &launch);
+            if (err == CL_SUCCESS) {
+                err = clEnqueueFillBuffer(queue, buf_C, &poison, sizeof(poison), 0, c_bytes, 0, NULL, NULL);
+            }
+            if (err == CL_SUCCESS) err = layout_time(queue, kernels[l], global, iterations, &gemm_ms[l]);
+            if (err == CL_SUCCESS) err = clEnqueueReadBuffer(queue, buf_C, CL_TRUE, 0, c_bytes, C, 0, NULL, NULL);
+            if (err == CL_SUCCESS) compare_results(p->ref, C, &check[l]);
+        }
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Layout benchmark failed (%s)\n\n", cl_error_string(err));
+            goto done;
+        }
+
+        printf("%-11s %-14s %9s %9s %9s %12s %10s\n", "B layout", "GEMM kernel", "Prep ms", "GEMM ms", "GFLOPS",
+               "Break-even", "Max error");
+        for (int l = 0; l < LAYOUTS; l++) {
+            char break_even[32];
+            const double saving = gemm_ms[LAYOUT_ROW_MAJOR] - gemm_ms[l];
+            if (l == LAYOUT_ROW_MAJOR) {
+                snprintf(break_even, sizeof(break_even), "-");
+            } else if (saving > 0.0) {
+                snprintf(break_even, sizeof(break_even), "%.0f products", ceil(prep_ms[l] / saving));
+            } else {
+                snprintf(break_even, sizeof(break_even), "never");
+            }
+            printf("%-11s %-14s %9.3f %9.3f %9.3f %12s %10.6f%s\n", LAYOUT_NAMES[l], LAYOUT_GEMM[l], prep_ms[l],
+                   gemm_ms[l], flops / (gemm_ms[l] * 1e6), break_even, check[l].max_error,
+                   check[l].error_count ? " (errors!)" : "");
+        }
+        printf("Device times from events. Break-even: products with one B after which\n"
+               "converting it once is cheaper than multiplying with it as uploaded.\n\n");
+    }
+
+done:
+    for (int l = 0; l < LAYOUTS; l++) {
+        if (prep[l]) clReleaseKernel(prep[l]);
+        if (kernels[l]) clReleaseKernel(kernels[l]);
+    }
+    if (buf_layout[LAYOUT_TRANSPOSED]) clReleaseMemObject(buf_layout[LAYOUT_TRANSPOSED]);
+    if (buf_layout[LAYOUT_PACKED]) clReleaseMemObject(buf_layout[LAYOUT_PACKED]);
+    if (buf_A) clReleaseMemObject(buf_A);
+    if (buf_B) clReleaseMemObject(buf_B);
+    if (buf_C) clReleaseMemObject(buf_C);
+    if (program) clReleaseProgram(program);
+    if (queue) clReleaseCommandQueue(queue);
+}
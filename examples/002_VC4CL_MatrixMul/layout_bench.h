@@ -0,0 +1,41 @@
+/**
+ * B layouts: row-major, transposed and packed on the device (--layout-bench)
+ *
+ * Times the GEMM kernel that reads each layout of B and the kernel that
+ * converts B into it. Uses its own queue, program and buffers, fed from the
+ * host copies of A and B.
+ */
+
+#ifndef LAYOUT_BENCH_H
+#define LAYOUT_BENCH_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "bench_common.h"
+#include "tiling.h"
+#include "tune_cache.h"
+
+typedef struct {
+    cl_context context;       // gets a queue, program and buffers of its own
+    cl_device_id device;
+    const tune_device_t* dev;  // program cache key
+    const char* source;       // matmul.cl
+    size_t source_length;
+    const float* A;           // host operands, uploaded once
+    const float* B;
+    float* C;
+    gemm_shape_t shape;
+    const reference_t* ref;
+    int iterations;
+    const char* cache_dir;    // program binary cache; NULL = always compile
+} layout_bench_params_t;
+
+// Each layout's conversion and GEMM device time, and after how many
+// products with one B the conversion pays off
+void run_layout_bench(const layout_bench_params_t* p);
+
+#endif // LAYOUT_BENCH_H
@@ -0,0 +1,84 @@
+/**
+ * Reuse of one gemm_lib handle
+ */
+
+#include "library_bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gemm_lib.h"
+
+void run_library_bench(const library_bench_params_t* p) {
+    const gemm_variant_t* v = p->variant;
+    const float* A = p->A;
+    const float* B = p->B;
+    float* C = p->C;
+    const gemm_shape_t* s = &p->shape;
+    const int calls = p->calls;
+    const double flops = gemm_flops(s);
+    gemm_options_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.device = p->device;
+    opt.variant = v->name;
+    opt.tune_file = p->tune_file;
+    opt.cache_dir = p->cache_dir;
+
+    printf("--- Library Reuse (variant %s, %d calls) ---\n", v->name, calls);
+
+    cl_int err;
+    gemm_handle_t* h = gemm_open(&opt, &err);
+    if (!h) {
+        fprintf(stderr, "Error: gemm_open failed (%s)\n\n", cl_error_string(err));
+        return;
+    }
+
+    // The first call allocates the pool's buffers
+    double start = get_time_ms();
+    err = gemm(h, A, B, C, s->m, s->n, s->k);
+    const double first_ms = get_time_ms() - start;
+
+    double sync_ms = 0.0;
+    start = get_time_ms();
+    for (int i = 0; i < calls && err == CL_SUCCESS; i++) {
+        err = gemm(h, A, B, C, s->m, s->n, s->k);
+    }
+    sync_ms = (get_time_ms() - start) / calls;
+
+    // Only the last call's event is waited on: the queue runs them in order
+    double async_ms = 0.0;
+    cl_event last = NULL;
+    start = get_time_ms();
+    for (int i = 0; i < calls && err == CL_SUCCESS; i++) {
+        if (last) clReleaseEvent(last);
+        last = NULL;
+        err = gemm_async(h, A, B, C, s->m, s->n, s->k, &last);
+    }
+    if (last) {
+        cl_int wait_err = clWaitForEvents(1, &last);
+        if (err == CL_SUCCESS) err = wait_err;
+        clReleaseEvent(last);
+    }
+    async_ms = (get_time_ms() - start) / calls;
+
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Library call failed (%s)\n\n", cl_error_string(err));
+    } else {
+        variant_result_t check;
+        compare_results(p->ref, C, &check);
+        gemm_stats_t st;
+        gemm_get_stats(h, &st);
+        printf("%-12s %10s %10s\n", "Step", "ms", "GFLOPS");
+        printf("%-12s %10.2f %10s  (program %s, config %s)\n", "gemm_open", st.open_ms, "-",
+               st.program_cached ? "cached" : "compiled", st.config_source);
+        printf("%-12s %10.2f %10.3f\n", "first call", first_ms, flops / (first_ms * 1e6));
+        printf("%-12s %10.2f %10.3f\n", "gemm", sync_ms, flops / (sync_ms * 1e6));
+        printf("%-12s %10.2f %10.3f\n", "gemm_async", async_ms, flops / (async_ms * 1e6));
+        printf("Setup is %.1f calls' worth; over %lu calls it adds %.2f ms per call\n",
+               st.open_ms / sync_ms, st.calls, st.open_ms / st.calls);
+        printf("Pool: %lu hits, %lu allocations, %.1f KB held\n", st.pool_hits, st.pool_misses,
+               st.pool_bytes / 1024.0);
+        printf("Max error %.6f (%d/%zu > 1e-3)\n\n", check.max_error, check.error_count, p->ref->count);
+    }
+    gemm_close(h);
+}
@@ -0,0 +1,32 @@
+/**
+ * Reuse of one gemm_lib handle (--library)
+ *
+ * Opening a handle pays for the context, the program and the kernel once.
+ * The benchmark sets that cost against blocking and asynchronous calls on
+ * the same handle, whose buffer pool is filled by the first call.
+ */
+
+#ifndef LIBRARY_BENCH_H
+#define LIBRARY_BENCH_H
+
+#include "bench_common.h"
+#include "gemm_kernels.h"
+
+typedef struct {
+    const char* device;       // index or name as for --device
+    const gemm_variant_t* variant;
+    const float* A;
+    const float* B;
+    float* C;
+    gemm_shape_t shape;
+    const reference_t* ref;
+    int calls;                // products per flow
+    const char* tune_file;    // tuned configurations to use if present
+    const char* cache_dir;    // program binary cache; NULL = always compile
+} library_bench_params_t;
+
+// One handle serving `calls` blocking products, then `calls` asynchronous
+// ones enqueued back to back, against the one-off cost of opening it
+void run_library_bench(const library_bench_params_t* p);
+
+#endif // LIBRARY_BENCH_H
@@ -2,7 +2,13 @@
  * VC4CL OpenCL Matrix Multiplication for Raspberry Pi 3B
  * * Uses the VC4CL OpenCL implementation for VideoCore IV QPUs
  * * Build: cmake .. && make
- * Run:   ./vc4cl_mm [matrix_size] [iterations]
+ * Run:   ./vc4cl_mm [matrix_size] [iterations] [--shape MxNxK] [--max-alloc bytes]
+ *               [--variant name|all] [--tune] [--tune-file path]
+ *               [--cache-dir path] [--no-cache] [--profile] [--json path]
+ *               [--memory copy|alloc|use] [--memory-bench] [--batch count] [--batch-slots n]
+ *               [--coexec] [--cpu-threads n]
+ *               [--list-devices] [--device sel] [--multi-device sel,...|all]
+ *               [--library calls] [--blas] [--primitives] [--layout-bench]
  */
 
 #define CL_TARGET_OPENCL_VERSION 120
@@ -10,476 +16,1120 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
-#include <time.h>
-#include <errno.h>
+
+#include "batch_bench.h"
+#include "bench_common.h"
+#include "blas_bench.h"
+#include "coexec.h"
+#include "cpu_gemm.h"
+#include "devices.h"
+#include "gemm_kernels.h"
+#include "gemm_lib.h"
+#include "half_float.h"
+#include "host_buffers.h"
+#include "layout_bench.h"
+#include "library_bench.h"
+#include "memory_bench.h"
+#include "multi_device.h"
+#include "primitives_bench.h"
+#include "profile.h"
+#include "program_cache.h"
+#include "report.h"
+#include "tiling.h"
+#include "tune_cache.h"
+#include "tuner.h"
+#include "variant_bench.h"
 
 // ============================================================================
 // Configuration
 // ============================================================================
 
-static int MATRIX_DIM = 64;
+static gemm_shape_t SHAPE = { 64, 64, 64 };     // [size] or --shape MxNxK
+static size_t MAX_ALLOC_CAP = 0;                 // --max-alloc: 0 = device limit
 static int NUM_ITERATIONS = 10;
+static const char* VARIANT_NAME = "all";
+static int TUNE = 0;                              // --tune: sweep and persist configs
+static const char* TUNE_FILE = "vc4cl_tune.cfg";  // --tune-file
+static const int TUNE_ITERATIONS = 3;             // timed runs per tuning candidate
+static const char* CACHE_DIR = "vc4cl_cache";     // --cache-dir; NULL = --no-cache
+static int PROFILE = 0;                           // --profile: OpenCL event timestamps
+static const char* JSON_PATH = NULL;              // --json: machine-readable report
+static mem_mode_t MEMORY_MODE = MEM_COPY;         // --memory: how A, B, C reach the device
+static int MEMORY_BENCH = 0;                      // --memory-bench: copy vs zero-copy sweep
+static int BATCH_COUNT = 0;                       // --batch: products streamed serial vs pipelined
+static int BATCH_SLOTS = 3;                       // --batch-slots: buffer sets in the pipeline pool
+static int COEXEC = 0;                            // --coexec: split C's rows between GPU and CPU
+static int CPU_THREADS = 0;                       // --cpu-threads: 0 = all available
+static int LIST_DEVICES = 0;                      // --list-devices: print and exit
+static const char* DEVICE_SELECTOR = NULL;        // --device: index or name, NULL = first GPU
+static const char* MULTI_DEVICE = NULL;           // --multi-device: devices to split C's rows across
+static int LIBRARY_CALLS = 0;                     // --library: products through one gemm_lib handle
+static int BLAS_BENCH = 0;                        // --blas: SGEMV, SAXPY and reductions vs the CPU
+static int PRIMITIVES_BENCH = 0;                  // --primitives: scan, histogram and compaction vs the CPU
+static int LAYOUT_BENCH = 0;                      // --layout-bench: B transposed/packed on the device
+
+// Largest product (M*N*K multiply-adds) the CPU reference computes in full;
+// beyond it only REFERENCE_SAMPLES elements of C are computed and checked
+static const double FULL_REFERENCE_MACS = 1024.0 * 1024.0 * 1024.0;
+static const int REFERENCE_SAMPLES = 4096;
 
 // ============================================================================
 // Utility Functions
 // ============================================================================
 
-static double get_time_ms(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [matrix_size] [iterations] [--shape MxNxK] [--max-alloc bytes]\n"
+                    "       [--variant name|all] [--tune] [--tune-file path]\n"
+                    "       [--cache-dir path] [--no-cache] [--profile] [--json path]\n"
+                    "       [--memory copy|alloc|use] [--memory-bench] [--batch count] [--batch-slots n]\n"
+                    "       [--coexec] [--cpu-threads n]\n"
+                    "       [--list-devices] [--device sel] [--multi-device sel,...|all]\n"
+                    "       [--library calls] [--blas] [--primitives] [--layout-bench]\n", prog);
+    fprintf(stderr, "Variants:\n");
+    for (int i = 0; i < GEMM_NUM_VARIANTS; i++) {
+        fprintf(stderr, "  %-8s %s\n", GEMM_VARIANTS[i].name, GEMM_VARIANTS[i].description);
+    }
 }
 
-static char* load_kernel_source(const char* filename, size_t* length) {
-    FILE* f = fopen(filename, "rb");
-    if (!f) {
-        fprintf(stderr, "Error: Cannot open kernel file '%s': %s\n", 
-                filename, strerror(errno));
-        return NULL;
-    }
-    
-    fseek(f, 0, SEEK_END);
-    *length = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    char* source = (char*)malloc(*length + 1);
-    if (!source) {
-        fclose(f);
-        return NULL;
-    }
-    
-    size_t read_size = fread(source, 1, *length, f);
-    source[read_size] = '\0';
-    *length = read_size;
-    fclose(f);
-    
-    return source;
+// ============================================================================
+// Main Program
+// ============================================================================
+
+// Everything one benchmark run owns. Each phase below returns nonzero on
+// failure and leaves what it set up here, for bench_release() to free.
+typedef struct {
+    gemm_shape_t shape;
+    size_t a_bytes;
+    size_t b_bytes;           // B and B^T
+    size_t c_bytes;
+    int full_reference;
+
+    device_entry_t* device_entries;
+    int device_count;
+    int device_index;
+    int multi_indices[MAX_MULTI_DEVICES];
+    int multi_count;
+    const device_entry_t* entry;
+    tune_device_t tune_dev;
+    size_t max_alloc;
+    size_t base_align;
+
+    gemm_context_t cl;
+    char* source;
+    size_t source_length;
+    cl_program programs[GEMM_NUM_VARIANTS];
+    cl_kernel kernels[GEMM_NUM_VARIANTS];
+    variant_result_t results[GEMM_NUM_VARIANTS];
+    int need_b;
+    int need_bt;
+    int need_half;
+    build_stats_t build_stats;
+    double context_ms;
+    double build_ms;
+
+    // Operands beyond the device's single-buffer limit live in `tiling`
+    int tiled;
+    gemm_tiling_t tiling;
+    gemm_launch_t* launches;       // per tile, B operand
+    gemm_launch_t* launches_bt;    // per tile, B^T operand
+    int num_launches;
+
+    cl_mem buf_A;
+    cl_mem buf_B;
+    cl_mem buf_BT;
+    cl_mem buf_C;
+    cl_mem buf_A16;                // half-precision A and B for 'half'
+    cl_mem buf_B16;
+    float* backing[6];             // USE_HOST_PTR memory of A, B, C, BT, A16, B16
+    float* A;
+    float* B;
+    float* BT;
+    uint16_t* A16;
+    uint16_t* B16;
+    float* C_cpu;
+    float* C_gpu;
+    size_t* ref_idx;
+    reference_t ref;
+
+    double cpu_avg;
+    double cpu_gflops;
+    int cpu_estimated;
+    double transpose_ms;
+    double convert_ms;
+    double upload_ms[5];           // A, B, BT, A16, B16 host-side
+    profile_log_t profile_log;
+    profile_log_t* log;            // non-NULL in --profile mode
+} bench_t;
+
+static void bench_init(bench_t* b, const gemm_shape_t* shape) {
+    memset(b, 0, sizeof(*b));
+    b->shape = *shape;
+    b->a_bytes = (size_t)shape->m * shape->k * sizeof(float);
+    b->b_bytes = (size_t)shape->k * shape->n * sizeof(float);
+    b->c_bytes = (size_t)shape->m * shape->n * sizeof(float);
+    b->full_reference = (double)shape->m * shape->n * shape->k <= FULL_REFERENCE_MACS;
+    b->num_launches = 1;
 }
 
-static const char* cl_error_string(cl_int err) {
-    switch (err) {
-        case CL_SUCCESS: return "CL_SUCCESS";
-        case CL_DEVICE_NOT_FOUND: return "CL_DEVICE_NOT_FOUND";
-        case CL_DEVICE_NOT_AVAILABLE: return "CL_DEVICE_NOT_AVAILABLE";
-        case CL_COMPILER_NOT_AVAILABLE: return "CL_COMPILER_NOT_AVAILABLE";
-        case CL_MEM_OBJECT_ALLOCATION_FAILURE: return "CL_MEM_OBJECT_ALLOCATION_FAILURE";
-        case CL_OUT_OF_RESOURCES: return "CL_OUT_OF_RESOURCES";
-        case CL_OUT_OF_HOST_MEMORY: return "CL_OUT_OF_HOST_MEMORY";
-        case CL_BUILD_PROGRAM_FAILURE: return "CL_BUILD_PROGRAM_FAILURE";
-        case CL_INVALID_VALUE: return "CL_INVALID_VALUE";
-        case CL_INVALID_DEVICE: return "CL_INVALID_DEVICE";
-        case CL_INVALID_CONTEXT: return "CL_INVALID_CONTEXT";
-        case CL_INVALID_QUEUE_PROPERTIES: return "CL_INVALID_QUEUE_PROPERTIES";
-        case CL_INVALID_COMMAND_QUEUE: return "CL_INVALID_COMMAND_QUEUE";
-        case CL_INVALID_MEM_OBJECT: return "CL_INVALID_MEM_OBJECT";
-        case CL_INVALID_PROGRAM: return "CL_INVALID_PROGRAM";
-        case CL_INVALID_PROGRAM_EXECUTABLE: return "CL_INVALID_PROGRAM_EXECUTABLE";
-        case CL_INVALID_KERNEL_NAME: return "CL_INVALID_KERNEL_NAME";
-        case CL_INVALID_KERNEL_DEFINITION: return "CL_INVALID_KERNEL_DEFINITION";
-        case CL_INVALID_KERNEL: return "CL_INVALID_KERNEL";
-        case CL_INVALID_ARG_INDEX: return "CL_INVALID_ARG_INDEX";
-        case CL_INVALID_ARG_VALUE: return "CL_INVALID_ARG_VALUE";
-        case CL_INVALID_ARG_SIZE: return "CL_INVALID_ARG_SIZE";
-        case CL_INVALID_KERNEL_ARGS: return "CL_INVALID_KERNEL_ARGS";
-        case CL_INVALID_WORK_DIMENSION: return "CL_INVALID_WORK_DIMENSION";
-        case CL_INVALID_WORK_GROUP_SIZE: return "CL_INVALID_WORK_GROUP_SIZE";
-        case CL_INVALID_WORK_ITEM_SIZE: return "CL_INVALID_WORK_ITEM_SIZE";
-        case CL_INVALID_GLOBAL_OFFSET: return "CL_INVALID_GLOBAL_OFFSET";
-        default: return "Unknown OpenCL error";
+static void bench_release(bench_t* b) {
+    // OpenCL resources
+    if (b->buf_A) clReleaseMemObject(b->buf_A);
+    if (b->buf_B) clReleaseMemObject(b->buf_B);
+    if (b->buf_BT) clReleaseMemObject(b->buf_BT);
+    if (b->buf_A16) clReleaseMemObject(b->buf_A16);
+    if (b->buf_B16) clReleaseMemObject(b->buf_B16);
+    if (b->buf_C) clReleaseMemObject(b->buf_C);
+    gemm_tiling_release(&b->tiling);
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        if (b->kernels[v]) clReleaseKernel(b->kernels[v]);
+        if (b->programs[v]) clReleaseProgram(b->programs[v]);
+    }
+    gemm_context_close(&b->cl);
+
+    // Host memory; in the zero-copy modes A, B and their copies were mappings
+    for (int i = 0; i < 6; i++) free(b->backing[i]);
+    profile_free(&b->profile_log);
+    free(b->source);
+    if (MEMORY_MODE == MEM_COPY) {
+        free(b->A);
+        free(b->B);
+        free(b->BT);
+        free(b->A16);
+        free(b->B16);
     }
+    free(b->C_cpu);
+    free(b->C_gpu);
+    free(b->ref_idx);
+    free(b->launches);
+    free(b->launches_bt);
+    free(b->device_entries);
 }
 
-// ============================================================================
-// CPU Reference Implementation
-// ============================================================================
+// The device, its limits, and whether the operands must be tiled
+static int bench_open_device(bench_t* b) {
+    const gemm_shape_t* shape = &b->shape;
+    cl_int err;
+
+    // Every device of every platform, so VC4CL and POCL side by side both show
+    b->device_count = device_list(&b->device_entries, &err);
+    if (b->device_count == 0) {
+        fprintf(stderr, "Error: No OpenCL devices found (%s)\n", cl_error_string(err));
+        return 1;
+    }
+    if (LIST_DEVICES) {
+        device_print_list(b->device_entries, b->device_count);
+        return 0;
+    }
+
+    // Prefer the first GPU; any device will do so the tuner also runs on POCL
+    b->device_index = DEVICE_SELECTOR ? device_find(b->device_entries, b->device_count, DEVICE_SELECTOR)
+                                      : device_default(b->device_entries, b->device_count);
+    if (b->device_index < 0) {
+        fprintf(stderr, "No device matches '%s'\n", DEVICE_SELECTOR);
+        device_print_list(b->device_entries, b->device_count);
+        return 1;
+    }
+    if (MULTI_DEVICE) {
+        const char* bad = NULL;
+        b->multi_count = device_parse_set(b->device_entries, b->device_count, MULTI_DEVICE, b->multi_indices,
+                                          MAX_MULTI_DEVICES, &bad);
+        if (b->multi_count < 0) {
+            fprintf(stderr, "No device matches '%s' (at most %d devices)\n", bad, MAX_MULTI_DEVICES);
+            device_print_list(b->device_entries, b->device_count);
+            return 1;
+        }
+    }
+
+    const device_entry_t* entry = &b->device_entries[b->device_index];
+    b->entry = entry;
+    b->tune_dev = entry->id;
+    printf("Platform: %s\n", b->tune_dev.platform);
+    if (entry->type & CL_DEVICE_TYPE_GPU) {
+        printf("Device %d: %s (driver %s)\n", b->device_index, b->tune_dev.device, b->tune_dev.driver);
+    } else {
+        printf("Device %d: %s (%s, driver %s)\n", b->device_index, b->tune_dev.device,
+               device_type_name(entry->type), b->tune_dev.driver);
+    }
+
+    printf("Max work group size: %zu\n", entry->max_work_group_size);
+    printf("Max compute units: %u\n", entry->compute_units);
+
+    const cl_ulong device_max_alloc = entry->max_alloc;
+    cl_uint base_align_bits = 0;
+    clGetDeviceInfo(entry->device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(base_align_bits), &base_align_bits, NULL);
+    b->max_alloc = (size_t)device_max_alloc;
+    if (MAX_ALLOC_CAP > 0 && (b->max_alloc == 0 || MAX_ALLOC_CAP < b->max_alloc)) b->max_alloc = MAX_ALLOC_CAP;
+    b->base_align = base_align_bits >= 8 ? base_align_bits / 8 : 4096;
+    printf("Max buffer allocation: %.1f MB%s\n", b->max_alloc / (1024.0 * 1024.0),
+           b->max_alloc < device_max_alloc ? " (capped by --max-alloc)" : "");
 
-static void cpu_matrix_multiply(const float* A, const float* B, float* C, int n) {
-    for (int row = 0; row < n; row++) {
-        for (int col = 0; col < n; col++) {
-            float sum = 0.0f;
-            for (int k = 0; k < n; k++) {
-                sum += A[row * n + k] * B[k * n + col];
+    // Tiled operands are split across many buffers, which the zero-copy
+    // modes (one mapping per matrix) and the tuner (one launch) do not handle
+    b->tiled = gemm_needs_tiling(shape, b->max_alloc);
+    if (b->tiled && MEMORY_MODE != MEM_COPY) {
+        printf("Operands exceed one buffer: using copy mode instead of %s\n", mem_mode_name(MEMORY_MODE));
+        MEMORY_MODE = MEM_COPY;
+    }
+    if (b->tiled && TUNE) {
+        printf("Operands exceed one buffer: not tuning, tune at a size that fits\n");
+        TUNE = 0;
+    }
+
+    printf("\nMatrix shape: C (%d x %d) = A (%d x %d) * B (%d x %d)\n",
+           shape->m, shape->n, shape->m, shape->k, shape->k, shape->n);
+    printf("Buffers: %s\n", b->tiled ? "tiled into sub-buffers" : "one per matrix");
+    printf("Iterations: %d\n", NUM_ITERATIONS);
+    printf("Variant: %s\n", VARIANT_NAME);
+    printf("Tune cache: %s%s\n", TUNE_FILE, TUNE ? " (tuning)" : "");
+    printf("Program cache: %s\n", CACHE_DIR ? CACHE_DIR : "disabled");
+    printf("Profiling: %s\n", PROFILE ? "OpenCL events" : "off (host timers)");
+    printf("Memory: %s\n", MEMORY_MODE == MEM_COPY ? "copy (write/read buffers)" :
+           MEMORY_MODE == MEM_ALLOC_HOST_PTR ? "zero-copy, CL_MEM_ALLOC_HOST_PTR + map" :
+           "zero-copy, CL_MEM_USE_HOST_PTR + map");
+    printf("FLOPs per matmul: %.0f (2*M*N*K)\n\n", gemm_flops(shape));
+    return 0;
+}
+
+// Context, queue and kernel source, timed together as the startup cost
+static int bench_open_context(bench_t* b) {
+    double start = get_time_ms();
+
+    // Event timestamps cost a little per command, so only with --profile
+    cl_int err = gemm_context_open(b->entry->device, PROFILE ? CL_QUEUE_PROFILING_ENABLE : 0, &b->cl);
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Failed to create context and command queue (%s)\n", cl_error_string(err));
+        return 1;
+    }
+
+    b->source = load_kernel_source("matmul.cl", &b->source_length);
+    if (!b->source) return 1;
+    b->context_ms = get_time_ms() - start;
+    return 0;
+}
+
+// Cached configurations apply to this exact platform/device/driver only;
+// one whose work-group the device rejects falls back to the default
+static void bench_select_configs(bench_t* b) {
+    const size_t max_work_group_size = b->entry->max_work_group_size;
+
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        variant_result_t* r = &b->results[v];
+        r->variant = &GEMM_VARIANTS[v];
+        r->config = GEMM_DEFAULT_CONFIG;
+        r->config_source = "default";
+        if (!variant_selected(VARIANT_NAME, &GEMM_VARIANTS[v])) {
+            r->skipped = "not selected";
+            continue;
+        }
+
+        int tuned_size = 0;
+        gemm_config_t cached;
+        if (!TUNE && tune_cache_load(TUNE_FILE, &b->tune_dev, GEMM_VARIANTS[v].name, &cached, &tuned_size, NULL)) {
+            gemm_geometry_t g = variant_geometry(&GEMM_VARIANTS[v], &cached);
+            if (!variant_unsupported(&g, max_work_group_size)) {
+                r->config = cached;
+                r->config_source = "cached";
+            } else {
+                printf("Cached '%s' config (tuned at %d) exceeds the work-group limit, using default\n",
+                       GEMM_VARIANTS[v].name, tuned_size);
             }
-            C[row * n + col] = sum;
         }
+
+        // The tuner searches its own configurations, so only check the fixed ones
+        gemm_geometry_t g = variant_geometry(&GEMM_VARIANTS[v], &r->config);
+        if (!TUNE) r->skipped = variant_unsupported(&g, max_work_group_size);
+        if (!r->skipped && b->tiled && GEMM_VARIANTS[v].kind == GEMM_HALF) r->skipped = "half storage is not tiled";
+        if (r->skipped) continue;
+        if (GEMM_VARIANTS[v].kind == GEMM_HALF) b->need_half = 1;
+        else if (GEMM_VARIANTS[v].transposed_b) b->need_bt = 1;
+        else b->need_b = 1;
     }
 }
 
-// ============================================================================
-// Main Program
-// ============================================================================
+// In the zero-copy modes A, B and B^T are generated straight into the
+// mapped OpenCL buffers instead of separate host arrays
+static int bench_alloc_host(bench_t* b) {
+    b->C_cpu = (float*)malloc(b->c_bytes);
+    b->C_gpu = (float*)malloc(b->c_bytes);
+    if (!b->full_reference) b->ref_idx = (size_t*)malloc(REFERENCE_SAMPLES * sizeof(size_t));
+    if (MEMORY_MODE == MEM_COPY) {
+        b->A = (float*)malloc(b->a_bytes);
+        b->B = (float*)malloc(b->b_bytes);
+        if (b->need_bt) b->BT = (float*)malloc(b->b_bytes);
+        if (b->need_half) {
+            b->A16 = (uint16_t*)malloc(b->a_bytes / 2);
+            b->B16 = (uint16_t*)malloc(b->b_bytes / 2);
+        }
+    }
 
-int main(int argc, char* argv[]) {
+    if (!b->C_cpu || !b->C_gpu || (!b->full_reference && !b->ref_idx) ||
+        (MEMORY_MODE == MEM_COPY && (!b->A || !b->B || (b->need_bt && !b->BT) ||
+                                     (b->need_half && (!b->A16 || !b->B16))))) {
+        fprintf(stderr, "Error: Failed to allocate host memory\n");
+        return 1;
+    }
+    return 0;
+}
+
+// One buffer per matrix, or the tiled sub-buffers; mapped for the host in
+// the zero-copy modes
+static int bench_create_buffers(bench_t* b) {
+    const cl_context context = b->cl.context;
+    const cl_command_queue queue = b->cl.queue;
     cl_int err;
-    int ret = 0;
-    
-    // Parse command line arguments
-    if (argc >= 2) {
-       MATRIX_DIM = atoi(argv[1]);
-       // Increased limit to 1024 to test GPU scaling
-       if (MATRIX_DIM < 8 || MATRIX_DIM > 1024) {
-           fprintf(stderr, "Matrix dimension must be between 8 and 1024\n");
-           return 1;
-       }
-   }
-    if (argc >= 3) {
-        NUM_ITERATIONS = atoi(argv[2]);
-        if (NUM_ITERATIONS < 1 || NUM_ITERATIONS > 100) {
-            fprintf(stderr, "Iterations must be between 1 and 100\n");
+
+    if (PROFILE) b->log = &b->profile_log;
+
+    if (b->tiled) {
+        // Panels as tall and blocks as wide as the limit allows
+        int mb = 0, nb = 0;
+        if (gemm_tiling_choose(&b->shape, b->max_alloc, &mb, &nb) != 0) {
+            fprintf(stderr, "Error: K = %d is too large to tile under a %zu-byte buffer limit\n",
+                    b->shape.k, b->max_alloc);
+            return 1;
+        }
+        err = gemm_tiling_create(context, &b->shape, mb, nb, b->need_b, b->need_bt, b->max_alloc, b->base_align,
+                                 &b->tiling);
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to create tiled buffers (%s)\n", cl_error_string(err));
             return 1;
         }
+
+        const int tiles = b->tiling.row_panels * b->tiling.col_blocks;
+        b->launches = (gemm_launch_t*)calloc(tiles, sizeof(gemm_launch_t));
+        b->launches_bt = (gemm_launch_t*)calloc(tiles, sizeof(gemm_launch_t));
+        if (!b->launches || !b->launches_bt) {
+            fprintf(stderr, "Error: Failed to allocate host memory\n");
+            return 1;
+        }
+        if (b->need_b) b->num_launches = gemm_tiling_launches(&b->tiling, 0, b->launches);
+        if (b->need_bt) b->num_launches = gemm_tiling_launches(&b->tiling, 1, b->launches_bt);
+        printf("Tiling: %d row panel(s) of %d rows x %d column block(s) of %d, A in %d buffer(s)\n\n",
+               b->tiling.row_panels, mb, b->tiling.col_blocks, nb, b->tiling.a.num_chunks);
+        return 0;
     }
-    
-    const int dim = MATRIX_DIM;
-    const int size = dim * dim;
-    const size_t bytes = size * sizeof(float);
-    
-    printf("=========================================\n");
-    printf(" VC4CL OpenCL Matrix Multiplication\n");
-    printf(" Target: Raspberry Pi 3B (VideoCore IV)\n");
-    printf("=========================================\n\n");
-    
-    // Initialize all pointers to NULL for safe cleanup
-    cl_context context = NULL;
-    cl_command_queue queue = NULL;
-    cl_program program = NULL;
-    cl_kernel kernel = NULL;
-    cl_mem buf_A = NULL;
-    cl_mem buf_B = NULL;
-    cl_mem buf_C = NULL;
-    float* A = NULL;
-    float* B = NULL;
-    float* C_cpu = NULL;
-    float* C_gpu = NULL;
-    char* source = NULL;
-
-    // --- FIX: Declare variables here to avoid jump errors ---
-    double cpu_total = 0.0;
-    double cpu_avg = 0.0;
-    double cpu_gflops = 0.0;
-    
-    double gpu_total = 0.0;
-    double gpu_avg = 0.0;
-    double gpu_gflops = 0.0;
-    
-    // VECTORIZATION: Launch 16x fewer threads in the X dimension
-    // Each thread will compute 16 elements at once.
-    size_t global_work_size[2] = { (size_t)dim / 16, (size_t)dim };
-    // --------------------------------------------------------
-    
-    // ========================================================================
-    // OpenCL Platform/Device Setup
-    // ========================================================================
-    
-    cl_platform_id platform;
-    cl_uint num_platforms;
-    err = clGetPlatformIDs(1, &platform, &num_platforms);
-    if (err != CL_SUCCESS || num_platforms == 0) {
-        fprintf(stderr, "Error: No OpenCL platforms found (%s)\n", cl_error_string(err));
+
+    b->buf_A = create_matrix_buffer(context, MEMORY_MODE, CL_MEM_READ_ONLY, b->a_bytes, &b->backing[0], &err);
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Failed to create buffer A (%s)\n", cl_error_string(err));
         return 1;
     }
-    
-    char platform_name[256];
-    clGetPlatformInfo(platform, CL_PLATFORM_NAME, sizeof(platform_name), platform_name, NULL);
-    printf("Platform: %s\n", platform_name);
-    
-    cl_device_id device;
-    cl_uint num_devices;
-    err = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, &num_devices);
-    if (err != CL_SUCCESS || num_devices == 0) {
-        fprintf(stderr, "Error: No GPU devices found (%s)\n", cl_error_string(err));
+
+    b->buf_B = create_matrix_buffer(context, MEMORY_MODE, CL_MEM_READ_ONLY, b->b_bytes, &b->backing[1], &err);
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Failed to create buffer B (%s)\n", cl_error_string(err));
         return 1;
     }
-    
-    char device_name[256];
-    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(device_name), device_name, NULL);
-    printf("Device: %s\n", device_name);
-    
-    size_t max_work_group_size;
-    clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_work_group_size), &max_work_group_size, NULL);
-    printf("Max work group size: %zu\n", max_work_group_size);
-    
-    cl_uint max_compute_units;
-    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(max_compute_units), &max_compute_units, NULL);
-    printf("Max compute units: %u\n", max_compute_units);
-    
-    printf("\nMatrix size: %dx%d (%d elements)\n", dim, dim, size);
-    printf("Iterations: %d\n", NUM_ITERATIONS);
-    printf("FLOPs per matmul: %lld (2*N^3)\n\n", 2LL * dim * dim * dim);
-    
-    // ========================================================================
-    // Create OpenCL Context and Command Queue
-    // ========================================================================
-    
-    context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+
+    b->buf_C = create_matrix_buffer(context, MEMORY_MODE, CL_MEM_WRITE_ONLY, b->c_bytes, &b->backing[2], &err);
     if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create context (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
+        fprintf(stderr, "Error: Failed to create buffer C (%s)\n", cl_error_string(err));
+        return 1;
     }
-    
-    queue = clCreateCommandQueue(context, device, 0, &err);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create command queue (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
-    }
-    
-    // ========================================================================
-    // Load and Build Kernel
-    // ========================================================================
-    
-    printf("--- Building Kernel ---\n");
-    
-    size_t source_length;
-    source = load_kernel_source("matmul.cl", &source_length);
-    if (!source) {
-        ret = 1;
-        goto cleanup;
+
+    if (b->need_bt) {
+        b->buf_BT = create_matrix_buffer(context, MEMORY_MODE, CL_MEM_READ_ONLY, b->b_bytes, &b->backing[3], &err);
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to create buffer BT (%s)\n", cl_error_string(err));
+            return 1;
+        }
     }
-    
-    program = clCreateProgramWithSource(context, 1, (const char**)&source, &source_length, &err);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create program (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
+
+    if (b->need_half) {
+        b->buf_A16 = create_matrix_buffer(context, MEMORY_MODE, CL_MEM_READ_ONLY, b->a_bytes / 2, &b->backing[4], &err);
+        if (err == CL_SUCCESS) {
+            b->buf_B16 = create_matrix_buffer(context, MEMORY_MODE, CL_MEM_READ_ONLY, b->b_bytes / 2, &b->backing[5], &err);
+        }
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to create half buffers (%s)\n", cl_error_string(err));
+            return 1;
+        }
     }
-    
-    // Build with optimization flags for VC4CL
-    err = clBuildProgram(program, 1, &device, "-cl-fast-relaxed-math", NULL, NULL);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to build program (%s)\n", cl_error_string(err));
-        
-        // Get build log
-        size_t log_size;
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
-        char* log = (char*)malloc(log_size + 1);
-        if (log) {
-            clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, log_size, log, NULL);
-            log[log_size] = '\0';
-            fprintf(stderr, "Build log:\n%s\n", log);
-            free(log);
-        }
-        
-        ret = 1;
-        goto cleanup;
-    }
-    printf("Kernel compiled successfully\n\n");
-    
-    kernel = clCreateKernel(program, "matmul_simple", &err);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create kernel (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
-    }
-    
-    // ========================================================================
-    // Allocate Host Memory
-    // ========================================================================
-    
-    A = (float*)malloc(bytes);
-    B = (float*)malloc(bytes);
-    C_cpu = (float*)malloc(bytes);
-    C_gpu = (float*)malloc(bytes);
-    
-    if (!A || !B || !C_cpu || !C_gpu) {
-        fprintf(stderr, "Error: Failed to allocate host memory\n");
-        ret = 1;
-        goto cleanup;
+
+    if (MEMORY_MODE != MEM_COPY) {
+        const cl_map_flags flags = CL_MAP_WRITE_INVALIDATE_REGION;
+        b->A = map_for_host(queue, b->buf_A, flags, b->a_bytes, b->log, "A", &err);
+        if (b->A) b->B = map_for_host(queue, b->buf_B, flags, b->b_bytes, b->log, "B", &err);
+        if (b->B && b->need_bt) b->BT = map_for_host(queue, b->buf_BT, flags, b->b_bytes, b->log, "BT", &err);
+        if (b->B && b->need_half) {
+            b->A16 = (uint16_t*)map_for_host(queue, b->buf_A16, flags, b->a_bytes / 2, b->log, "A16", &err);
+            if (b->A16) b->B16 = (uint16_t*)map_for_host(queue, b->buf_B16, flags, b->b_bytes / 2, b->log, "B16", &err);
+        }
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to map input buffers (%s)\n", cl_error_string(err));
+            return 1;
+        }
     }
-    
-    // Initialize matrices
+    return 0;
+}
+
+static void bench_fill_inputs(bench_t* b) {
     srand(42);
-    for (int i = 0; i < size; i++) {
-        A[i] = (float)rand() / (float)RAND_MAX;
-        B[i] = (float)rand() / (float)RAND_MAX;
-    }
-    
-    // ========================================================================
-    // CPU Benchmark
-    // ========================================================================
-    
+    for (size_t i = 0; i < (size_t)b->shape.m * b->shape.k; i++) b->A[i] = (float)rand() / (float)RAND_MAX;
+    for (size_t i = 0; i < (size_t)b->shape.k * b->shape.n; i++) b->B[i] = (float)rand() / (float)RAND_MAX;
+}
+
+static void bench_cpu_reference(bench_t* b) {
+    const gemm_shape_t* shape = &b->shape;
+
     printf("--- CPU Benchmark ---\n");
-    
-    // cpu_total declared at top
-    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+
+    b->ref.c = b->C_cpu;
+    if (b->full_reference) {
+        double cpu_total = 0.0;
+        for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+            double start = get_time_ms();
+            cpu_matrix_multiply(b->A, b->B, b->C_cpu, shape);
+            double end = get_time_ms();
+            cpu_total += (end - start);
+        }
+        b->cpu_avg = cpu_total / NUM_ITERATIONS;
+        b->ref.count = (size_t)shape->m * shape->n;
+
+        printf("CPU Total Time: %.2f ms (%d iterations)\n", cpu_total, NUM_ITERATIONS);
+        printf("CPU Avg Time: %.2f ms per matmul\n", b->cpu_avg);
+    } else {
+        double element_ms = cpu_sample_reference(b->A, b->B, b->C_cpu, shape, b->ref_idx, REFERENCE_SAMPLES);
+        b->cpu_avg = element_ms * shape->m * shape->n;
+        b->cpu_estimated = 1;
+        b->ref.idx = b->ref_idx;
+        b->ref.count = REFERENCE_SAMPLES;
+
+        printf("CPU reference: %d sampled elements of C (product above %.0f multiply-adds)\n",
+               REFERENCE_SAMPLES, FULL_REFERENCE_MACS);
+        printf("CPU Est. Time: %.2f ms per matmul (extrapolated)\n", b->cpu_avg);
+    }
+    b->cpu_gflops = gemm_flops(shape) / (b->cpu_avg * 1e6);
+    printf("CPU Performance: %.3f GFLOPS\n\n", b->cpu_gflops);
+}
+
+// One-off host-side preparations: B^T for the transposed variant and half
+// copies of A and B for the half-storage one
+static void bench_prepare_operands(bench_t* b) {
+    const gemm_shape_t* shape = &b->shape;
+
+    if (b->need_bt) {
         double start = get_time_ms();
-        cpu_matrix_multiply(A, B, C_cpu, dim);
-        double end = get_time_ms();
-        cpu_total += (end - start);
-    }
-    cpu_avg = cpu_total / NUM_ITERATIONS;
-    cpu_gflops = (2.0 * dim * dim * dim) / (cpu_avg * 1e6);
-    
-    printf("CPU Total Time: %.2f ms (%d iterations)\n", cpu_total, NUM_ITERATIONS);
-    printf("CPU Avg Time: %.2f ms per matmul\n", cpu_avg);
-    printf("CPU Performance: %.3f GFLOPS\n\n", cpu_gflops);
-    
-    // ========================================================================
-    // Create OpenCL Buffers
-    // ========================================================================
-    
-    buf_A = clCreateBuffer(context, CL_MEM_READ_ONLY, bytes, NULL, &err);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create buffer A (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
+        transpose_matrix(b->B, b->BT, shape->k, shape->n);
+        b->transpose_ms = get_time_ms() - start;
     }
-    
-    buf_B = clCreateBuffer(context, CL_MEM_READ_ONLY, bytes, NULL, &err);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create buffer B (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
+
+    if (b->need_half) {
+        double start = get_time_ms();
+        float_to_half(b->A, b->A16, (size_t)shape->m * shape->k);
+        float_to_half(b->B, b->B16, (size_t)shape->k * shape->n);
+        b->convert_ms = get_time_ms() - start;
     }
-    
-    buf_C = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bytes, NULL, &err);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create buffer C (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
+}
+
+// Copy mode writes the host arrays; zero-copy modes just unmap. Tiled
+// operands are written panel by panel, timed on the host only.
+static int bench_upload(bench_t* b) {
+    const cl_command_queue queue = b->cl.queue;
+    cl_int err;
+
+    if (b->tiled) {
+        double start = get_time_ms();
+        err = gemm_tiling_upload(queue, &b->tiling, b->A, b->B, b->BT);
+        b->upload_ms[0] = get_time_ms() - start;
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to upload tiled operands (%s)\n", cl_error_string(err));
+            return 1;
+        }
+        printf("Uploads (tiled): %.2f ms for A, %s (%.1f MB)\n\n", b->upload_ms[0],
+               b->need_b && b->need_bt ? "B and BT" : b->need_bt ? "BT" : "B",
+               (b->a_bytes + (b->need_b + b->need_bt) * b->b_bytes) / (1024.0 * 1024.0));
+        return 0;
     }
-    
-    // Upload data
-    err = clEnqueueWriteBuffer(queue, buf_A, CL_TRUE, 0, bytes, A, 0, NULL, NULL);
+
+    err = upload(queue, MEMORY_MODE, b->buf_A, b->A, b->a_bytes, b->log, "A", &b->upload_ms[0]);
     if (err != CL_SUCCESS) {
         fprintf(stderr, "Error: Failed to upload A (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
+        return 1;
     }
-    
-    err = clEnqueueWriteBuffer(queue, buf_B, CL_TRUE, 0, bytes, B, 0, NULL, NULL);
+
+    err = upload(queue, MEMORY_MODE, b->buf_B, b->B, b->b_bytes, b->log, "B", &b->upload_ms[1]);
     if (err != CL_SUCCESS) {
         fprintf(stderr, "Error: Failed to upload B (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
-    }
-    
-    // Set kernel arguments
-    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &buf_A);
-    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &buf_B);
-    err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &buf_C);
-    err |= clSetKernelArg(kernel, 3, sizeof(int), &dim);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to set kernel arguments (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
-    }
-    
-    // ========================================================================
-    // GPU Benchmark
-    // ========================================================================
-    
-    printf("--- GPU (VC4CL) Benchmark ---\n");
-    
-    // global_work_size declared at top
-    
-    // Warm-up
-    err = clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global_work_size, NULL, 0, NULL, NULL);
-    clFinish(queue);
-    
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Kernel execution failed (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
-    }
-    
-    // Timed runs
-    // gpu_total declared at top
-    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
-        double start = get_time_ms();
-        
-        err = clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global_work_size, NULL, 0, NULL, NULL);
-        clFinish(queue);
-        
-        double end = get_time_ms();
-        gpu_total += (end - start);
-        
+        return 1;
+    }
+
+    if (b->need_bt) {
+        err = upload(queue, MEMORY_MODE, b->buf_BT, b->BT, b->b_bytes, b->log, "BT", &b->upload_ms[2]);
         if (err != CL_SUCCESS) {
-            fprintf(stderr, "Error: Kernel execution failed on iteration %d (%s)\n", iter, cl_error_string(err));
-            ret = 1;
-            goto cleanup;
-        }
-    }
-    
-    gpu_avg = gpu_total / NUM_ITERATIONS;
-    gpu_gflops = (2.0 * dim * dim * dim) / (gpu_avg * 1e6);
-    
-    printf("GPU Total Time: %.2f ms (%d iterations)\n", gpu_total, NUM_ITERATIONS);
-    printf("GPU Avg Time: %.2f ms per matmul\n", gpu_avg);
-    printf("GPU Performance: %.3f GFLOPS\n\n", gpu_gflops);
-    
-    // Read back results
-    err = clEnqueueReadBuffer(queue, buf_C, CL_TRUE, 0, bytes, C_gpu, 0, NULL, NULL);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to read results (%s)\n", cl_error_string(err));
-        ret = 1;
-        goto cleanup;
-    }
-    
-    // ========================================================================
-    // Verify Results
-    // ========================================================================
-    
-    {
-        double max_error = 0.0;
-        double avg_error = 0.0;
-        int error_count = 0;
-        
-        for (int i = 0; i < size; i++) {
-            double error = fabs((double)C_cpu[i] - (double)C_gpu[i]);
-            avg_error += error;
-            if (error > max_error) max_error = error;
-            if (error > 0.001) {
-                error_count++;
+            fprintf(stderr, "Error: Failed to upload BT (%s)\n", cl_error_string(err));
+            return 1;
+        }
+    }
+
+    if (b->need_half) {
+        err = upload(queue, MEMORY_MODE, b->buf_A16, b->A16, b->a_bytes / 2, b->log, "A16", &b->upload_ms[3]);
+        if (err == CL_SUCCESS) {
+            err = upload(queue, MEMORY_MODE, b->buf_B16, b->B16, b->b_bytes / 2, b->log, "B16", &b->upload_ms[4]);
+        }
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to upload half operands (%s)\n", cl_error_string(err));
+            return 1;
+        }
+    }
+    if (MEMORY_MODE != MEM_COPY) {
+        b->A = b->B = b->BT = NULL;   // no longer ours to touch
+        b->A16 = b->B16 = NULL;
+    }
+
+    printf("Uploads (%s): A %.2f ms, B %.2f ms", mem_mode_name(MEMORY_MODE), b->upload_ms[0], b->upload_ms[1]);
+    if (b->need_bt) printf(", BT %.2f ms", b->upload_ms[2]);
+    if (b->need_half) printf(", A16 %.2f ms, B16 %.2f ms", b->upload_ms[3], b->upload_ms[4]);
+    printf(" (A %.1f KB, B %.1f KB)\n\n", b->a_bytes / 1024.0, b->b_bytes / 1024.0);
+    return 0;
+}
+
+// --tune: the best configuration per variant replaces the cached one, and
+// its program is kept for the benchmark
+static int bench_tune(bench_t* b) {
+    if (!TUNE) return 0;
+
+    printf("--- Autotuning (%d timed runs per candidate) ---\n\n", TUNE_ITERATIONS);
+
+    tuner_t tuner;
+    memset(&tuner, 0, sizeof(tuner));
+    tuner.context = b->cl.context;
+    tuner.device = b->cl.device;
+    tuner.dev = &b->tune_dev;
+    tuner.queue = b->cl.queue;
+    tuner.source = b->source;
+    tuner.source_length = b->source_length;
+    tuner.cache_dir = CACHE_DIR;
+    tuner.max_work_group_size = b->entry->max_work_group_size;
+    tuner.iterations = TUNE_ITERATIONS;
+    tuner.launch.c = b->buf_C;
+    tuner.launch.shape = b->shape;
+    tuner.ref = &b->ref;
+    tuner.C_gpu = b->C_gpu;
+
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        variant_result_t* r = &b->results[v];
+        if (r->skipped) continue;
+
+        const int half = GEMM_VARIANTS[v].kind == GEMM_HALF;
+        tuner.variant = &GEMM_VARIANTS[v];
+        tuner.launch.a = half ? b->buf_A16 : b->buf_A;
+        tuner.launch.b = half ? b->buf_B16 : GEMM_VARIANTS[v].transposed_b ? b->buf_BT : b->buf_B;
+        if (tune_variant(&tuner, &GEMM_DEFAULT_CONFIG) != 0) {
+            printf("  [tune %s] no configuration ran correctly at this size\n\n", GEMM_VARIANTS[v].name);
+            r->skipped = "no tuned configuration fits this size";
+            continue;
+        }
+
+        char config[256];
+        double gflops = gemm_flops(&b->shape) / (tuner.best_ms * 1e6);
+        config_describe(&GEMM_VARIANTS[v], &tuner.best, config, sizeof(config));
+        printf("  [tune %s] best of %d: %s (%.3f GFLOPS)\n\n", GEMM_VARIANTS[v].name, tuner.tried, config, gflops);
+
+        r->config = tuner.best;
+        r->config_source = "tuned";
+        b->programs[v] = tuner.best_program;
+        if (tune_cache_store(TUNE_FILE, &b->tune_dev, GEMM_VARIANTS[v].name, &tuner.best, b->shape.n, gflops) != 0) {
+            return 1;
+        }
+    }
+    printf("Tuned configurations saved to %s\n\n", TUNE_FILE);
+    return 0;
+}
+
+static int bench_build_kernels(bench_t* b) {
+    const cl_device_id device = b->cl.device;
+    cl_int err;
+
+    printf("--- Building Kernels ---\n");
+    double start = get_time_ms();
+
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        variant_result_t* r = &b->results[v];
+        if (r->skipped) continue;
+
+        char options[320];
+        config_build_options(&r->config, options, sizeof(options));
+
+        // Variants with identical options share one program
+        for (int u = 0; u < v && !b->programs[v]; u++) {
+            char other[320];
+            if (!b->programs[u]) continue;
+            config_build_options(&b->results[u].config, other, sizeof(other));
+            if (strcmp(options, other) == 0) {
+                b->programs[v] = b->programs[u];
+                clRetainProgram(b->programs[v]);
+            }
+        }
+        if (!b->programs[v]) {
+            b->programs[v] = program_build(CACHE_DIR, &b->tune_dev, b->cl.context, device, b->source,
+                                           b->source_length, options, 1, &b->build_stats, &err);
+            if (!b->programs[v]) return 1;
+            printf("Program: %s\n", options);
+        }
+
+        b->kernels[v] = clCreateKernel(b->programs[v], GEMM_VARIANTS[v].kernel, &err);
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to create kernel %s (%s)\n", GEMM_VARIANTS[v].kernel, cl_error_string(err));
+            return 1;
+        }
+
+        size_t kernel_max_wg = b->entry->max_work_group_size;
+        clGetKernelWorkGroupInfo(b->kernels[v], device, CL_KERNEL_WORK_GROUP_SIZE,
+                                 sizeof(kernel_max_wg), &kernel_max_wg, NULL);
+        gemm_geometry_t g = variant_geometry(&GEMM_VARIANTS[v], &r->config);
+        r->skipped = variant_unsupported(&g, kernel_max_wg);
+    }
+    b->build_ms = get_time_ms() - start;
+
+    // Programs the tuner already built are not counted here
+    const build_stats_t* bs = &b->build_stats;
+    printf("Kernels ready in %.2f ms: %d from binary cache (%.2f ms), %d compiled from source (%.2f ms)\n",
+           b->build_ms, bs->cached, bs->cached_ms, bs->compiled, bs->compiled_ms);
+    if (bs->cached > 0) {
+        printf("Compiling the cached programs took %.2f ms when they were stored\n", bs->cold_ms);
+    }
+    printf("\n");
+    return 0;
+}
+
+static int bench_run_variants(bench_t* b) {
+    printf("--- GPU (VC4CL) Benchmark ---\n\n");
+
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        if (b->results[v].skipped) {
+            if (variant_selected(VARIANT_NAME, &GEMM_VARIANTS[v])) {
+                printf("--- GPU Variant: %s skipped (%s) ---\n\n", GEMM_VARIANTS[v].name, b->results[v].skipped);
+            }
+            continue;
+        }
+        // Untiled: one launch over the whole buffers
+        const int half = GEMM_VARIANTS[v].kind == GEMM_HALF;
+        const gemm_launch_t whole = { half ? b->buf_A16 : b->buf_A,
+                                      half ? b->buf_B16 : GEMM_VARIANTS[v].transposed_b ? b->buf_BT : b->buf_B,
+                                      b->buf_C, b->shape };
+        variant_params_t p;
+        p.queue = b->cl.queue;
+        p.kernel = b->kernels[v];
+        p.variant = &GEMM_VARIANTS[v];
+        p.shape = b->shape;
+        p.launches = !b->tiled ? &whole : GEMM_VARIANTS[v].transposed_b ? b->launches_bt : b->launches;
+        p.num_launches = b->num_launches;
+        p.tiling = b->tiled ? &b->tiling : NULL;
+        p.mode = MEMORY_MODE;
+        p.iterations = NUM_ITERATIONS;
+        p.ref = &b->ref;
+        p.C_gpu = b->C_gpu;
+        p.log = b->log;
+        if (run_variant(&p, &b->results[v]) != 0) return 1;
+    }
+    return 0;
+}
+
+// The fastest variant that ran with float operands, or -1
+static int bench_fastest_float_variant(const bench_t* b) {
+    int best = -1;
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        if (b->results[v].skipped || !b->kernels[v] || GEMM_VARIANTS[v].kind == GEMM_HALF) continue;
+        if (best < 0 || b->results[v].avg_ms < b->results[best].avg_ms) best = v;
+    }
+    return best;
+}
+
+// The optional modes; each reports its own failures and none stops the run
+static void bench_run_extras(bench_t* b) {
+    const gemm_shape_t* shape = &b->shape;
+    const cl_context context = b->cl.context;
+    const cl_device_id device = b->cl.device;
+    char selector[16];
+    snprintf(selector, sizeof(selector), "%d", b->device_index);
+
+    if (MEMORY_BENCH) {
+        // Any variant that ran will do; the sweep measures data movement around it
+        for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+            if (b->results[v].skipped || !b->kernels[v] || GEMM_VARIANTS[v].kind == GEMM_HALF) continue;
+            memory_bench_params_t p;
+            p.context = context;
+            p.queue = b->cl.queue;
+            p.device = device;
+            p.kernel = b->kernels[v];
+            p.variant = &GEMM_VARIANTS[v];
+            p.config = &b->results[v].config;
+            p.max_dim = shape->m > shape->n ? shape->m : shape->n;
+            if (shape->k > p.max_dim) p.max_dim = shape->k;
+            p.max_alloc = b->max_alloc;
+            p.repeats = NUM_ITERATIONS;
+            run_memory_bench(&p);
+            break;
+        }
+    }
+
+    if (BATCH_COUNT > 0) {
+        // The pipeline keeps one whole buffer per operand and feeds B as is
+        int batch_variant = -1;
+        for (int v = 0; v < GEMM_NUM_VARIANTS && batch_variant < 0; v++) {
+            if (!b->results[v].skipped && b->kernels[v] && GEMM_VARIANTS[v].kind != GEMM_HALF &&
+                !GEMM_VARIANTS[v].transposed_b) batch_variant = v;
+        }
+        if (b->tiled) {
+            printf("--- Batch Pipeline skipped (operands exceed one buffer) ---\n\n");
+        } else if (batch_variant < 0) {
+            printf("--- Batch Pipeline skipped (needs a variant that reads float B, not B^T or half) ---\n\n");
+        } else {
+            batch_bench_params_t p;
+            p.context = context;
+            p.device = device;
+            p.kernel = b->kernels[batch_variant];
+            p.variant = &GEMM_VARIANTS[batch_variant];
+            p.config = &b->results[batch_variant].config;
+            p.shape = *shape;
+            p.count = BATCH_COUNT;
+            p.slots = BATCH_SLOTS;
+            run_batch_bench(&p);
+        }
+    }
+
+    if (COEXEC) {
+        // The fastest variant takes the device's share
+        int coexec_variant = bench_fastest_float_variant(b);
+        if (b->tiled) {
+            printf("--- CPU+GPU Co-Execution skipped (operands exceed one buffer) ---\n\n");
+        } else if (MEMORY_MODE != MEM_COPY) {
+            printf("--- CPU+GPU Co-Execution skipped (needs the host copies of A and B, i.e. copy mode) ---\n\n");
+        } else if (coexec_variant < 0) {
+            printf("--- CPU+GPU Co-Execution skipped (no variant ran) ---\n\n");
+        } else {
+            const gemm_launch_t whole = { b->buf_A, GEMM_VARIANTS[coexec_variant].transposed_b ? b->buf_BT : b->buf_B,
+                                          b->buf_C, *shape };
+            coexec_params_t p;
+            p.context = context;
+            p.device = device;
+            p.kernel = b->kernels[coexec_variant];
+            p.variant = &GEMM_VARIANTS[coexec_variant];
+            p.config = &b->results[coexec_variant].config;
+            p.whole = whole;
+            p.A = b->A;
+            p.B = b->B;
+            p.C = b->C_gpu;
+            p.ref = &b->ref;
+            p.iterations = NUM_ITERATIONS;
+            p.threads = CPU_THREADS > 0 ? CPU_THREADS : cpu_gemm_max_threads();
+            run_coexec(&p);
+        }
+    }
+
+    if (MULTI_DEVICE) {
+        // Every device runs the fastest variant, with its own cached config
+        int md_variant = bench_fastest_float_variant(b);
+        if (b->tiled) {
+            printf("--- Multi-Device Partitioning skipped (operands exceed one buffer) ---\n\n");
+        } else if (MEMORY_MODE != MEM_COPY) {
+            printf("--- Multi-Device Partitioning skipped (needs the host copies of A and B, i.e. copy mode) ---\n\n");
+        } else if (md_variant < 0) {
+            printf("--- Multi-Device Partitioning skipped (no variant ran) ---\n\n");
+        } else {
+            multi_device_params_t p;
+            p.entries = b->device_entries;
+            p.indices = b->multi_indices;
+            p.count = b->multi_count;
+            p.variant = &GEMM_VARIANTS[md_variant];
+            p.source = b->source;
+            p.source_length = b->source_length;
+            p.shape = *shape;
+            p.A = b->A;
+            p.B = GEMM_VARIANTS[md_variant].transposed_b ? b->BT : b->B;
+            p.C = b->C_gpu;
+            p.ref = &b->ref;
+            p.iterations = NUM_ITERATIONS;
+            p.tune_file = TUNE_FILE;
+            p.cache_dir = CACHE_DIR;
+            run_multi_device(&p);
+        }
+    }
+
+    if (LIBRARY_CALLS > 0) {
+        // Same device and fastest variant, through a handle of its own
+        int lib_variant = bench_fastest_float_variant(b);
+        if (b->tiled) {
+            printf("--- Library Reuse skipped (operands exceed one buffer) ---\n\n");
+        } else if (MEMORY_MODE != MEM_COPY) {
+            printf("--- Library Reuse skipped (needs the host copies of A and B, i.e. copy mode) ---\n\n");
+        } else if (lib_variant < 0) {
+            printf("--- Library Reuse skipped (no variant ran) ---\n\n");
+        } else {
+            library_bench_params_t p;
+            p.device = selector;
+            p.variant = &GEMM_VARIANTS[lib_variant];
+            p.A = b->A;
+            p.B = b->B;
+            p.C = b->C_gpu;
+            p.shape = *shape;
+            p.ref = &b->ref;
+            p.calls = LIBRARY_CALLS;
+            p.tune_file = TUNE_FILE;
+            p.cache_dir = CACHE_DIR;
+            run_library_bench(&p);
+        }
+    }
+
+    if (LAYOUT_BENCH) {
+        // Its own queue, program and buffers, fed from the host copies
+        if (b->tiled) {
+            printf("--- B Layout Benchmark skipped (operands exceed one buffer) ---\n\n");
+        } else if (MEMORY_MODE != MEM_COPY) {
+            printf("--- B Layout Benchmark skipped (needs the host copies of A and B, i.e. copy mode) ---\n\n");
+        } else {
+            layout_bench_params_t p;
+            p.context = context;
+            p.device = device;
+            p.dev = &b->tune_dev;
+            p.source = b->source;
+            p.source_length = b->source_length;
+            p.A = b->A;
+            p.B = b->B;
+            p.C = b->C_gpu;
+            p.shape = *shape;
+            p.ref = &b->ref;
+            p.iterations = NUM_ITERATIONS;
+            p.cache_dir = CACHE_DIR;
+            run_layout_bench(&p);
+        }
+    }
+
+    // Their own operands: A is M x K, vectors and data are M * K long
+    if (BLAS_BENCH) {
+        const blas_bench_params_t p = { selector, *shape, NUM_ITERATIONS, TUNE_FILE, CACHE_DIR };
+        run_blas_bench(&p);
+    }
+    if (PRIMITIVES_BENCH) {
+        const primitives_bench_params_t p = { selector, *shape, NUM_ITERATIONS, TUNE_FILE, CACHE_DIR };
+        run_primitives_bench(&p);
+    }
+}
+
+static int bench_summary(const bench_t* b) {
+    const gemm_shape_t* shape = &b->shape;
+    const variant_result_t* results = b->results;
+    const build_stats_t* bs = &b->build_stats;
+
+    printf("=========================================\n");
+    printf("RESULTS SUMMARY\n");
+    printf("=========================================\n");
+    printf("Shape: M = %d, N = %d, K = %d", shape->m, shape->n, shape->k);
+    if (b->tiled) printf(" (%d launches per matmul)", b->num_launches);
+    printf("\n");
+    printf("Iterations: %d\n\n", NUM_ITERATIONS);
+
+    printf("%-8s %10s %10s %9s %10s %12s  %s\n", "Variant", "Avg ms", "GFLOPS", "Speedup", "Max Error", "Errors>1e-3", "Config");
+    printf("%-8s %10.2f %10.3f %8.2fx %10s %12s  %s\n", "cpu", b->cpu_avg, b->cpu_gflops, 1.0, "-", "-",
+           b->cpu_estimated ? "estimated" : "-");
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        const variant_result_t* r = &results[v];
+        if (!variant_selected(VARIANT_NAME, &GEMM_VARIANTS[v])) continue;
+        if (r->skipped) {
+            printf("%-8s skipped: %s\n", GEMM_VARIANTS[v].name, r->skipped);
+            continue;
+        }
+        printf("%-8s %10.2f %10.3f %8.2fx %10.6f %7d/%zu  %s\n", GEMM_VARIANTS[v].name, r->avg_ms, r->gflops,
+               b->cpu_avg / r->avg_ms, r->max_error, r->error_count, b->ref.count, r->config_source);
+    }
+    if (b->cpu_estimated) {
+        printf("\nCPU time extrapolated from %d sampled elements; errors counted over those\n", REFERENCE_SAMPLES);
+    }
+    if (b->need_bt) printf("\nHost transpose of B for 'bt': %.2f ms (once per B)\n", b->transpose_ms);
+    if (b->need_half) summarize_half(results, &b->ref, b->convert_ms);
+
+    const profile_log_t* log = b->log;
+    if (log) {
+        printf("\nEvent profile (device timestamps):\n");
+        printf("%-8s %10s %10s %10s %10s %11s %11s\n", "Variant", "Kernel ms", "GFLOPS", "E2E ms", "E2E GFLOPS",
+               "Enqueue us", "Queue us");
+        for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+            const variant_result_t* r = &results[v];
+            if (!r->profiled) continue;
+            printf("%-8s %10.3f %10.3f %10.3f %10.3f %11.1f %11.1f\n", GEMM_VARIANTS[v].name, r->kernel_ms,
+                   r->kernel_gflops, r->e2e_ms, r->e2e_gflops, r->enqueue_us, r->latency_us);
+        }
+
+        printf("\nTransfers:\n");
+        for (int i = 0; i < log->count; i++) {
+            const profile_event_t* e = &log->events[i];
+            if (strcmp(e->phase, "write") != 0 && strcmp(e->phase, "read") != 0) continue;
+            double ms = profile_event_ms(e);
+            printf("  %-8s %-8s %8.1f KB %9.3f ms %8.3f GB/s\n", e->name, e->variant[0] ? e->variant : "-",
+                   e->bytes / 1024.0, ms, ms > 0.0 ? e->bytes / (ms * 1e6) : 0.0);
+        }
+    }
+
+    // Cold = every program compiled from source, warm = every program from the cache
+    printf("\nStartup: context %.2f ms + programs %.2f ms (%s)\n", b->context_ms, b->build_ms,
+           bs->compiled == 0 && bs->cached > 0 ? "warm" :
+           bs->cached == 0 && bs->compiled > 0 ? "cold" :
+           bs->cached > 0 ? "partly cached" : "programs built while tuning");
+    if (bs->cached > 0 && bs->compiled == 0) {
+        printf("Cold program build for the same kernels: %.2f ms (%.1fx slower)\n",
+               bs->cold_ms, bs->cold_ms / (bs->cached_ms > 0.0 ? bs->cached_ms : 1e-3));
+    }
+    printf("\nGPU Theoretical Peak: ~24 GFLOPS (12 QPUs)\n");
+    printf("=========================================\n");
+
+    if (JSON_PATH) {
+        report_t rep;
+        rep.dev = &b->tune_dev;
+        rep.shape = *shape;
+        rep.launches_per_run = b->num_launches;
+        rep.iterations = NUM_ITERATIONS;
+        rep.selection = VARIANT_NAME;
+        rep.cpu_avg = b->cpu_avg;
+        rep.cpu_gflops = b->cpu_gflops;
+        rep.cpu_estimated = b->cpu_estimated;
+        rep.results = results;
+        rep.log = log;
+        rep.context_ms = b->context_ms;
+        rep.build_ms = b->build_ms;
+        rep.build_stats = bs;
+        if (write_json_report(JSON_PATH, &rep) != 0) return 1;
+        printf("Report written to %s\n", JSON_PATH);
+    }
+    return 0;
+}
+
+// The phases in order, stopping at the first failure
+static int bench_run(bench_t* b) {
+    if (bench_open_context(b) != 0) return 1;
+    bench_select_configs(b);
+    if (bench_alloc_host(b) != 0 || bench_create_buffers(b) != 0) return 1;
+    bench_fill_inputs(b);
+    bench_cpu_reference(b);
+    bench_prepare_operands(b);
+    if (bench_upload(b) != 0 || bench_tune(b) != 0 || bench_build_kernels(b) != 0 ||
+        bench_run_variants(b) != 0) return 1;
+    bench_run_extras(b);
+    return bench_summary(b);
+}
+
+int main(int argc, char* argv[]) {
+    // Parse command line arguments: [size] [iterations] plus --options
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc) {
+            VARIANT_NAME = argv[++i];
+        } else if (strcmp(argv[i], "--tune") == 0) {
+            TUNE = 1;
+        } else if (strcmp(argv[i], "--tune-file") == 0 && i + 1 < argc) {
+            TUNE_FILE = argv[++i];
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            CACHE_DIR = argv[++i];
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            CACHE_DIR = NULL;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            PROFILE = 1;
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            JSON_PATH = argv[++i];
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            if (mem_mode_parse(argv[++i], &MEMORY_MODE) != 0) {
+                fprintf(stderr, "Unknown memory mode '%s'\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--memory-bench") == 0) {
+            MEMORY_BENCH = 1;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            BATCH_COUNT = atoi(argv[++i]);
+            if (BATCH_COUNT < 1) {
+                fprintf(stderr, "Batch count must be positive\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--batch-slots") == 0 && i + 1 < argc) {
+            BATCH_SLOTS = atoi(argv[++i]);
+            if (BATCH_SLOTS < 2 || BATCH_SLOTS > 8) {
+                fprintf(stderr, "Batch slots must be between 2 and 8\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--coexec") == 0) {
+            COEXEC = 1;
+        } else if (strcmp(argv[i], "--cpu-threads") == 0 && i + 1 < argc) {
+            CPU_THREADS = atoi(argv[++i]);
+            if (CPU_THREADS < 1) {
+                fprintf(stderr, "CPU threads must be positive\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--list-devices") == 0) {
+            LIST_DEVICES = 1;
+        } else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            DEVICE_SELECTOR = argv[++i];
+        } else if (strcmp(argv[i], "--multi-device") == 0 && i + 1 < argc) {
+            MULTI_DEVICE = argv[++i];
+        } else if (strcmp(argv[i], "--library") == 0 && i + 1 < argc) {
+            LIBRARY_CALLS = atoi(argv[++i]);
+            if (LIBRARY_CALLS < 1) {
+                fprintf(stderr, "Library calls must be positive\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--blas") == 0) {
+            BLAS_BENCH = 1;
+        } else if (strcmp(argv[i], "--primitives") == 0) {
+            PRIMITIVES_BENCH = 1;
+        } else if (strcmp(argv[i], "--layout-bench") == 0) {
+            LAYOUT_BENCH = 1;
+        } else if (strcmp(argv[i], "--shape") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%dx%d", &SHAPE.m, &SHAPE.n, &SHAPE.k) != 3 ||
+                SHAPE.m < 1 || SHAPE.n < 1 || SHAPE.k < 1) {
+                fprintf(stderr, "Shape must be MxNxK with positive dimensions\n");
+                return 1;
             }
+        } else if (strcmp(argv[i], "--max-alloc") == 0 && i + 1 < argc) {
+            // Pretend the device allows less, to exercise tiling on small problems
+            MAX_ALLOC_CAP = (size_t)strtoull(argv[++i], NULL, 10);
+            if (MAX_ALLOC_CAP < 1024) {
+                fprintf(stderr, "Max allocation must be at least 1024 bytes\n");
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        } else if (positional == 0) {
+            positional++;
+            // Square N x N x N; any size, tiled if it exceeds the buffer limit
+            int dim = atoi(argv[i]);
+            if (dim < 1) {
+                fprintf(stderr, "Matrix dimension must be positive\n");
+                return 1;
+            }
+            SHAPE.m = SHAPE.n = SHAPE.k = dim;
+        } else if (positional == 1) {
+            positional++;
+            NUM_ITERATIONS = atoi(argv[i]);
+            if (NUM_ITERATIONS < 1 || NUM_ITERATIONS > 100) {
+                fprintf(stderr, "Iterations must be between 1 and 100\n");
+                return 1;
+            }
+        } else {
+            print_usage(argv[0]);
+            return 1;
         }
-        avg_error /= size;
-        
-        // ========================================================================
-        // Summary
-        // ========================================================================
-        
-        printf("=========================================\n");
-        printf("RESULTS SUMMARY\n");
-        printf("=========================================\n");
-        printf("Matrix Size: %d x %d\n", dim, dim);
-        printf("Iterations: %d\n\n", NUM_ITERATIONS);
-        
-        printf("Timing (avg per matmul):\n");
-        printf("  CPU: %.2f ms\n", cpu_avg);
-        printf("  GPU: %.2f ms\n", gpu_avg);
-        printf("  Speedup: %.2fx\n\n", cpu_avg / gpu_avg);
-        
-        printf("Performance:\n");
-        printf("  CPU: %.3f GFLOPS\n", cpu_gflops);
-        printf("  GPU: %.3f GFLOPS\n", gpu_gflops);
-        printf("  GPU Theoretical Peak: ~24 GFLOPS (12 QPUs)\n\n");
-        
-        printf("Accuracy:\n");
-        printf("  Max Error: %.6f\n", max_error);
-        printf("  Avg Error: %.6f\n", avg_error);
-        printf("  Errors > 0.001: %d / %d\n", error_count, size);
-        printf("=========================================\n");
-    }
-    
-cleanup:
-    // Free OpenCL resources
-    if (buf_A) clReleaseMemObject(buf_A);
-    if (buf_B) clReleaseMemObject(buf_B);
-    if (buf_C) clReleaseMemObject(buf_C);
-    if (kernel) clReleaseKernel(kernel);
-    if (program) clReleaseProgram(program);
-    if (queue) clReleaseCommandQueue(queue);
-    if (context) clReleaseContext(context);
-    
-    // Free host memory
-    free(source);
-    free(A);
-    free(B);
-    free(C_cpu);
-    free(C_gpu);
-    
+    }
+
+    int selected = 0;
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        if (variant_selected(VARIANT_NAME, &GEMM_VARIANTS[v])) selected++;
+    }
+    if (selected == 0) {
+        fprintf(stderr, "Unknown variant '%s'\n", VARIANT_NAME);
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    printf("=========================================\n");
+    printf(" VC4CL OpenCL Matrix Multiplication\n");
+    printf(" Target: Raspberry Pi 3B (VideoCore IV)\n");
+    printf("=========================================\n\n");
+
+    bench_t bench;
+    bench_init(&bench, &SHAPE);
+    int ret = bench_open_device(&bench);
+    if (ret == 0 && !LIST_DEVICES) ret = bench_run(&bench);
+    bench_release(&bench);
     return ret;
 }
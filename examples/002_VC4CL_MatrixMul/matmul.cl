@@ -1,43 +1,445 @@
-// Vectorized matrix multiplication for VC4CL (Raspberry Pi GPU)
-// Each work-item computes 16 output elements of C (one float16 vector)
-// This utilizes the QPU's native SIMD-16 architecture
+// Matrix multiplication kernels for VC4CL (Raspberry Pi GPU)
+// All kernels compute C = A * B for row-major A (M x K), B (K x N) and
+// C (M x N). Any sizes work: edge vectors are loaded and stored lane by
+// lane, and the host rounds the global size up to whole vectors and groups.
+// The host selects one at runtime (see the variant table in gemm_kernels.cpp) and
+// passes the vector width and tile sizes below as -D build options.
+// transpose_b and pack_b at the end convert B's layout on the device.
+
+#ifndef VEC
+#define VEC 16              // C columns per vector: 4, 8 or 16
+#endif
+#ifndef TILE_ROWS
+#define TILE_ROWS 4         // matmul_tiled: C rows per work-group
+#endif
+#ifndef TILE_VECS
+#define TILE_VECS 2         // matmul_tiled: floatV column vectors per work-group
+#endif
+#ifndef TILE_K
+#define TILE_K 16           // matmul_tiled: k-steps staged in local memory at once
+#endif
+#ifndef ROWS_PER_ITEM
+#define ROWS_PER_ITEM 4     // matmul_rows: C rows per work-item
+#endif
+
+// floatV, vloadV and vstoreV expand to float16, vload16, ... for VEC=16
+#define CAT(a, b) a##b
+#define XCAT(a, b) CAT(a, b)
+#define floatV XCAT(float, VEC)
+#define vloadV XCAT(vload, VEC)
+#define vstoreV XCAT(vstore, VEC)
+#define vload_halfV XCAT(vload_half, VEC)
+
+// VEC floats of a row starting at `col`; lanes at or past `cols` read as 0
+inline floatV load_edge(__global const float* row, const int cols, const int col)
+{
+    float lanes[VEC];
+    for (int i = 0; i < VEC; i++) {
+        lanes[i] = col + i < cols ? row[col + i] : 0.0f;
+    }
+    return vloadV(0, lanes);
+}
+
+inline floatV load_row(__global const float* row, const int cols, const int col)
+{
+    return col + VEC <= cols ? vloadV(0, row + col) : load_edge(row, cols, col);
+}
+
+// Store VEC floats of a row starting at `col`, dropping lanes past `cols`
+inline void store_row(const floatV v, __global float* row, const int cols, const int col)
+{
+    if (col + VEC <= cols) {
+        vstoreV(v, 0, row + col);
+        return;
+    }
+    float lanes[VEC];
+    vstoreV(v, 0, lanes);
+    for (int i = 0; i < VEC && col + i < cols; i++) {
+        row[col + i] = lanes[i];
+    }
+}
+
+// ============================================================================
+// matmul_simple: one row x VEC columns per work-item
+// ============================================================================
+
+// Vectorized matrix multiplication
+// Each work-item computes VEC output elements of C (one floatV vector)
+// With VEC=16 this utilizes the QPU's native SIMD-16 architecture
 
 __kernel void matmul_simple(
     __global const float* A,
     __global const float* B,
     __global float* C,
-    const int N)
+    const int M,
+    const int N,
+    const int K)
 {
-    // Row index (y) remains the same (0 to N)
+    // Row index (y) remains the same (0 to M)
     const int row = get_global_id(1);
     
-    // Column index (x) now represents a BLOCK of 16 elements
+    // Column index (x) now represents a BLOCK of VEC elements
     const int col_vec_idx = get_global_id(0);
     
-    // Bounds check
-    if (row >= N || col_vec_idx >= N/16) return;
+    // Calculate the actual starting column index for this vector
+    const int col_start = col_vec_idx * VEC;
     
-    // Accumulator for 16 separate dot products
-    float16 sum = 0.0f;
+    // Bounds check: the global size is rounded up past the matrix
+    if (row >= M || col_start >= N) return;
     
-    // Calculate the actual starting column index for this vector
-    const int col_start = col_vec_idx * 16;
+    // Accumulator for VEC separate dot products
+    floatV sum = 0.0f;
     
-    // Loop over the shared dimension K
-    for (int k = 0; k < N; k++) {
-        // Load 1 scalar from A and broadcast it to all 16 lanes
-        // A is accessed as scalar: A[row, k]
-        float a_val = A[row * N + k];
-        
-        // Load 16 contiguous floats from B
-        // B is accessed as vector: B[k, col_start ... col_start+15]
-        float16 b_vec = vload16(0, &B[k * N + col_start]);
-        
-        // Fused Multiply-Add (vectorized)
-        // This computes 16 partial sums in parallel
-        sum += a_val * b_vec;
+    if (col_start + VEC <= N) {
+        // Loop over the shared dimension K
+        for (int k = 0; k < K; k++) {
+            // Load 1 scalar from A and broadcast it to all VEC lanes
+            // A is accessed as scalar: A[row, k]
+            float a_val = A[row * K + k];
+            
+            // Load VEC contiguous floats from B
+            // B is accessed as vector: B[k, col_start ... col_start+VEC-1]
+            floatV b_vec = vloadV(0, &B[k * N + col_start]);
+            
+            // Fused Multiply-Add (vectorized)
+            // This computes VEC partial sums in parallel
+            sum += a_val * b_vec;
+        }
+    } else {
+        // Last vector of a row that N does not fill: lanes past N stay 0
+        for (int k = 0; k < K; k++) {
+            sum += A[row * K + k] * load_edge(&B[k * N], N, col_start);
+        }
     }
     
-    // Store the final 16 results to C
-    vstore16(sum, 0, &C[row * N + col_start]);
+    // Store the final VEC results to C
+    store_row(sum, &C[row * N], N, col_start);
+}
+
+// ============================================================================
+// matmul_tiled: A and B staged through __local tiles
+// ============================================================================
+
+// Work-group: TILE_VECS x TILE_ROWS work-items, each computing one row x VEC
+// columns as in matmul_simple. Per TILE_K step the group cooperatively copies
+// a TILE_ROWS x TILE_K tile of A and a TILE_K x (TILE_VECS*VEC) tile of B into
+// local memory, so each global element is read once per group instead of once
+// per work-item. Tile elements outside the matrices are loaded as 0, so edge
+// groups need no special case until the final store.
+
+__kernel void matmul_tiled(
+    __global const float* A,
+    __global const float* B,
+    __global float* C,
+    const int M,
+    const int N,
+    const int K)
+{
+    __local float a_tile[TILE_ROWS][TILE_K];
+    __local floatV b_tile[TILE_K][TILE_VECS];
+
+    const int lx = get_local_id(0);
+    const int ly = get_local_id(1);
+    const int lid = ly * TILE_VECS + lx;
+    const int group_items = TILE_VECS * TILE_ROWS;
+
+    // First C row and first floatV column of this work-group
+    const int row0 = get_group_id(1) * TILE_ROWS;
+    const int vec0 = get_group_id(0) * TILE_VECS;
+
+    floatV sum = 0.0f;
+
+    for (int k0 = 0; k0 < K; k0 += TILE_K) {
+        // Cooperative loads: work-items stride over the tile elements
+        for (int i = lid; i < TILE_ROWS * TILE_K; i += group_items) {
+            const int r = i / TILE_K, k = i % TILE_K;
+            a_tile[r][k] = row0 + r < M && k0 + k < K ? A[(row0 + r) * K + k0 + k] : 0.0f;
+        }
+        for (int i = lid; i < TILE_K * TILE_VECS; i += group_items) {
+            const int k = i / TILE_VECS, v = i % TILE_VECS;
+            b_tile[k][v] = k0 + k < K ? load_row(&B[(k0 + k) * N], N, (vec0 + v) * VEC) : (floatV)0.0f;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for (int k = 0; k < TILE_K; k++) {
+            sum += a_tile[ly][k] * b_tile[k][lx];
+        }
+
+        // Everyone must be done reading before the next tile overwrites it
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // No early return above: every work-item has to reach the barriers
+    const int row = row0 + ly, col = (vec0 + lx) * VEC;
+    if (row < M && col < N) {
+        store_row(sum, &C[row * N], N, col);
+    }
+}
+
+// ============================================================================
+// matmul_rows: ROWS_PER_ITEM rows x VEC columns per work-item
+// ============================================================================
+
+// Register blocking: each B vector loaded from memory feeds ROWS_PER_ITEM
+// multiply-adds instead of one, cutting B traffic by that factor. In the last
+// row block, rows past M reread row M-1 and are not stored.
+
+__kernel void matmul_rows(
+    __global const float* A,
+    __global const float* B,
+    __global float* C,
+    const int M,
+    const int N,
+    const int K)
+{
+    const int row0 = get_global_id(1) * ROWS_PER_ITEM;
+    const int col_start = get_global_id(0) * VEC;
+
+    if (row0 >= M || col_start >= N) return;
+
+    floatV sum[ROWS_PER_ITEM];
+    int a_row[ROWS_PER_ITEM];
+    for (int r = 0; r < ROWS_PER_ITEM; r++) {
+        sum[r] = 0.0f;
+        a_row[r] = min(row0 + r, M - 1) * K;
+    }
+
+    for (int k = 0; k < K; k++) {
+        const floatV b_vec = load_row(&B[k * N], N, col_start);
+        for (int r = 0; r < ROWS_PER_ITEM; r++) {
+            sum[r] += A[a_row[r] + k] * b_vec;
+        }
+    }
+
+    for (int r = 0; r < ROWS_PER_ITEM && row0 + r < M; r++) {
+        store_row(sum[r], &C[(row0 + r) * N], N, col_start);
+    }
+}
+
+// ============================================================================
+// matmul_bt: B pre-transposed on the host, 1 row x 4 columns per work-item
+// ============================================================================
+
+// With BT[col][k] = B[k][col] (BT is N x K), both operands are read as
+// contiguous float16 runs along k. Each A vector is reused for 4 columns; the
+// 16 lane partial sums are folded once at the end, and a K remainder is
+// finished with scalars. Always float16 (VEC does not apply). Columns past N
+// reread column N-1 and are not stored.
+
+inline float sum_lanes(const float16 v)
+{
+    const float8 s8 = v.lo + v.hi;
+    const float4 s4 = s8.lo + s8.hi;
+    return s4.x + s4.y + s4.z + s4.w;
+}
+
+__kernel void matmul_bt(
+    __global const float* A,
+    __global const float* BT,
+    __global float* C,
+    const int M,
+    const int N,
+    const int K)
+{
+    const int row = get_global_id(1);
+    const int col0 = get_global_id(0) * 4;
+
+    if (row >= M || col0 >= N) return;
+
+    __global const float* a_row = &A[row * K];
+    __global const float* b0 = &BT[col0 * K];
+    __global const float* b1 = &BT[min(col0 + 1, N - 1) * K];
+    __global const float* b2 = &BT[min(col0 + 2, N - 1) * K];
+    __global const float* b3 = &BT[min(col0 + 3, N - 1) * K];
+
+    float16 acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+
+    int k = 0;
+    for (; k + 16 <= K; k += 16) {
+        const float16 a_vec = vload16(0, &a_row[k]);
+        acc0 += a_vec * vload16(0, &b0[k]);
+        acc1 += a_vec * vload16(0, &b1[k]);
+        acc2 += a_vec * vload16(0, &b2[k]);
+        acc3 += a_vec * vload16(0, &b3[k]);
+    }
+
+    float4 c = (float4)(sum_lanes(acc0), sum_lanes(acc1), sum_lanes(acc2), sum_lanes(acc3));
+    for (; k < K; k++) {
+        const float a = a_row[k];
+        c += a * (float4)(b0[k], b1[k], b2[k], b3[k]);
+    }
+
+    if (col0 + 4 <= N) {
+        vstore4(c, 0, &C[row * N + col0]);
+    } else {
+        C[row * N + col0] = c.x;
+        if (col0 + 1 < N) C[row * N + col0 + 1] = c.y;
+        if (col0 + 2 < N) C[row * N + col0 + 2] = c.z;
+    }
+}
+
+// ============================================================================
+// matmul_half: matmul_simple over half-precision A and B
+// ============================================================================
+
+// A and B are stored as IEEE half, halving the bytes each k-step pulls over
+// the shared memory bus; vload_half widens them to float on load, so the
+// products and the sums stay fp32. The half type is only used through
+// pointers, which needs no cl_khr_fp16.
+
+// VEC halves of a row starting at `col` as floats; lanes past `cols` are 0
+inline floatV load_edge_half(__global const half* row, const int cols, const int col)
+{
+    float lanes[VEC];
+    for (int i = 0; i < VEC; i++) {
+        lanes[i] = col + i < cols ? vload_half(col + i, row) : 0.0f;
+    }
+    return vloadV(0, lanes);
+}
+
+__kernel void matmul_half(
+    __global const half* A,
+    __global const half* B,
+    __global float* C,
+    const int M,
+    const int N,
+    const int K)
+{
+    const int row = get_global_id(1);
+    const int col_start = get_global_id(0) * VEC;
+
+    if (row >= M || col_start >= N) return;
+
+    floatV sum = 0.0f;
+    if (col_start + VEC <= N) {
+        for (int k = 0; k < K; k++) {
+            sum += vload_half(row * K + k, A) * vload_halfV(0, &B[k * N + col_start]);
+        }
+    } else {
+        for (int k = 0; k < K; k++) {
+            sum += vload_half(row * K + k, A) * load_edge_half(&B[k * N], N, col_start);
+        }
+    }
+
+    store_row(sum, &C[row * N], N, col_start);
+}
+
+// ============================================================================
+// transpose_b / pack_b: B layouts prepared on the device, once per B
+// ============================================================================
+
+// For a B that multiplies many A's, its layout can be converted once on the
+// device instead of on the host before every upload. transpose_b produces
+// the BT that matmul_bt reads; pack_b produces the 16-wide panels that
+// matmul_packed reads. Neither depends on VEC.
+
+// BT (N x K) = B^T for B (K x N): a 4 x 4 block per work-item, read as four
+// float4 rows and written as four float4 columns. Blocks on the right or
+// bottom edge go element by element.
+__kernel void transpose_b(
+    __global const float* B,
+    __global float* BT,
+    const int K,
+    const int N)
+{
+    const int col = get_global_id(0) * 4;
+    const int k = get_global_id(1) * 4;
+    if (col >= N || k >= K) return;
+
+    if (col + 4 <= N && k + 4 <= K) {
+        const float4 r0 = vload4(0, &B[k * N + col]);
+        const float4 r1 = vload4(0, &B[(k + 1) * N + col]);
+        const float4 r2 = vload4(0, &B[(k + 2) * N + col]);
+        const float4 r3 = vload4(0, &B[(k + 3) * N + col]);
+        vstore4((float4)(r0.x, r1.x, r2.x, r3.x), 0, &BT[col * K + k]);
+        vstore4((float4)(r0.y, r1.y, r2.y, r3.y), 0, &BT[(col + 1) * K + k]);
+        vstore4((float4)(r0.z, r1.z, r2.z, r3.z), 0, &BT[(col + 2) * K + k]);
+        vstore4((float4)(r0.w, r1.w, r2.w, r3.w), 0, &BT[(col + 3) * K + k]);
+        return;
+    }
+    for (int i = k; i < k + 4 && i < K; i++) {
+        for (int j = col; j < col + 4 && j < N; j++) {
+            BT[j * K + i] = B[i * N + j];
+        }
+    }
+}
+
+// BP = B cut into panels of 16 columns, each stored k-major: panel p holds
+// B[k][16p .. 16p+15] for k = 0 .. K-1 as one contiguous run of K float16,
+// so a work-item computing those 16 columns of C streams it front to back.
+// Columns past N are stored as 0; BP holds ceil(N / 16) * 16 * K floats.
+// One float16 per work-item.
+__kernel void pack_b(
+    __global const float* B,
+    __global float* BP,
+    const int K,
+    const int N)
+{
+    const int panel = get_global_id(0);
+    const int k = get_global_id(1);
+    const int col = panel * 16;
+    if (col >= N || k >= K) return;
+
+    float16 v;
+    if (col + 16 <= N) {
+        v = vload16(0, &B[k * N + col]);
+    } else {
+        float lanes[16];
+        for (int i = 0; i < 16; i++) {
+            lanes[i] = col + i < N ? B[k * N + col + i] : 0.0f;
+        }
+        v = vload16(0, lanes);
+    }
+    vstore16(v, panel * K + k, BP);
+}
+
+// ============================================================================
+// matmul_packed: one row x 16 columns per work-item, B from pack_b panels
+// ============================================================================
+
+// As matmul_simple with VEC=16, but the B operand is one panel read
+// sequentially rather than K rows N floats apart, so consecutive loads of a
+// work-item hit the same TMU cache lines. A is read as float4 along k
+// instead of one scalar per k-step. Padded panels need no edge loads; only
+// the last store is masked.
+
+__kernel void matmul_packed(
+    __global const float* A,
+    __global const float* BP,
+    __global float* C,
+    const int M,
+    const int N,
+    const int K)
+{
+    const int row = get_global_id(1);
+    const int panel = get_global_id(0);
+    const int col_start = panel * 16;
+
+    if (row >= M || col_start >= N) return;
+
+    __global const float* a_row = &A[row * K];
+    __global const float* bp = &BP[panel * K * 16];
+
+    float16 sum = 0.0f;
+    int k = 0;
+    for (; k + 4 <= K; k += 4) {
+        const float4 a = vload4(0, &a_row[k]);
+        sum += a.x * vload16(k, bp);
+        sum += a.y * vload16(k + 1, bp);
+        sum += a.z * vload16(k + 2, bp);
+        sum += a.w * vload16(k + 3, bp);
+    }
+    for (; k < K; k++) {
+        sum += a_row[k] * vload16(k, bp);
+    }
+
+    if (col_start + 16 <= N) {
+        vstore16(sum, 0, &C[row * N + col_start]);
+        return;
+    }
+    float lanes[16];
+    vstore16(sum, 0, lanes);
+    for (int i = 0; col_start + i < N; i++) {
+        C[row * N + col_start + i] = lanes[i];
+    }
 }
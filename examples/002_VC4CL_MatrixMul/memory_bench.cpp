@@ -0,0 +1,153 @@
+/**
+ * Copy vs zero-copy end-to-end sweep
+ */
+
+#include "memory_bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_common.h"
+#include "host_buffers.h"
+
+// One request end to end: produce A and B on the host, hand them to the
+// device, multiply, and consume C on the host. Returns the C checksum via
+// `checksum`, or a CL error.
+static cl_int memory_bench_once(cl_command_queue queue, cl_kernel kernel, const gemm_geometry_t* g,
+                                mem_mode_t mode, const gemm_launch_t* l,
+                                float* host_A, float* host_B, float* host_C, int seed,
+                                double* checksum) {
+    const int n = l->shape.n;
+    const cl_mem buf_A = l->a, buf_B = l->b, buf_C = l->c;
+    const size_t bytes = (size_t)n * n * sizeof(float);
+    cl_int err = CL_SUCCESS;
+
+    float* A = host_A;
+    float* B = host_B;
+    if (mode != MEM_COPY) {
+        A = map_matrix(queue, buf_A, CL_MAP_WRITE_INVALIDATE_REGION, bytes, NULL, &err);
+        if (err != CL_SUCCESS) return err;
+        B = map_matrix(queue, buf_B, CL_MAP_WRITE_INVALIDATE_REGION, bytes, NULL, &err);
+        if (err != CL_SUCCESS) return err;
+    }
+    fill_matrix(A, (size_t)n * n, seed);
+    fill_matrix(B, (size_t)n * n, seed + 1);
+
+    if (mode == MEM_COPY) {
+        err = clEnqueueWriteBuffer(queue, buf_A, CL_FALSE, 0, bytes, A, 0, NULL, NULL);
+        err |= clEnqueueWriteBuffer(queue, buf_B, CL_FALSE, 0, bytes, B, 0, NULL, NULL);
+    } else {
+        err = clEnqueueUnmapMemObject(queue, buf_A, A, 0, NULL, NULL);
+        err |= clEnqueueUnmapMemObject(queue, buf_B, B, 0, NULL, NULL);
+    }
+    if (err != CL_SUCCESS) return err;
+
+    err = enqueue_gemm(queue, kernel, g, l, 0, NULL, NULL);
+    if (err != CL_SUCCESS) return err;
+
+    // Both wait for the kernel: in-order queue, blocking call
+    float* C = host_C;
+    if (mode == MEM_COPY) {
+        err = clEnqueueReadBuffer(queue, buf_C, CL_TRUE, 0, bytes, C, 0, NULL, NULL);
+    } else {
+        C = map_matrix(queue, buf_C, CL_MAP_READ, bytes, NULL, &err);
+    }
+    if (err != CL_SUCCESS) return err;
+
+    double sum = 0.0;
+    for (int i = 0; i < n * n; i++) sum += C[i];
+    *checksum = sum;
+
+    if (mode != MEM_COPY) {
+        err = clEnqueueUnmapMemObject(queue, buf_C, C, 0, NULL, NULL);
+        if (err != CL_SUCCESS) return err;
+    }
+    return clFinish(queue);
+}
+
+// Average end-to-end latency of `repeats` requests at size n in `mode`,
+// or a negative value if a buffer or launch failed
+static double memory_bench_mode(cl_context context, cl_command_queue queue, cl_kernel kernel,
+                                const gemm_geometry_t* g, mem_mode_t mode, int n, int repeats,
+                                double* checksum) {
+    const size_t bytes = (size_t)n * n * sizeof(float);
+    float* backing[3] = { NULL, NULL, NULL };
+    float* host[3] = { NULL, NULL, NULL };
+    cl_mem bufs[3] = { NULL, NULL, NULL };
+    const cl_mem_flags access[3] = { CL_MEM_READ_ONLY, CL_MEM_READ_ONLY, CL_MEM_WRITE_ONLY };
+    double total_ms = -1.0;
+    cl_int err = CL_SUCCESS;
+
+    for (int i = 0; i < 3 && err == CL_SUCCESS; i++) {
+        bufs[i] = create_matrix_buffer(context, mode, access[i], bytes, &backing[i], &err);
+        if (err == CL_SUCCESS && mode == MEM_COPY) {
+            host[i] = host_matrix_alloc(bytes);
+            if (!host[i]) err = CL_OUT_OF_HOST_MEMORY;
+        }
+    }
+    const gemm_launch_t launch = { bufs[0], bufs[1], bufs[2], { n, n, n } };
+
+    // Request 0 warms up (first touch of the pages, first launch)
+    if (err == CL_SUCCESS) {
+        total_ms = 0.0;
+        for (int r = 0; r <= repeats; r++) {
+            double start = get_time_ms();
+            err = memory_bench_once(queue, kernel, g, mode, &launch, host[0], host[1], host[2], r, checksum);
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "Error: %s run at %d failed (%s)\n", mem_mode_name(mode), n, cl_error_string(err));
+                total_ms = -1.0;
+                break;
+            }
+            if (r > 0) total_ms += get_time_ms() - start;
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (bufs[i]) clReleaseMemObject(bufs[i]);
+        free(backing[i]);
+        free(host[i]);
+    }
+    return total_ms < 0.0 ? -1.0 : total_ms / repeats;
+}
+
+void run_memory_bench(const memory_bench_params_t* p) {
+    const gemm_variant_t* v = p->variant;
+    const int max_dim = p->max_dim;
+    const int repeats = p->repeats;
+    const gemm_geometry_t g = variant_geometry(v, p->config);
+    size_t kernel_max_wg = 0;
+    clGetKernelWorkGroupInfo(p->kernel, p->device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernel_max_wg), &kernel_max_wg, NULL);
+    if (variant_unsupported(&g, kernel_max_wg)) return;
+
+    printf("--- Copy vs Zero-Copy End-to-End (variant %s, avg of %d) ---\n", v->name, repeats);
+    printf("Per request: fill A and B on the host, hand them over, multiply, sum C on the host\n\n");
+    printf("%6s", "N");
+    for (int m = 0; m < NUM_MEM_MODES; m++) printf(" %9s ms", mem_mode_name((mem_mode_t)m));
+    printf("   %s\n", "fastest");
+
+    for (int n = 32; n <= max_dim; n = n * 2 <= max_dim || n == max_dim ? n * 2 : max_dim) {
+        const gemm_shape_t square = { n, n, n };
+        if (gemm_needs_tiling(&square, p->max_alloc)) break;
+
+        double ms[NUM_MEM_MODES], checksum[NUM_MEM_MODES];
+        int best = -1, mismatch = 0;
+        for (int m = 0; m < NUM_MEM_MODES; m++) {
+            ms[m] = memory_bench_mode(p->context, p->queue, p->kernel, &g, (mem_mode_t)m, n, repeats, &checksum[m]);
+            if (ms[m] < 0.0) continue;
+            if (best < 0 || ms[m] < ms[best]) best = m;
+            if (ms[0] >= 0.0 && fabs(checksum[m] - checksum[0]) > 1e-3 * fabs(checksum[0])) mismatch = 1;
+        }
+
+        printf("%6d", n);
+        for (int m = 0; m < NUM_MEM_MODES; m++) {
+            if (ms[m] < 0.0) printf(" %12s", "failed");
+            else printf(" %12.3f", ms[m]);
+        }
+        if (best >= 0 && ms[0] >= 0.0) {
+            printf("   %s (%.2fx vs copy)", mem_mode_name((mem_mode_t)best), ms[0] / ms[best]);
+        }
+        printf("%s\n", mismatch ? "   results differ!" : "");
+    }
+    printf("\n");
+}
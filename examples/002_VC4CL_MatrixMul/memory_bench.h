@@ -0,0 +1,37 @@
+/**
+ * Copy vs zero-copy end-to-end sweep (--memory-bench)
+ *
+ * Each request produces A and B on the host, hands them to the device,
+ * multiplies and consumes C on the host, once per memory mode at every
+ * square size from 32 up. Where the data lives matters more than the
+ * kernel at small sizes, so the sweep shows where zero-copy pays off.
+ */
+
+#ifndef MEMORY_BENCH_H
+#define MEMORY_BENCH_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "gemm_kernels.h"
+
+typedef struct {
+    cl_context context;
+    cl_command_queue queue;
+    cl_device_id device;
+    cl_kernel kernel;         // built for `variant` under `config`
+    const gemm_variant_t* variant;
+    const gemm_config_t* config;
+    int max_dim;              // largest N of the sweep
+    size_t max_alloc;         // single-buffer limit; the sweep stops where N x N exceeds it
+    int repeats;              // requests averaged per size and mode
+} memory_bench_params_t;
+
+// Sweep square sizes 32, 64, ... up to max_dim with every memory mode,
+// stopping where a matrix no longer fits in one buffer
+void run_memory_bench(const memory_bench_params_t* p);
+
+#endif // MEMORY_BENCH_H
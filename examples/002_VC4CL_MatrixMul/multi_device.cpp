@@ -0,0 +1,265 @@
+/**
+ * Multi-device partitioning of one GEMM
+ */
+
+#include "multi_device.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gemm_lib.h"
+#include "program_cache.h"
+#include "tune_cache.h"
+
+// Rows each device multiplies alone to calibrate the split
+static const int MULTI_DEVICE_CAL_ROWS = 64;
+
+// One device of a partitioned GEMM, with its own context, queue and program
+typedef struct {
+    const device_entry_t* entry;
+    gemm_context_t cl;        // queue with profiling enabled
+    cl_program program;
+    cl_kernel kernel;
+    gemm_config_t config;
+    const char* config_source;
+    const char* dropped;      // why the device takes no part, NULL if it does
+    cl_mem a, b, c;           // A's row slice, all of B (or B^T), C's row slice
+    int row0, rows;
+    double rate;              // calibrated rows of C per ms
+    double alone_gflops;
+    double ms;                // device time of the last partitioned multiply
+} md_device_t;
+
+static void md_release_slices(md_device_t* d) {
+    if (d->a) clReleaseMemObject(d->a);
+    if (d->c) clReleaseMemObject(d->c);
+    d->a = d->c = NULL;
+}
+
+// Buffers for `rows` rows starting at `row0`, with A's rows uploaded
+static cl_int md_alloc_slices(md_device_t* d, const gemm_shape_t* s, const float* A, int row0, int rows) {
+    cl_int err;
+    md_release_slices(d);
+    d->row0 = row0;
+    d->rows = rows;
+    if (rows == 0) return CL_SUCCESS;
+
+    const size_t a_bytes = (size_t)rows * s->k * sizeof(float);
+    d->a = clCreateBuffer(d->cl.context, CL_MEM_READ_ONLY, a_bytes, NULL, &err);
+    if (err == CL_SUCCESS) {
+        d->c = clCreateBuffer(d->cl.context, CL_MEM_WRITE_ONLY, (size_t)rows * s->n * sizeof(float), NULL, &err);
+    }
+    if (err == CL_SUCCESS) {
+        err = clEnqueueWriteBuffer(d->cl.queue, d->a, CL_TRUE, 0, a_bytes, &A[(size_t)row0 * s->k], 0, NULL, NULL);
+    }
+    return err;
+}
+
+static gemm_launch_t md_launch(const md_device_t* d, const gemm_shape_t* s) {
+    const gemm_launch_t l = { d->a, d->b, d->c, { d->rows, s->n, s->k } };
+    return l;
+}
+
+// Context, queue, program and kernel for `v` on one device, plus all of B.
+// Sets d->dropped instead of failing when the device cannot take part.
+static void md_setup(md_device_t* d, const multi_device_params_t* p) {
+    const gemm_variant_t* v = p->variant;
+    const gemm_shape_t* s = &p->shape;
+    const size_t b_bytes = (size_t)s->k * s->n * sizeof(float);
+    cl_int err;
+
+    int tuned_size = 0;
+    d->config = GEMM_DEFAULT_CONFIG;
+    d->config_source = "default";
+    if (tune_cache_load(p->tune_file, &d->entry->id, v->name, &d->config, &tuned_size, NULL)) d->config_source = "cached";
+
+    err = gemm_context_open(d->entry->device, CL_QUEUE_PROFILING_ENABLE, &d->cl);
+    if (err != CL_SUCCESS) {
+        d->dropped = "no context or queue";
+        return;
+    }
+
+    char options[320];
+    config_build_options(&d->config, options, sizeof(options));
+    d->program = program_build(p->cache_dir, &d->entry->id, d->cl.context, d->entry->device, p->source,
+                               p->source_length, options, 1, NULL, &err);
+    if (!d->program) {
+        d->dropped = "build failed";
+        return;
+    }
+    d->kernel = clCreateKernel(d->program, v->kernel, &err);
+    if (err != CL_SUCCESS) {
+        d->dropped = "no kernel";
+        return;
+    }
+
+    size_t kernel_max_wg = d->entry->max_work_group_size;
+    clGetKernelWorkGroupInfo(d->kernel, d->entry->device, CL_KERNEL_WORK_GROUP_SIZE,
+                             sizeof(kernel_max_wg), &kernel_max_wg, NULL);
+    const gemm_geometry_t g = variant_geometry(v, &d->config);
+    d->dropped = variant_unsupported(&g, kernel_max_wg);
+    if (d->dropped) return;
+    if (b_bytes > d->entry->max_alloc) {
+        d->dropped = "B exceeds its buffer limit";
+        return;
+    }
+
+    d->b = clCreateBuffer(d->cl.context, CL_MEM_READ_ONLY, b_bytes, NULL, &err);
+    if (err == CL_SUCCESS) err = clEnqueueWriteBuffer(d->cl.queue, d->b, CL_TRUE, 0, b_bytes, p->B, 0, NULL, NULL);
+    if (err != CL_SUCCESS) d->dropped = "cannot hold B";
+}
+
+// One multiply over every device with rows: all slices are enqueued and
+// flushed before any is waited for, so the devices run concurrently
+static cl_int md_multiply(md_device_t* devs, int count, const gemm_variant_t* v, const gemm_shape_t* s, float* C) {
+    cl_event kernel_events[MAX_MULTI_DEVICES] = { NULL };
+    cl_event read_events[MAX_MULTI_DEVICES] = { NULL };
+    cl_int err = CL_SUCCESS;
+
+    for (int i = 0; i < count && err == CL_SUCCESS; i++) {
+        md_device_t* d = &devs[i];
+        if (d->dropped || d->rows == 0) continue;
+        const gemm_geometry_t g = variant_geometry(v, &d->config);
+        const gemm_launch_t l = md_launch(d, s);
+        err = enqueue_gemm(d->cl.queue, d->kernel, &g, &l, 0, NULL, &kernel_events[i]);
+        if (err == CL_SUCCESS) {
+            err = clEnqueueReadBuffer(d->cl.queue, d->c, CL_FALSE, 0, (size_t)d->rows * s->n * sizeof(float),
+                                      &C[(size_t)d->row0 * s->n], 0, NULL, &read_events[i]);
+        }
+        if (err == CL_SUCCESS) err = clFlush(d->cl.queue);
+    }
+    for (int i = 0; i < count; i++) {
+        if (read_events[i]) {
+            cl_int wait_err = clWaitForEvents(1, &read_events[i]);
+            if (err == CL_SUCCESS) err = wait_err;
+            if (wait_err == CL_SUCCESS) devs[i].ms = event_span_ms(kernel_events[i], read_events[i]);
+        } else if (devs[i].cl.queue) {
+            clFinish(devs[i].cl.queue);
+        }
+        if (kernel_events[i]) clReleaseEvent(kernel_events[i]);
+        if (read_events[i]) clReleaseEvent(read_events[i]);
+    }
+    return err;
+}
+
+void run_multi_device(const multi_device_params_t* p) {
+    const int* indices = p->indices;
+    const int count = p->count;
+    const gemm_variant_t* v = p->variant;
+    const gemm_shape_t* s = &p->shape;
+    const float* A = p->A;
+    float* C = p->C;
+    md_device_t devs[MAX_MULTI_DEVICES];
+    memset(devs, 0, sizeof(devs));
+    const double flops = gemm_flops(s);
+    const int cal_rows = s->m < MULTI_DEVICE_CAL_ROWS ? s->m : MULTI_DEVICE_CAL_ROWS;
+    double total_rate = 0.0, total_ms = 0.0;
+    cl_int err = CL_SUCCESS;
+
+    printf("--- Multi-Device Partitioning (variant %s, %d devices) ---\n", v->name, count);
+
+    // Calibrate one device at a time on the same rows, so none competes
+    // with another for the host or the memory bus
+    for (int i = 0; i < count; i++) {
+        md_device_t* d = &devs[i];
+        d->entry = &p->entries[indices[i]];
+        md_setup(d, p);
+        if (!d->dropped && md_alloc_slices(d, s, A, 0, cal_rows) != CL_SUCCESS) d->dropped = "cannot hold its slice";
+        for (int r = 0; r < 2 && !d->dropped; r++) {
+            if (md_multiply(d, 1, v, s, C) != CL_SUCCESS) d->dropped = "calibration failed";
+        }
+        if (!d->dropped && d->ms > 0.0) {
+            d->rate = cal_rows / d->ms;
+            d->alone_gflops = 2.0 * cal_rows * s->n * s->k / (d->ms * 1e6);
+            total_rate += d->rate;
+        } else if (!d->dropped) {
+            d->dropped = "no timing";
+        }
+    }
+
+    printf("%3s  %-28s %-8s %10s %12s\n", "#", "Device", "Config", "Rows/ms", "Alone GFLOPS");
+    for (int i = 0; i < count; i++) {
+        const md_device_t* d = &devs[i];
+        if (d->dropped) {
+            printf("%3d  %-28.28s dropped: %s\n", indices[i], d->entry->id.device, d->dropped);
+            continue;
+        }
+        printf("%3d  %-28.28s %-8s %10.2f %12.3f\n", indices[i], d->entry->id.device, d->config_source,
+               d->rate, d->alone_gflops);
+    }
+    if (total_rate <= 0.0) {
+        printf("No device can take part\n\n");
+        err = CL_DEVICE_NOT_AVAILABLE;
+    }
+
+    // Shares proportional to rate, in whole work-item row blocks; the last
+    // participating device takes what rounding leaves
+    int row0 = 0, last = -1;
+    for (int i = 0; i < count; i++) {
+        if (!devs[i].dropped) last = i;
+    }
+    for (int i = 0; i < count && err == CL_SUCCESS; i++) {
+        md_device_t* d = &devs[i];
+        if (d->dropped) continue;
+        const gemm_geometry_t g = variant_geometry(v, &d->config);
+        const int granule = g.rows_per_item * (g.local_y > 0 ? g.local_y : 1);
+        int rows = i == last ? s->m - row0 : (int)(s->m * d->rate / total_rate / granule + 0.5) * granule;
+        if (rows > s->m - row0) rows = s->m - row0;
+        if ((size_t)rows * s->k * sizeof(float) > d->entry->max_alloc ||
+            (size_t)rows * s->n * sizeof(float) > d->entry->max_alloc) {
+            fprintf(stderr, "Error: %d rows exceed the buffer limit of %s\n", rows, d->entry->id.device);
+            err = CL_INVALID_BUFFER_SIZE;
+            break;
+        }
+        err = md_alloc_slices(d, s, A, row0, rows);
+        row0 += rows;
+    }
+
+    if (err == CL_SUCCESS) {
+        printf("\n%5s", "Iter");
+        for (int i = 0; i < count; i++) {
+            if (!devs[i].dropped) printf("  dev %d ms", indices[i]);
+        }
+        printf(" %9s %9s\n", "Wall ms", "GFLOPS");
+    }
+    for (int iter = 0; iter < p->iterations && err == CL_SUCCESS; iter++) {
+        double start = get_time_ms();
+        err = md_multiply(devs, count, v, s, C);
+        double wall_ms = get_time_ms() - start;
+        if (err != CL_SUCCESS) break;
+        total_ms += wall_ms;
+        printf("%5d", iter + 1);
+        for (int i = 0; i < count; i++) {
+            if (!devs[i].dropped) printf(" %9.2f", devs[i].ms);
+        }
+        printf(" %9.2f %9.3f\n", wall_ms, flops / (wall_ms * 1e6));
+    }
+
+    if (err == CL_SUCCESS) {
+        variant_result_t check;
+        compare_results(p->ref, C, &check);
+        const double avg_ms = total_ms / p->iterations;
+        double best_alone = 0.0, sum_alone = 0.0;
+        printf("\nRows:");
+        for (int i = 0; i < count; i++) {
+            if (devs[i].dropped) continue;
+            printf(" dev %d %d (%.1f%%)", indices[i], devs[i].rows, 100.0 * devs[i].rows / s->m);
+            if (devs[i].alone_gflops > best_alone) best_alone = devs[i].alone_gflops;
+            sum_alone += devs[i].alone_gflops;
+        }
+        printf("\nCombined: %.2f ms, %.3f GFLOPS (fastest device alone %.3f, sum of all %.3f)\n",
+               avg_ms, flops / (avg_ms * 1e6), best_alone, sum_alone);
+        printf("Max error %.6f (%d/%zu > 1e-3)\n\n", check.max_error, check.error_count, p->ref->count);
+    } else if (total_rate > 0.0) {
+        fprintf(stderr, "Error: Multi-device run failed (%s)\n\n", cl_error_string(err));
+    }
+
+    for (int i = 0; i < count; i++) {
+        md_device_t* d = &devs[i];
+        md_release_slices(d);
+        if (d->b) clReleaseMemObject(d->b);
+        if (d->kernel) clReleaseKernel(d->kernel);
+        if (d->program) clReleaseProgram(d->program);
+        gemm_context_close(&d->cl);
+    }
+}
@@ -0,0 +1,47 @@
+/**
+ * Multi-device partitioning of one GEMM (--multi-device)
+ *
+ * Every listed device gets its own context, queue and program for the same
+ * variant, with its own cached configuration, and all of B. Each is timed
+ * alone on the same rows, then C's rows are split in proportion to those
+ * rates and all slices run concurrently.
+ */
+
+#ifndef MULTI_DEVICE_H
+#define MULTI_DEVICE_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "bench_common.h"
+#include "devices.h"
+#include "gemm_kernels.h"
+
+// Devices in one partitioned run
+#define MAX_MULTI_DEVICES 8
+
+typedef struct {
+    const device_entry_t* entries;
+    const int* indices;       // the entries taking part
+    int count;                // at most MAX_MULTI_DEVICES
+    const gemm_variant_t* variant;
+    const char* source;       // matmul.cl, built on every device
+    size_t source_length;
+    gemm_shape_t shape;
+    const float* A;
+    const float* B;           // B, or B^T for a variant that reads it
+    float* C;
+    const reference_t* ref;
+    int iterations;
+    const char* tune_file;    // tuned configurations per device
+    const char* cache_dir;    // program binary cache; NULL = always compile
+} multi_device_params_t;
+
+// Split a GEMM's rows across the devices, one context and queue per
+// device, in proportion to each device's calibrated speed
+void run_multi_device(const multi_device_params_t* p);
+
+#endif // MULTI_DEVICE_H
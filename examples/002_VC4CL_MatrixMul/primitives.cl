@@ -0,0 +1,204 @@
+// Parallel primitives for VC4CL (Raspberry Pi GPU)
+// Exclusive prefix scan, histogram and stream compaction, the building
+// blocks of filtering stages. None of them uses atomics: VC4CL has no fast
+// ones, so every work-item or group owns the memory it writes. Work-groups
+// may have any size (VC4CL allows 12). The host side is in gemm_lib.cpp.
+
+#define PER_ITEM 16         // elements per work-item in every kernel below
+
+// ============================================================================
+// scan_blocks / scan_add: work-efficient exclusive scan of ints
+// ============================================================================
+
+// A group scans a block of local_size * PER_ITEM elements: each work-item
+// scans its PER_ITEM elements serially, the group scans the item totals in
+// local memory, and each item adds its prefix back. The block's total goes
+// to sums[]; the host scans the totals the same way, level by level, then
+// scan_add adds each block's scanned total to its elements. Every level
+// does O(n) work.
+
+// Blelloch scan of scratch[0 .. pow2) in place, exclusive. pow2 is the
+// local size rounded up to a power of two, with the padding entries 0; each
+// work-item takes every local_size-th node of a tree level.
+inline void scan_group(__local int* scratch, const int pow2)
+{
+    const int lid = get_local_id(0);
+    const int lsize = get_local_size(0);
+
+    // Up-sweep: each node becomes the sum of its subtree
+    for (int stride = 1; stride < pow2; stride *= 2) {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int j = lid; j < pow2 / (2 * stride); j += lsize) {
+            const int i = (j + 1) * 2 * stride - 1;
+            scratch[i] += scratch[i - stride];
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lid == 0) scratch[pow2 - 1] = 0;
+
+    // Down-sweep: each node passes its prefix left and prefix + left sum right
+    for (int stride = pow2 / 2; stride >= 1; stride /= 2) {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int j = lid; j < pow2 / (2 * stride); j += lsize) {
+            const int i = (j + 1) * 2 * stride - 1;
+            const int left = scratch[i - stride];
+            scratch[i - stride] = scratch[i];
+            scratch[i] += left;
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+// Scans data[data_offset .. + n) in place, one block per group, and writes
+// each block's total to sums[sums_offset + group]
+__kernel void scan_blocks(
+    __global int* data,
+    const int data_offset,
+    const int n,
+    __global int* sums,
+    const int sums_offset,
+    __local int* scratch,
+    const int pow2)
+{
+    const int lid = get_local_id(0);
+    const int lsize = get_local_size(0);
+    const int first = (get_group_id(0) * lsize + lid) * PER_ITEM;
+    __global int* d = &data[data_offset];
+
+    int prefix[PER_ITEM];
+    int total = 0;
+    for (int i = 0; i < PER_ITEM; i++) {
+        prefix[i] = total;
+        total += first + i < n ? d[first + i] : 0;
+    }
+
+    for (int i = lsize + lid; i < pow2; i += lsize) {
+        scratch[i] = 0;
+    }
+    scratch[lid] = total;
+    scan_group(scratch, pow2);
+    const int offset = scratch[lid];
+
+    for (int i = 0; i < PER_ITEM && first + i < n; i++) {
+        d[first + i] = prefix[i] + offset;
+    }
+    if (lid == lsize - 1) sums[sums_offset + get_group_id(0)] = offset + total;
+}
+
+// data[data_offset + i] += sums[sums_offset + block of i], with the blocks
+// of the scan_blocks launch over the same data
+__kernel void scan_add(
+    __global int* data,
+    const int data_offset,
+    const int n,
+    __global const int* sums,
+    const int sums_offset)
+{
+    const int first = get_global_id(0) * PER_ITEM;
+    const int add = sums[sums_offset + get_group_id(0)];
+    __global int* d = &data[data_offset];
+    for (int i = 0; i < PER_ITEM && first + i < n; i++) {
+        d[first + i] += add;
+    }
+}
+
+// ============================================================================
+// histogram_partial / histogram_merge: privatized histogram
+// ============================================================================
+
+// Every work-item counts into its own column of a bins x local_size array
+// in local memory, so no two items ever increment the same counter. The
+// group then sums its columns into one partial histogram, and
+// histogram_merge sums the groups' partials per bin. The host sizes the
+// group so the array fits the device's local memory.
+
+// bin = (x - lo) * scale for x in [lo, hi), scale = bins / (hi - lo);
+// values outside the range and NaN are not counted
+__kernel void histogram_partial(
+    __global const float* x,
+    const int n,
+    const float lo,
+    const float hi,
+    const float scale,
+    const int bins,
+    __global uint* partial,
+    __local uint* counts)
+{
+    const int lid = get_local_id(0);
+    const int lsize = get_local_size(0);
+    const int stride = get_global_size(0) * PER_ITEM;
+
+    for (int b = 0; b < bins; b++) {
+        counts[b * lsize + lid] = 0;
+    }
+
+    // Grid-strided runs of PER_ITEM, so a group's items read adjacent runs
+    for (int first = get_global_id(0) * PER_ITEM; first < n; first += stride) {
+        for (int i = first; i < first + PER_ITEM && i < n; i++) {
+            const float v = x[i];
+            if (v >= lo && v < hi) {
+                const int bin = min((int)((v - lo) * scale), bins - 1);
+                counts[bin * lsize + lid]++;
+            }
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int b = lid; b < bins; b += lsize) {
+        uint sum = 0;
+        for (int j = 0; j < lsize; j++) {
+            sum += counts[b * lsize + j];
+        }
+        partial[get_group_id(0) * bins + b] = sum;
+    }
+}
+
+// counts[b] = sum of the `groups` partial histograms, one bin per work-item
+__kernel void histogram_merge(
+    __global const uint* partial,
+    const int groups,
+    const int bins,
+    __global uint* counts)
+{
+    const int b = get_global_id(0);
+    if (b >= bins) return;
+    uint sum = 0;
+    for (int g = 0; g < groups; g++) {
+        sum += partial[g * bins + b];
+    }
+    counts[b] = sum;
+}
+
+// ============================================================================
+// compact_flags / compact_scatter: stream compaction
+// ============================================================================
+
+// Keeps the elements of x greater than a threshold, in order: flags marks
+// them, an exclusive scan of the flags gives each kept element its output
+// index, and scatter writes it there. The scan's total is the kept count.
+
+__kernel void compact_flags(
+    __global const float* x,
+    const int n,
+    const float threshold,
+    __global int* flags)
+{
+    const int first = get_global_id(0) * PER_ITEM;
+    for (int i = first; i < first + PER_ITEM && i < n; i++) {
+        flags[i] = x[i] > threshold;
+    }
+}
+
+__kernel void compact_scatter(
+    __global const float* x,
+    __global const int* offsets,
+    const int n,
+    const float threshold,
+    __global float* out)
+{
+    const int first = get_global_id(0) * PER_ITEM;
+    for (int i = first; i < first + PER_ITEM && i < n; i++) {
+        const float v = x[i];
+        if (v > threshold) out[offsets[i]] = v;
+    }
+}
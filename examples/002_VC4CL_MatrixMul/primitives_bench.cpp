@@ -0,0 +1,203 @@
+/**
+ * Parallel primitives on the CPU and the device
+ */
+
+#include "primitives_bench.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_common.h"
+#include "gemm_lib.h"
+
+enum { PRIM_OP_SCAN, PRIM_OP_HISTOGRAM, PRIM_OP_COMPACT, PRIM_OPS };
+static const char* PRIM_OP_NAMES[PRIM_OPS] = { "scan", "histogram", "compact" };
+static const float PRIM_HIST_LO = 0.1f, PRIM_HIST_HI = 0.9f;   // part of the data falls outside
+static const int PRIM_HIST_BINS = 64;
+static const float PRIM_THRESHOLD = 0.5f;
+
+// Sizes around block and group edges, checked before the timed runs
+static const int PRIM_EDGE_SIZES[] = { 1, 15, 16, 17, 191, 192, 193, 1000, 4097, 65537 };
+#define PRIM_EDGE_MAX 65537
+
+typedef struct {
+    int* scan;                // n
+    int scan_total;
+    unsigned int hist[256];   // PRIM_HIST_BINS used
+    float* kept;              // n
+    int kept_count;
+} prim_result_t;
+
+// One call on the device through `h`, or on the CPU if `h` is NULL, over
+// the first n elements of `x` (histogram, compact) or `values` (scan)
+static cl_int prim_op(gemm_handle_t* h, int op, int n, const float* x, const int* values, prim_result_t* r) {
+    if (h) {
+        switch (op) {
+            case PRIM_OP_SCAN: return scan_exclusive(h, n, values, r->scan, &r->scan_total);
+            case PRIM_OP_HISTOGRAM:
+                return histogram(h, n, x, PRIM_HIST_LO, PRIM_HIST_HI, PRIM_HIST_BINS, r->hist);
+            default: return compact(h, n, x, PRIM_THRESHOLD, r->kept, &r->kept_count);
+        }
+    }
+
+    switch (op) {
+        case PRIM_OP_SCAN: {
+            int sum = 0;
+            for (int i = 0; i < n; i++) {
+                r->scan[i] = sum;
+                sum += values[i];
+            }
+            r->scan_total = sum;
+            break;
+        }
+        case PRIM_OP_HISTOGRAM: {
+            // Same float arithmetic as histogram_partial, so bins match exactly
+            const float scale = PRIM_HIST_BINS / (PRIM_HIST_HI - PRIM_HIST_LO);
+            memset(r->hist, 0, sizeof(r->hist));
+            for (int i = 0; i < n; i++) {
+                if (!(x[i] >= PRIM_HIST_LO && x[i] < PRIM_HIST_HI)) continue;
+                int bin = (int)((x[i] - PRIM_HIST_LO) * scale);
+                r->hist[bin < PRIM_HIST_BINS - 1 ? bin : PRIM_HIST_BINS - 1]++;
+            }
+            break;
+        }
+        default:
+            r->kept_count = 0;
+            for (int i = 0; i < n; i++) {
+                if (x[i] > PRIM_THRESHOLD) r->kept[r->kept_count++] = x[i];
+            }
+            break;
+    }
+    return CL_SUCCESS;
+}
+
+// Results are integers or copied floats, so they must match exactly
+static int prim_match(int op, int n, const prim_result_t* a, const prim_result_t* b) {
+    switch (op) {
+        case PRIM_OP_SCAN:
+            return a->scan_total == b->scan_total && memcmp(a->scan, b->scan, (size_t)n * sizeof(int)) == 0;
+        case PRIM_OP_HISTOGRAM:
+            return memcmp(a->hist, b->hist, PRIM_HIST_BINS * sizeof(unsigned int)) == 0;
+        default:
+            return a->kept_count == b->kept_count &&
+                   memcmp(a->kept, b->kept, (size_t)a->kept_count * sizeof(float)) == 0;
+    }
+}
+
+// Bytes an operation has to move at least once
+static double prim_op_bytes(int op, int n, const prim_result_t* r) {
+    switch (op) {
+        case PRIM_OP_SCAN: return 2.0 * n * sizeof(int);
+        case PRIM_OP_HISTOGRAM: return (double)n * sizeof(float);
+        default: return ((double)n + r->kept_count) * sizeof(float);
+    }
+}
+
+void run_primitives_bench(const primitives_bench_params_t* p) {
+    const gemm_shape_t* s = &p->shape;
+    const int iterations = p->iterations;
+    const size_t n = (size_t)s->m * s->k;
+    const size_t len = n > PRIM_EDGE_MAX ? n : PRIM_EDGE_MAX;
+    if (n > (size_t)INT_MAX) {
+        printf("--- Parallel Primitives Benchmark skipped (more than INT_MAX elements) ---\n\n");
+        return;
+    }
+
+    float* x = (float*)malloc(len * sizeof(float));
+    int* values = (int*)malloc(len * sizeof(int));
+    prim_result_t cpu, gpu;
+    memset(&cpu, 0, sizeof(cpu));
+    memset(&gpu, 0, sizeof(gpu));
+    cpu.scan = (int*)malloc(len * sizeof(int));
+    gpu.scan = (int*)malloc(len * sizeof(int));
+    cpu.kept = (float*)malloc(len * sizeof(float));
+    gpu.kept = (float*)malloc(len * sizeof(float));
+    gemm_handle_t* h = NULL;
+    cl_int err = CL_SUCCESS;
+    int edge_failures = 0;
+    if (!x || !values || !cpu.scan || !gpu.scan || !cpu.kept || !gpu.kept) {
+        fprintf(stderr, "Error: Failed to allocate host memory\n\n");
+        goto done;
+    }
+    fill_matrix(x, len, 4);
+    for (size_t i = 0; i < len; i++) {
+        values[i] = (int)(x[i] * 4.0f);   // 0 to 3, like compaction flags or small counts
+    }
+
+    {
+        gemm_options_t opt;
+        memset(&opt, 0, sizeof(opt));
+        opt.device = p->device;
+        opt.tune_file = p->tune_file;
+        opt.cache_dir = p->cache_dir;
+        h = gemm_open(&opt, &err);
+    }
+    if (!h) {
+        fprintf(stderr, "Error: gemm_open failed (%s)\n\n", cl_error_string(err));
+        goto done;
+    }
+
+    printf("--- Parallel Primitives Benchmark (n = %zu, %d iterations) ---\n", n, iterations);
+    printf("histogram: %d bins over [%.1f, %.1f); compact: keep x > %.1f\n", PRIM_HIST_BINS,
+           PRIM_HIST_LO, PRIM_HIST_HI, PRIM_THRESHOLD);
+
+    // Exact checks first; the first call also builds primitives.cl
+    for (int op = 0; op < PRIM_OPS && err == CL_SUCCESS; op++) {
+        for (size_t e = 0; e < sizeof(PRIM_EDGE_SIZES) / sizeof(PRIM_EDGE_SIZES[0]); e++) {
+            const int size = PRIM_EDGE_SIZES[e];
+            prim_op(NULL, op, size, x, values, &cpu);
+            err = prim_op(h, op, size, x, values, &gpu);
+            if (err != CL_SUCCESS) break;
+            if (!prim_match(op, size, &cpu, &gpu)) {
+                printf("MISMATCH: %s at n = %d\n", PRIM_OP_NAMES[op], size);
+                edge_failures++;
+            }
+        }
+    }
+    if (err == CL_SUCCESS) {
+        printf("Edge sizes: %s\n", edge_failures ? "FAILED" : "all exact");
+        printf("%-10s %9s %9s %9s %9s %9s %11s %7s\n", "Op", "CPU ms", "CPU GB/s", "GPU ms", "GB/s",
+               "Kernel ms", "Kernel GB/s", "Check");
+    }
+
+    for (int op = 0; op < PRIM_OPS && err == CL_SUCCESS; op++) {
+        double cpu_ms = 0.0, gpu_ms = 0.0, kernel_ms = 0.0;
+        for (int iter = 0; iter < iterations && err == CL_SUCCESS; iter++) {
+            double start = get_time_ms();
+            prim_op(NULL, op, (int)n, x, values, &cpu);
+            double mid = get_time_ms();
+            err = prim_op(h, op, (int)n, x, values, &gpu);
+            double end = get_time_ms();
+            cpu_ms += mid - start;
+            gpu_ms += end - mid;
+            gemm_stats_t st;
+            gemm_get_stats(h, &st);
+            kernel_ms += st.last_kernel_ms;
+        }
+        if (err != CL_SUCCESS) break;
+        cpu_ms /= iterations;
+        gpu_ms /= iterations;
+        kernel_ms /= iterations;
+
+        const double bytes = prim_op_bytes(op, (int)n, &cpu);
+        printf("%-10s %9.3f %9.3f %9.3f %9.3f %9.3f %11.3f %7s\n", PRIM_OP_NAMES[op],
+               cpu_ms, bytes / (cpu_ms * 1e6), gpu_ms, bytes / (gpu_ms * 1e6),
+               kernel_ms, kernel_ms > 0.0 ? bytes / (kernel_ms * 1e6) : 0.0,
+               prim_match(op, (int)n, &cpu, &gpu) ? "exact" : "WRONG");
+    }
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Primitives call failed (%s)\n", cl_error_string(err));
+    }
+    printf("GPU ms is the whole call (uploads, kernels, read); kernel ms is device time only\n\n");
+
+done:
+    gemm_close(h);
+    free(x);
+    free(values);
+    free(cpu.scan);
+    free(gpu.scan);
+    free(cpu.kept);
+    free(gpu.kept);
+}
@@ -0,0 +1,26 @@
+/**
+ * Parallel primitives on the CPU and the device (--primitives)
+ *
+ * Exclusive scan, histogram and stream compaction through a gemm_lib
+ * handle. Their results are integers or copied floats, so each is checked
+ * exactly against the CPU, at sizes around block edges and at M * K.
+ */
+
+#ifndef PRIMITIVES_BENCH_H
+#define PRIMITIVES_BENCH_H
+
+#include "tiling.h"
+
+typedef struct {
+    const char* device;       // index or name as for --device
+    gemm_shape_t shape;       // the data is M * K elements long
+    int iterations;
+    const char* tune_file;    // tuned configurations to use if present
+    const char* cache_dir;    // program binary cache; NULL = always compile
+} primitives_bench_params_t;
+
+// Scan, histogram and compaction through a gemm_lib handle: exact checks
+// against the CPU at edge sizes and at n = M * K, then throughput at n
+void run_primitives_bench(const primitives_bench_params_t* p);
+
+#endif // PRIMITIVES_BENCH_H
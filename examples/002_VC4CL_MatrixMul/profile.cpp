@@ -0,0 +1,94 @@
+/**
+ * OpenCL event profiling log
+ */
+
+#include "profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int profile_record(profile_log_t* log, cl_event event, const char* name, const char* phase,
+                   const char* variant, size_t bytes, double host_enqueue_ms) {
+    if (log->count == log->capacity) {
+        int capacity = log->capacity ? log->capacity * 2 : 64;
+        profile_event_t* grown = (profile_event_t*)realloc(log->events, capacity * sizeof(profile_event_t));
+        if (!grown) {
+            clReleaseEvent(event);
+            return 1;
+        }
+        log->events = grown;
+        log->capacity = capacity;
+    }
+
+    profile_event_t* e = &log->events[log->count];
+    memset(e, 0, sizeof(*e));
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    snprintf(e->phase, sizeof(e->phase), "%s", phase);
+    snprintf(e->variant, sizeof(e->variant), "%s", variant);
+    e->bytes = bytes;
+    e->host_enqueue_ms = host_enqueue_ms;
+
+    // Timestamps are only valid once the command has completed
+    cl_int err = clWaitForEvents(1, &event);
+    err |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &e->queued, NULL);
+    err |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &e->submit, NULL);
+    err |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &e->start, NULL);
+    err |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &e->end, NULL);
+    clReleaseEvent(event);
+    if (err != CL_SUCCESS) return 1;
+
+    log->count++;
+    return 0;
+}
+
+void profile_free(profile_log_t* log) {
+    free(log->events);
+    memset(log, 0, sizeof(*log));
+}
+
+double profile_event_ms(const profile_event_t* e) {
+    return (double)(e->end - e->start) * 1e-6;
+}
+
+const profile_event_t* profile_find(const profile_log_t* log, const char* name, const char* variant) {
+    for (int i = 0; i < log->count; i++) {
+        const profile_event_t* e = &log->events[i];
+        if (strcmp(e->name, name) == 0 && strcmp(e->variant, variant) == 0) return e;
+    }
+    return NULL;
+}
+
+void json_write_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+void profile_write_events_json(FILE* f, const profile_log_t* log, const char* indent) {
+    cl_ulong t0 = 0;
+    for (int i = 0; i < log->count; i++) {
+        if (i == 0 || log->events[i].queued < t0) t0 = log->events[i].queued;
+    }
+
+    fprintf(f, "[");
+    for (int i = 0; i < log->count; i++) {
+        const profile_event_t* e = &log->events[i];
+        fprintf(f, "%s\n%s  {\"name\": ", i ? "," : "", indent);
+        json_write_string(f, e->name);
+        fprintf(f, ", \"phase\": ");
+        json_write_string(f, e->phase);
+        fprintf(f, ", \"variant\": ");
+        json_write_string(f, e->variant);
+        fprintf(f, ", \"bytes\": %zu, \"host_enqueue_us\": %.3f, "
+                   "\"queued_ns\": %llu, \"submit_ns\": %llu, \"start_ns\": %llu, \"end_ns\": %llu}",
+                e->bytes, e->host_enqueue_ms * 1e3,
+                (unsigned long long)(e->queued - t0), (unsigned long long)(e->submit - t0),
+                (unsigned long long)(e->start - t0), (unsigned long long)(e->end - t0));
+    }
+    fprintf(f, "%s%s]", log->count ? "\n" : "", log->count ? indent : "");
+}
@@ -0,0 +1,53 @@
+/**
+ * OpenCL event profiling log
+ *
+ * Collects CL_PROFILING_COMMAND_{QUEUED,SUBMIT,START,END} for every command
+ * the driver enqueues in --profile mode, and writes them out as JSON.
+ * Requires a queue created with CL_QUEUE_PROFILING_ENABLE.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct {
+    char name[32];            // e.g. "write A", "kernel"
+    char phase[16];           // "write", "fill", "warmup", "kernel" or "read"
+    char variant[16];         // kernel variant, "" for shared uploads
+    size_t bytes;             // bytes moved, 0 for kernels
+    double host_enqueue_ms;   // host time inside the clEnqueue* call
+    cl_ulong queued, submit, start, end;   // device timestamps in ns
+} profile_event_t;
+
+typedef struct {
+    profile_event_t* events;
+    int count;
+    int capacity;
+} profile_log_t;
+
+// Append `event` (waiting for it first) and release it. Returns 0 on success.
+int profile_record(profile_log_t* log, cl_event event, const char* name, const char* phase,
+                   const char* variant, size_t bytes, double host_enqueue_ms);
+
+void profile_free(profile_log_t* log);
+
+// Device execution time (start to end) in ms
+double profile_event_ms(const profile_event_t* e);
+
+// First recorded event with this name and variant ("" = shared), or NULL
+const profile_event_t* profile_find(const profile_log_t* log, const char* name, const char* variant);
+
+// Write `s` as a JSON string literal
+void json_write_string(FILE* f, const char* s);
+
+// Write the events as a JSON array, timestamps in ns relative to the first
+// queued command
+void profile_write_events_json(FILE* f, const profile_log_t* log, const char* indent);
+
+#endif // PROFILE_H
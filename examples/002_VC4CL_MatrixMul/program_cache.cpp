@@ -0,0 +1,219 @@
+/**
+ * Program binary cache files
+ *
+ * One file per key, named after a 64-bit FNV-1a hash of everything the
+ * binary depends on:
+ *   VC4CLBIN1
+ *   source=<hash>  options=...  platform=...  device=...  driver=...
+ *   build_ms=3125.40
+ *   size=<bytes>
+ *   <binary>
+ * The identity line is compared in full, so hash collisions and driver
+ * upgrades read as misses and the entry is rebuilt and overwritten.
+ */
+
+#include "program_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+static const char* CACHE_MAGIC = "VC4CLBIN1";
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+static unsigned long long fnv1a(unsigned long long h, const void* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < length; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static unsigned long long hash_string(unsigned long long h, const char* s) {
+    return fnv1a(h, s, strlen(s) + 1);  // include the terminator as a separator
+}
+
+static void make_identity(const tune_device_t* dev, const char* source, size_t source_length,
+                          const char* options, char* out, size_t size) {
+    unsigned long long source_hash = fnv1a(14695981039346656037ULL, source, source_length);
+    snprintf(out, size, "source=%016llx\toptions=%s\tplatform=%s\tdevice=%s\tdriver=%s",
+             source_hash, options, dev->platform, dev->device, dev->driver);
+}
+
+static void make_path(const char* dir, const char* identity, char* out, size_t size) {
+    unsigned long long h = hash_string(14695981039346656037ULL, identity);
+    snprintf(out, size, "%s/%016llx.clbin", dir, h);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void print_build_log(cl_program program, cl_device_id device) {
+    size_t log_size;
+    clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
+    char* log = (char*)malloc(log_size + 1);
+    if (log) {
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, log_size, log, NULL);
+        log[log_size] = '\0';
+        fprintf(stderr, "Build log:\n%s\n", log);
+        free(log);
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+cl_program program_cache_load(const char* dir, const tune_device_t* dev,
+                              cl_context context, cl_device_id device,
+                              const char* source, size_t source_length,
+                              const char* options, double* cold_build_ms) {
+    char identity[1400], path[1024], line[1400];
+    make_identity(dev, source, source_length, options, identity, sizeof(identity));
+    make_path(dir, identity, path, sizeof(path));
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    cl_program program = NULL;
+    unsigned char* binary = NULL;
+    double build_ms = 0.0;
+    size_t binary_size = 0;
+
+    if (!fgets(line, sizeof(line), f) || strncmp(line, CACHE_MAGIC, strlen(CACHE_MAGIC)) != 0) goto done;
+    if (!fgets(line, sizeof(line), f)) goto done;
+    line[strcspn(line, "\n")] = '\0';
+    if (strcmp(line, identity) != 0) goto done;
+    if (!fgets(line, sizeof(line), f) || sscanf(line, "build_ms=%lf", &build_ms) != 1) goto done;
+    if (!fgets(line, sizeof(line), f) || sscanf(line, "size=%zu", &binary_size) != 1 || binary_size == 0) goto done;
+
+    binary = (unsigned char*)malloc(binary_size);
+    if (!binary || fread(binary, 1, binary_size, f) != binary_size) goto done;
+
+    {
+        const unsigned char* binaries[1] = { binary };
+        cl_int status, err;
+        program = clCreateProgramWithBinary(context, 1, &device, &binary_size, binaries, &status, &err);
+        if (err != CL_SUCCESS || status != CL_SUCCESS) {
+            if (program) clReleaseProgram(program);
+            program = NULL;
+            goto done;
+        }
+        // Still required for binaries; cheap, since no compilation happens
+        if (clBuildProgram(program, 1, &device, options, NULL, NULL) != CL_SUCCESS) {
+            clReleaseProgram(program);
+            program = NULL;
+            goto done;
+        }
+    }
+    if (cold_build_ms) *cold_build_ms = build_ms;
+
+done:
+    free(binary);
+    fclose(f);
+    return program;
+}
+
+int program_cache_store(const char* dir, const tune_device_t* dev, cl_program program,
+                        const char* source, size_t source_length,
+                        const char* options, double build_ms) {
+    char identity[1400], path[1024], tmp_path[1040];
+    make_identity(dev, source, source_length, options, identity, sizeof(identity));
+    make_path(dir, identity, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    size_t binary_size = 0;
+    cl_int err = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, NULL);
+    if (err != CL_SUCCESS || binary_size == 0) {
+        fprintf(stderr, "Warning: Driver returned no program binary, not caching\n");
+        return 1;
+    }
+
+    unsigned char* binary = (unsigned char*)malloc(binary_size);
+    if (!binary) return 1;
+    unsigned char* binaries[1] = { binary };
+    err = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaries), binaries, NULL);
+    if (err != CL_SUCCESS) {
+        free(binary);
+        return 1;
+    }
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Warning: Cannot create program cache '%s' (%s)\n", dir, strerror(errno));
+        free(binary);
+        return 1;
+    }
+
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        fprintf(stderr, "Warning: Cannot write program cache '%s'\n", tmp_path);
+        free(binary);
+        return 1;
+    }
+    fprintf(f, "%s\n%s\nbuild_ms=%.2f\nsize=%zu\n", CACHE_MAGIC, identity, build_ms, binary_size);
+    size_t written = fwrite(binary, 1, binary_size, f);
+    free(binary);
+
+    // Write then rename, so a crash never leaves a truncated binary behind
+    if (fclose(f) != 0 || written != binary_size || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Warning: Cannot replace program cache '%s'\n", path);
+        remove(tmp_path);
+        return 1;
+    }
+    return 0;
+}
+
+cl_program program_build(const char* dir, const tune_device_t* dev, cl_context context, cl_device_id device,
+                         const char* source, size_t source_length, const char* options,
+                         int verbose, build_stats_t* stats, cl_int* err) {
+    double start = now_ms();
+    double cold_ms = 0.0;
+
+    if (dir) {
+        cl_program cached = program_cache_load(dir, dev, context, device, source, source_length, options, &cold_ms);
+        if (cached) {
+            if (stats) {
+                stats->cached++;
+                stats->cached_ms += now_ms() - start;
+                stats->cold_ms += cold_ms;
+            }
+            *err = CL_SUCCESS;
+            return cached;
+        }
+    }
+
+    cl_program program = clCreateProgramWithSource(context, 1, &source, &source_length, err);
+    if (*err != CL_SUCCESS) {
+        if (verbose) fprintf(stderr, "Error: Failed to create program (error %d)\n", *err);
+        return NULL;
+    }
+
+    *err = clBuildProgram(program, 1, &device, options, NULL, NULL);
+    if (*err != CL_SUCCESS) {
+        if (verbose) {
+            fprintf(stderr, "Error: Failed to build program with '%s' (error %d)\n", options, *err);
+            print_build_log(program, device);
+        }
+        clReleaseProgram(program);
+        return NULL;
+    }
+
+    double build_ms = now_ms() - start;
+    if (stats) {
+        stats->compiled++;
+        stats->compiled_ms += build_ms;
+    }
+    // A failed store only costs the next run a compile
+    if (dir) program_cache_store(dir, dev, program, source, source_length, options, build_ms);
+    return program;
+}
@@ -0,0 +1,53 @@
+/**
+ * On-disk cache of compiled OpenCL program binaries
+ *
+ * VC4CL compiles matmul.cl with a full LLVM pipeline on the host CPU, which
+ * takes seconds on a Cortex-A53. The cache stores CL_PROGRAM_BINARIES per
+ * (source, build options, platform, device, driver) so later runs can load
+ * the program with clCreateProgramWithBinary instead.
+ */
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "tune_cache.h"
+
+// Load the binary for (source, options, dev) from `dir` and build it for
+// `device`. Returns NULL on a miss, a stale entry or a binary the driver
+// rejects; the caller then compiles from source. On a hit, `cold_build_ms`
+// (if non-NULL) receives the source compile time recorded when it was stored.
+cl_program program_cache_load(const char* dir, const tune_device_t* dev,
+                              cl_context context, cl_device_id device,
+                              const char* source, size_t source_length,
+                              const char* options, double* cold_build_ms);
+
+// Store the binary of a program built from (source, options) for a single
+// device. `build_ms` is the source compile time. Returns 0 on success.
+int program_cache_store(const char* dir, const tune_device_t* dev, cl_program program,
+                        const char* source, size_t source_length,
+                        const char* options, double build_ms);
+
+// Where program setup time went, for the cold vs warm startup report
+typedef struct {
+    int cached;               // programs loaded from the binary cache
+    int compiled;             // programs compiled from source
+    double cached_ms;         // time spent loading binaries
+    double compiled_ms;       // time spent compiling
+    double cold_ms;           // recorded compile time of the cached programs
+} build_stats_t;
+
+// Load the program from the cache in `dir`, or compile it from source and
+// store the binary; `dir` NULL always compiles. Returns NULL with `err` set
+// on failure, with the error and build log on stderr only if `verbose`.
+// `stats` (if non-NULL) is added to: `cached` counts hits, `compiled` misses.
+cl_program program_build(const char* dir, const tune_device_t* dev, cl_context context, cl_device_id device,
+                         const char* source, size_t source_length, const char* options,
+                         int verbose, build_stats_t* stats, cl_int* err);
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,87 @@
+/**
+ * JSON report of a benchmark run
+ */
+
+#include "report.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int write_json_report(const char* path, const report_t* rep) {
+    const tune_device_t* dev = rep->dev;
+    const build_stats_t* bs = rep->build_stats;
+    const profile_log_t* log = rep->log;
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write report '%s'\n", path);
+        return 1;
+    }
+
+    fprintf(f, "{\n  \"platform\": ");
+    json_write_string(f, dev->platform);
+    fprintf(f, ",\n  \"device\": ");
+    json_write_string(f, dev->device);
+    fprintf(f, ",\n  \"driver\": ");
+    json_write_string(f, dev->driver);
+    fprintf(f, ",\n  \"m\": %d,\n  \"n\": %d,\n  \"k\": %d,\n  \"launches_per_matmul\": %d,\n",
+            rep->shape.m, rep->shape.n, rep->shape.k, rep->launches_per_run);
+    fprintf(f, "  \"iterations\": %d,\n  \"profiling\": %s,\n", rep->iterations, log ? "true" : "false");
+    fprintf(f, "  \"startup\": {\"context_ms\": %.3f, \"programs_ms\": %.3f, \"cached\": %d, "
+               "\"compiled\": %d, \"cold_build_ms\": %.3f},\n",
+            rep->context_ms, rep->build_ms, bs->cached, bs->compiled, bs->cold_ms);
+    fprintf(f, "  \"cpu\": {\"avg_ms\": %.4f, \"gflops\": %.4f, \"estimated\": %s},\n",
+            rep->cpu_avg, rep->cpu_gflops, rep->cpu_estimated ? "true" : "false");
+
+    fprintf(f, "  \"variants\": [");
+    int first = 1;
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        const variant_result_t* r = &rep->results[v];
+        if (!variant_selected(rep->selection, &GEMM_VARIANTS[v])) continue;
+        fprintf(f, "%s\n    {\"name\": ", first ? "" : ",");
+        json_write_string(f, GEMM_VARIANTS[v].name);
+        first = 0;
+        if (r->skipped) {
+            fprintf(f, ", \"skipped\": ");
+            json_write_string(f, r->skipped);
+            fprintf(f, "}");
+            continue;
+        }
+        fprintf(f, ", \"config_source\": ");
+        json_write_string(f, r->config_source);
+        fprintf(f, ", \"avg_ms\": %.4f, \"gflops\": %.4f, \"max_error\": %g, \"error_count\": %d",
+                r->avg_ms, r->gflops, r->max_error, r->error_count);
+        if (r->profiled) {
+            fprintf(f, ", \"kernel_ms\": %.4f, \"kernel_gflops\": %.4f, \"e2e_ms\": %.4f, "
+                       "\"e2e_gflops\": %.4f, \"enqueue_us\": %.2f, \"queue_to_start_us\": %.2f",
+                    r->kernel_ms, r->kernel_gflops, r->e2e_ms, r->e2e_gflops, r->enqueue_us, r->latency_us);
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n  ]");
+
+    if (log) {
+        fprintf(f, ",\n  \"transfers\": [");
+        first = 1;
+        for (int i = 0; i < log->count; i++) {
+            const profile_event_t* e = &log->events[i];
+            if (strcmp(e->phase, "write") != 0 && strcmp(e->phase, "read") != 0) continue;
+            double ms = profile_event_ms(e);
+            fprintf(f, "%s\n    {\"name\": ", first ? "" : ",");
+            json_write_string(f, e->name);
+            fprintf(f, ", \"variant\": ");
+            json_write_string(f, e->variant);
+            fprintf(f, ", \"bytes\": %zu, \"ms\": %.4f, \"gb_per_s\": %.4f}",
+                    e->bytes, ms, ms > 0.0 ? e->bytes / (ms * 1e6) : 0.0);
+            first = 0;
+        }
+        fprintf(f, "\n  ],\n  \"events\": ");
+        profile_write_events_json(f, log, "  ");
+    }
+    fprintf(f, "\n}\n");
+
+    if (fclose(f) != 0) {
+        fprintf(stderr, "Error: Failed writing report '%s'\n", path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+/**
+ * JSON report of a benchmark run (--json)
+ *
+ * The device, shape, startup cost, CPU reference and every selected
+ * variant's result. With --profile it adds each transfer's bandwidth and
+ * the raw event timestamps.
+ */
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "bench_common.h"
+#include "profile.h"
+#include "program_cache.h"
+#include "tiling.h"
+#include "tune_cache.h"
+
+typedef struct {
+    const tune_device_t* dev;
+    gemm_shape_t shape;
+    int launches_per_run;     // tiles per multiply, 1 untiled
+    int iterations;
+    const char* selection;    // --variant: only matching variants are listed
+    double cpu_avg;
+    double cpu_gflops;
+    int cpu_estimated;        // cpu_avg extrapolated from sampled elements
+    const variant_result_t* results;  // GEMM_NUM_VARIANTS entries
+    const profile_log_t* log;  // NULL without --profile
+    double context_ms;
+    double build_ms;
+    const build_stats_t* build_stats;
+} report_t;
+
+// Returns nonzero (with a message) if the file cannot be written
+int write_json_report(const char* path, const report_t* rep);
+
+#endif // REPORT_H
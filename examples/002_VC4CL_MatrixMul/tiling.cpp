@@ -0,0 +1,228 @@
+/**
+ * GEMM shapes, launches and sub-buffer tiling
+ */
+
+#include "tiling.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Panel Matrices
+// ============================================================================
+
+static int panel_height(const panel_matrix_t* p, int panel) {
+    int rows = p->rows - panel * p->panel_rows;
+    return rows < p->panel_rows ? rows : p->panel_rows;
+}
+
+static void panel_matrix_release(panel_matrix_t* p) {
+    for (int i = 0; i < p->num_panels; i++) {
+        if (p->panels && p->panels[i]) clReleaseMemObject(p->panels[i]);
+    }
+    for (int i = 0; i < p->num_chunks; i++) {
+        if (p->chunks && p->chunks[i]) clReleaseMemObject(p->chunks[i]);
+    }
+    free(p->panels);
+    free(p->chunks);
+    memset(p, 0, sizeof(*p));
+}
+
+static cl_int panel_matrix_create(cl_context context, cl_mem_flags flags, int rows, int cols, int panel_rows,
+                                  size_t max_alloc, size_t base_align, panel_matrix_t* p) {
+    memset(p, 0, sizeof(*p));
+    p->rows = rows;
+    p->cols = cols;
+    p->panel_rows = panel_rows;
+    p->num_panels = (rows + panel_rows - 1) / panel_rows;
+
+    // Pack as many panels per chunk as fit, as long as each panel starts on
+    // a base-address boundary a sub-buffer may use
+    const size_t panel_bytes = (size_t)panel_rows * cols * sizeof(float);
+    int per_chunk = (int)(max_alloc / panel_bytes);
+    if (per_chunk < 1 || panel_bytes % base_align != 0) per_chunk = 1;
+    if (per_chunk > p->num_panels) per_chunk = p->num_panels;
+    p->panels_per_chunk = per_chunk;
+    p->num_chunks = (p->num_panels + per_chunk - 1) / per_chunk;
+
+    p->chunks = (cl_mem*)calloc(p->num_chunks, sizeof(cl_mem));
+    p->panels = (cl_mem*)calloc(p->num_panels, sizeof(cl_mem));
+    if (!p->chunks || !p->panels) {
+        panel_matrix_release(p);
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+
+    cl_int err = CL_SUCCESS;
+    for (int c = 0; c < p->num_chunks && err == CL_SUCCESS; c++) {
+        const int first = c * per_chunk;
+        const int last = first + per_chunk < p->num_panels ? first + per_chunk : p->num_panels;
+        const int chunk_rows = (last - 1) * panel_rows + panel_height(p, last - 1) - first * panel_rows;
+        p->chunks[c] = clCreateBuffer(context, flags, (size_t)chunk_rows * cols * sizeof(float), NULL, &err);
+
+        for (int i = first; i < last && err == CL_SUCCESS; i++) {
+            if (per_chunk == 1) {
+                p->panels[i] = p->chunks[c];
+                clRetainMemObject(p->panels[i]);
+                continue;
+            }
+            cl_buffer_region region = { (size_t)(i - first) * panel_bytes,
+                                        (size_t)panel_height(p, i) * cols * sizeof(float) };
+            p->panels[i] = clCreateSubBuffer(p->chunks[c], flags, CL_BUFFER_CREATE_TYPE_REGION, &region, &err);
+        }
+    }
+    if (err != CL_SUCCESS) panel_matrix_release(p);
+    return err;
+}
+
+// Rows of a host matrix with `host_cols` columns, starting at column `col0`,
+// to or from the chunks (each chunk holds consecutive packed rows)
+static cl_int panel_matrix_transfer(cl_command_queue queue, const panel_matrix_t* p, float* host,
+                                    int host_cols, int col0, int read) {
+    const int per_chunk = p->panels_per_chunk;
+    const size_t row_bytes = (size_t)p->cols * sizeof(float);
+    cl_int err = CL_SUCCESS;
+
+    for (int c = 0; c < p->num_chunks && err == CL_SUCCESS; c++) {
+        const int row0 = c * per_chunk * p->panel_rows;
+        const int rows = (row0 + per_chunk * p->panel_rows < p->rows ? per_chunk * p->panel_rows : p->rows - row0);
+
+        if (host_cols == p->cols) {
+            float* src = host + (size_t)row0 * host_cols;
+            const size_t bytes = (size_t)rows * row_bytes;
+            err = read ? clEnqueueReadBuffer(queue, p->chunks[c], CL_TRUE, 0, bytes, src, 0, NULL, NULL)
+                       : clEnqueueWriteBuffer(queue, p->chunks[c], CL_TRUE, 0, bytes, src, 0, NULL, NULL);
+        } else {
+            const size_t buffer_origin[3] = { 0, 0, 0 };
+            const size_t host_origin[3] = { (size_t)col0 * sizeof(float), (size_t)row0, 0 };
+            const size_t region[3] = { row_bytes, (size_t)rows, 1 };
+            const size_t host_pitch = (size_t)host_cols * sizeof(float);
+            err = read ? clEnqueueReadBufferRect(queue, p->chunks[c], CL_TRUE, buffer_origin, host_origin, region,
+                                                 row_bytes, 0, host_pitch, 0, host, 0, NULL, NULL)
+                       : clEnqueueWriteBufferRect(queue, p->chunks[c], CL_TRUE, buffer_origin, host_origin, region,
+                                                  row_bytes, 0, host_pitch, 0, host, 0, NULL, NULL);
+        }
+    }
+    return err;
+}
+
+// ============================================================================
+// GEMM Tiling
+// ============================================================================
+
+double gemm_flops(const gemm_shape_t* s) {
+    return 2.0 * s->m * s->n * s->k;
+}
+
+int gemm_needs_tiling(const gemm_shape_t* s, size_t max_alloc) {
+    const size_t a = (size_t)s->m * s->k * sizeof(float);
+    const size_t b = (size_t)s->k * s->n * sizeof(float);
+    const size_t c = (size_t)s->m * s->n * sizeof(float);
+    return a > max_alloc || b > max_alloc || c > max_alloc;
+}
+
+int gemm_tiling_choose(const gemm_shape_t* s, size_t max_alloc, int* mb, int* nb) {
+    const size_t max_floats = max_alloc / sizeof(float);
+
+    // Whole rows of B if they fit, else whole float16 vectors per block
+    size_t cols = max_floats / s->k;
+    if (cols >= (size_t)s->n) {
+        *nb = s->n;
+    } else {
+        *nb = (int)(cols / 16 * 16);
+        if (*nb < 16) return 1;
+    }
+
+    // A panel is mb x K, a C block panel mb x nb
+    const size_t widest = (size_t)(s->k > *nb ? s->k : *nb);
+    size_t rows = max_floats / widest;
+    if (rows >= (size_t)s->m) {
+        *mb = s->m;
+    } else {
+        *mb = rows >= 8 ? (int)(rows / 8 * 8) : (int)rows;   // whole row blocks
+        if (*mb < 1) return 1;
+    }
+    return 0;
+}
+
+cl_int gemm_tiling_create(cl_context context, const gemm_shape_t* s, int mb, int nb,
+                          int need_b, int need_bt, size_t max_alloc, size_t base_align,
+                          gemm_tiling_t* t) {
+    memset(t, 0, sizeof(*t));
+    t->shape = *s;
+    t->mb = mb;
+    t->nb = nb;
+    t->row_panels = (s->m + mb - 1) / mb;
+    t->col_blocks = (s->n + nb - 1) / nb;
+
+    t->c = (panel_matrix_t*)calloc(t->col_blocks, sizeof(panel_matrix_t));
+    if (need_b) t->b = (panel_matrix_t*)calloc(t->col_blocks, sizeof(panel_matrix_t));
+    if (!t->c || (need_b && !t->b)) {
+        gemm_tiling_release(t);
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+
+    cl_int err = panel_matrix_create(context, CL_MEM_READ_ONLY, s->m, s->k, mb, max_alloc, base_align, &t->a);
+    if (err == CL_SUCCESS && need_bt) {
+        err = panel_matrix_create(context, CL_MEM_READ_ONLY, s->n, s->k, nb, max_alloc, base_align, &t->bt);
+    }
+    for (int j = 0; j < t->col_blocks && err == CL_SUCCESS; j++) {
+        const int width = s->n - j * nb < nb ? s->n - j * nb : nb;
+        if (need_b) {
+            err = panel_matrix_create(context, CL_MEM_READ_ONLY, s->k, width, s->k, max_alloc, base_align, &t->b[j]);
+        }
+        if (err == CL_SUCCESS) {
+            err = panel_matrix_create(context, CL_MEM_WRITE_ONLY, s->m, width, mb, max_alloc, base_align, &t->c[j]);
+        }
+    }
+    if (err != CL_SUCCESS) gemm_tiling_release(t);
+    return err;
+}
+
+void gemm_tiling_release(gemm_tiling_t* t) {
+    panel_matrix_release(&t->a);
+    panel_matrix_release(&t->bt);
+    for (int j = 0; j < t->col_blocks; j++) {
+        if (t->b) panel_matrix_release(&t->b[j]);
+        if (t->c) panel_matrix_release(&t->c[j]);
+    }
+    free(t->b);
+    free(t->c);
+    memset(t, 0, sizeof(*t));
+}
+
+cl_int gemm_tiling_upload(cl_command_queue queue, const gemm_tiling_t* t,
+                          const float* A, const float* B, const float* BT) {
+    cl_int err = panel_matrix_transfer(queue, &t->a, (float*)A, t->shape.k, 0, 0);
+    if (err == CL_SUCCESS && t->bt.num_panels > 0 && BT) {
+        err = panel_matrix_transfer(queue, &t->bt, (float*)BT, t->shape.k, 0, 0);
+    }
+    for (int j = 0; t->b && B && j < t->col_blocks && err == CL_SUCCESS; j++) {
+        err = panel_matrix_transfer(queue, &t->b[j], (float*)B, t->shape.n, j * t->nb, 0);
+    }
+    return err;
+}
+
+cl_int gemm_tiling_read_c(cl_command_queue queue, const gemm_tiling_t* t, float* C) {
+    cl_int err = CL_SUCCESS;
+    for (int j = 0; j < t->col_blocks && err == CL_SUCCESS; j++) {
+        err = panel_matrix_transfer(queue, &t->c[j], C, t->shape.n, j * t->nb, 1);
+    }
+    return err;
+}
+
+int gemm_tiling_launches(const gemm_tiling_t* t, int transposed_b, gemm_launch_t* out) {
+    int count = 0;
+    for (int j = 0; j < t->col_blocks; j++) {
+        const panel_matrix_t* c = &t->c[j];
+        for (int i = 0; i < t->row_panels; i++) {
+            gemm_launch_t* l = &out[count++];
+            l->a = t->a.panels[i];
+            l->b = transposed_b ? t->bt.panels[j] : t->b[j].panels[0];
+            l->c = c->panels[i];
+            l->shape.m = panel_height(c, i);
+            l->shape.n = c->cols;
+            l->shape.k = t->shape.k;
+        }
+    }
+    return count;
+}
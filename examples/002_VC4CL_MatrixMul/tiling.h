@@ -0,0 +1,82 @@
+/**
+ * GEMM shapes, launches and sub-buffer tiling
+ *
+ * A single OpenCL buffer may not exceed CL_DEVICE_MAX_MEM_ALLOC_SIZE, which
+ * caps the matrices the driver can hand over whole. Larger problems are split
+ * into row panels of A and C and column blocks of B (and C). Each operand is
+ * held in a few chunk allocations under the limit, and every panel is a
+ * sub-buffer of its chunk, so the kernels run unchanged on packed panels.
+ */
+
+#ifndef TILING_H
+#define TILING_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+// C (m x n) = A (m x k) * B (k x n)
+typedef struct {
+    int m, n, k;
+} gemm_shape_t;
+
+// One kernel launch on packed row-major operands
+typedef struct {
+    cl_mem a, b, c;
+    gemm_shape_t shape;
+} gemm_launch_t;
+
+// A rows x cols matrix stored as row panels of `panel_rows` rows (the last
+// may be shorter). Panels sharing a chunk are sub-buffers of it.
+typedef struct {
+    int rows, cols;
+    int panel_rows;
+    int num_panels;
+    int panels_per_chunk;
+    int num_chunks;
+    cl_mem* chunks;
+    cl_mem* panels;
+} panel_matrix_t;
+
+// Every operand of a tiled GEMM. Column block j of B and C is nb wide
+// (the last may be narrower); row panel i of A and C is mb tall.
+typedef struct {
+    gemm_shape_t shape;
+    int mb, nb;
+    int row_panels, col_blocks;
+    panel_matrix_t a;         // M x K, panels of mb rows
+    panel_matrix_t* b;        // per column block: K x nb, one panel (NULL if unused)
+    panel_matrix_t bt;        // N x K, panels of nb rows (unused if num_panels == 0)
+    panel_matrix_t* c;        // per column block: M x nb, panels of mb rows
+} gemm_tiling_t;
+
+double gemm_flops(const gemm_shape_t* s);
+
+// Returns 1 if some operand (A, B, B^T or C) exceeds `max_alloc` bytes
+int gemm_needs_tiling(const gemm_shape_t* s, size_t max_alloc);
+
+// Pick the panel height and block width so that every panel fits in
+// `max_alloc`. Returns 0 on success, 1 if even a 16-column block of B is
+// too large.
+int gemm_tiling_choose(const gemm_shape_t* s, size_t max_alloc, int* mb, int* nb);
+
+// Allocate the operands (B and/or B^T as requested). `base_align` is
+// CL_DEVICE_MEM_BASE_ADDR_ALIGN in bytes.
+cl_int gemm_tiling_create(cl_context context, const gemm_shape_t* s, int mb, int nb,
+                          int need_b, int need_bt, size_t max_alloc, size_t base_align,
+                          gemm_tiling_t* t);
+void gemm_tiling_release(gemm_tiling_t* t);
+
+// Blocking uploads of the host matrices (B is K x N, BT is N x K; either
+// may be NULL if not allocated) and readback of C into an M x N host matrix
+cl_int gemm_tiling_upload(cl_command_queue queue, const gemm_tiling_t* t,
+                          const float* A, const float* B, const float* BT);
+cl_int gemm_tiling_read_c(cl_command_queue queue, const gemm_tiling_t* t, float* C);
+
+// Launches covering the whole product, column block by row panel. `out`
+// needs row_panels * col_blocks entries. Returns the count.
+int gemm_tiling_launches(const gemm_tiling_t* t, int transposed_b, gemm_launch_t* out);
+
+#endif // TILING_H
@@ -0,0 +1,143 @@
+/**
+ * Autotune cache file
+ *
+ * Line format (tab-separated, one entry per device and variant):
+ *   platform=...  device=...  driver=...  variant=...  size=512  gflops=0.31
+ *   flags=...  vec=16  tile_rows=4  tile_vecs=2  tile_k=16  rows_per_item=4
+ *   local_x=0  local_y=0
+ * Lines starting with '#' are comments.
+ */
+
+#include "tune_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Line Parsing
+// ============================================================================
+
+typedef struct {
+    tune_device_t dev;
+    char variant[64];
+    int size;
+    double gflops;
+    gemm_config_t cfg;
+} tune_entry_t;
+
+static void copy_field(char* dst, size_t dst_size, const char* value) {
+    snprintf(dst, dst_size, "%s", value);
+}
+
+// Parses one line in place. Returns 1 if it is a complete entry.
+static int parse_entry(char* line, tune_entry_t* e) {
+    memset(e, 0, sizeof(*e));
+    int seen = 0;
+
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '#' || line[0] == '\0') return 0;
+
+    char* save = NULL;
+    for (char* tok = strtok_r(line, "\t", &save); tok; tok = strtok_r(NULL, "\t", &save)) {
+        char* eq = strchr(tok, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        const char* key = tok;
+        const char* value = eq + 1;
+
+        if (strcmp(key, "platform") == 0) { copy_field(e->dev.platform, sizeof(e->dev.platform), value); seen |= 1; }
+        else if (strcmp(key, "device") == 0) { copy_field(e->dev.device, sizeof(e->dev.device), value); seen |= 2; }
+        else if (strcmp(key, "driver") == 0) { copy_field(e->dev.driver, sizeof(e->dev.driver), value); seen |= 4; }
+        else if (strcmp(key, "variant") == 0) { copy_field(e->variant, sizeof(e->variant), value); seen |= 8; }
+        else if (strcmp(key, "size") == 0) e->size = atoi(value);
+        else if (strcmp(key, "gflops") == 0) e->gflops = atof(value);
+        else if (strcmp(key, "flags") == 0) copy_field(e->cfg.flags, sizeof(e->cfg.flags), value);
+        else if (strcmp(key, "vec") == 0) { e->cfg.vec = atoi(value); seen |= 16; }
+        else if (strcmp(key, "tile_rows") == 0) e->cfg.tile_rows = atoi(value);
+        else if (strcmp(key, "tile_vecs") == 0) e->cfg.tile_vecs = atoi(value);
+        else if (strcmp(key, "tile_k") == 0) e->cfg.tile_k = atoi(value);
+        else if (strcmp(key, "rows_per_item") == 0) e->cfg.rows_per_item = atoi(value);
+        else if (strcmp(key, "local_x") == 0) e->cfg.local_x = atoi(value);
+        else if (strcmp(key, "local_y") == 0) e->cfg.local_y = atoi(value);
+    }
+
+    // Reject entries a hand edit left without a usable configuration
+    if (seen != 31) return 0;
+    if (e->cfg.vec != 4 && e->cfg.vec != 8 && e->cfg.vec != 16) return 0;
+    if (e->cfg.tile_rows < 1 || e->cfg.tile_vecs < 1 || e->cfg.tile_k < 1 || e->cfg.rows_per_item < 1) return 0;
+    if (e->cfg.local_x < 0 || e->cfg.local_y < 0) return 0;
+    return 1;
+}
+
+static int same_key(const tune_entry_t* e, const tune_device_t* dev, const char* variant) {
+    return strcmp(e->dev.platform, dev->platform) == 0 &&
+           strcmp(e->dev.device, dev->device) == 0 &&
+           strcmp(e->dev.driver, dev->driver) == 0 &&
+           strcmp(e->variant, variant) == 0;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int tune_cache_load(const char* path, const tune_device_t* dev, const char* variant,
+                    gemm_config_t* cfg, int* tuned_size, double* tuned_gflops) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+
+    char line[1024];
+    int found = 0;
+    tune_entry_t e;
+    while (fgets(line, sizeof(line), f)) {
+        if (parse_entry(line, &e) && same_key(&e, dev, variant)) {
+            *cfg = e.cfg;
+            if (tuned_size) *tuned_size = e.size;
+            if (tuned_gflops) *tuned_gflops = e.gflops;
+            found = 1;  // keep reading: the last entry wins
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+int tune_cache_store(const char* path, const tune_device_t* dev, const char* variant,
+                     const gemm_config_t* cfg, int tuned_size, double tuned_gflops) {
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* out = fopen(tmp_path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot write tune cache '%s'\n", tmp_path);
+        return 1;
+    }
+
+    // Copy every line except the one being replaced
+    FILE* in = fopen(path, "r");
+    if (in) {
+        char line[1024], parsed[1024];
+        tune_entry_t e;
+        while (fgets(line, sizeof(line), in)) {
+            memcpy(parsed, line, sizeof(line));
+            if (parse_entry(parsed, &e) && same_key(&e, dev, variant)) continue;
+            fputs(line, out);
+        }
+        fclose(in);
+    } else {
+        fprintf(out, "# vc4cl_mm autotune cache: one line per (platform, device, driver, variant)\n");
+    }
+
+    fprintf(out, "platform=%s\tdevice=%s\tdriver=%s\tvariant=%s\tsize=%d\tgflops=%.4f\t"
+                 "flags=%s\tvec=%d\ttile_rows=%d\ttile_vecs=%d\ttile_k=%d\trows_per_item=%d\t"
+                 "local_x=%d\tlocal_y=%d\n",
+            dev->platform, dev->device, dev->driver, variant, tuned_size, tuned_gflops,
+            cfg->flags, cfg->vec, cfg->tile_rows, cfg->tile_vecs, cfg->tile_k, cfg->rows_per_item,
+            cfg->local_x, cfg->local_y);
+
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error: Cannot replace tune cache '%s'\n", path);
+        remove(tmp_path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+/**
+ * Autotuned GEMM configurations, persisted per (platform, device, driver)
+ *
+ * The cache is a plain text file with one tab-separated key=value line per
+ * device and kernel variant, so it can be inspected and edited by hand.
+ */
+
+#ifndef TUNE_CACHE_H
+#define TUNE_CACHE_H
+
+// Everything the tuner may change for one kernel variant
+typedef struct {
+    char flags[64];         // compiler flags, e.g. "-cl-fast-relaxed-math"
+    int vec;                // VEC: C columns per vector (4, 8 or 16)
+    int tile_rows;          // TILE_ROWS (matmul_tiled)
+    int tile_vecs;          // TILE_VECS (matmul_tiled)
+    int tile_k;             // TILE_K (matmul_tiled)
+    int rows_per_item;      // ROWS_PER_ITEM (matmul_rows)
+    int local_x, local_y;   // work-group for untiled kernels, 0 = driver's choice
+} gemm_config_t;
+
+// Identity tuned configurations and cached binaries are valid for
+typedef struct {
+    char platform[256];
+    char device[256];
+    char driver[256];
+} tune_device_t;
+
+// Look up `variant` for `dev` in the cache file. Returns 1 and fills `cfg`
+// (plus the tuned matrix size and GFLOPS, if non-NULL) when found, 0 otherwise.
+int tune_cache_load(const char* path, const tune_device_t* dev, const char* variant,
+                    gemm_config_t* cfg, int* tuned_size, double* tuned_gflops);
+
+// Insert or replace the entry for (dev, variant). Returns 0 on success.
+int tune_cache_store(const char* path, const tune_device_t* dev, const char* variant,
+                     const gemm_config_t* cfg, int tuned_size, double tuned_gflops);
+
+#endif // TUNE_CACHE_H
@@ -0,0 +1,146 @@
+/**
+ * Autotuner for the kernel variants
+ */
+
+#include "tuner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "program_cache.h"
+
+// Candidates are rebuilt per option set; local sizes reuse the best program
+static const char* TUNE_FLAGS[] = { "-cl-fast-relaxed-math", "-cl-mad-enable", "" };
+static const int TUNE_VECS[] = { 4, 8, 16 };
+static const int TUNE_TILE_ROWS[] = { 1, 2, 4, 8 };
+static const int TUNE_TILE_VECS[] = { 1, 2, 4 };
+static const int TUNE_TILE_K[] = { 8, 16, 32 };
+static const int TUNE_ROWS_PER_ITEM[] = { 1, 2, 4, 8 };
+static const int TUNE_LOCAL[] = { 1, 2, 3, 4, 6, 8, 12, 16 };   // 12 = VC4CL's limit
+#define COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+// Time one candidate with an already built program. Returns the average ms,
+// or -1 if it cannot run here or produces wrong results.
+static double tune_measure(tuner_t* t, cl_program program, const gemm_config_t* cfg) {
+    const gemm_geometry_t g = variant_geometry(t->variant, cfg);
+    double total_ms = 0.0, avg_ms = -1.0;
+    cl_int err;
+
+    cl_kernel kernel = clCreateKernel(program, t->variant->kernel, &err);
+    if (err != CL_SUCCESS) return -1.0;
+
+    size_t kernel_max_wg = t->max_work_group_size;
+    clGetKernelWorkGroupInfo(kernel, t->device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernel_max_wg), &kernel_max_wg, NULL);
+
+    const gemm_shape_t* s = &t->launch.shape;
+    if (!variant_unsupported(&g, kernel_max_wg) &&
+        launch_timed(t->queue, kernel, &g, &t->launch, 1, t->iterations, &total_ms, NULL, NULL) == CL_SUCCESS &&
+        clEnqueueReadBuffer(t->queue, t->launch.c, CL_TRUE, 0, (size_t)s->m * s->n * sizeof(float),
+                            t->C_gpu, 0, NULL, NULL) == CL_SUCCESS) {
+        // Reject wrong answers, not rounding: fp32 sums of K terms in [0, 1)
+        // may drift by ~K * eps * K/4, so allow 1e-4 per unit of K
+        variant_result_t check;
+        compare_results(t->ref, t->C_gpu, &check);
+        if (check.max_error <= 1e-4 * s->k) avg_ms = total_ms / t->iterations;
+    }
+    clReleaseKernel(kernel);
+    return avg_ms;
+}
+
+// Build (or reuse) the program for `cfg`, measure it, and keep it if faster
+static void tune_try(tuner_t* t, const gemm_config_t* cfg) {
+    const gemm_geometry_t g = variant_geometry(t->variant, cfg);
+    char options[320], best_options[320], config[256];
+
+    // Cheap rejections before paying for a compile
+    if (variant_unsupported(&g, t->max_work_group_size)) return;
+
+    config_build_options(cfg, options, sizeof(options));
+    config_build_options(&t->best, best_options, sizeof(best_options));
+    cl_program program = t->best_program;
+    if (!program || strcmp(options, best_options) != 0) {
+        cl_int err;
+        program = program_build(t->cache_dir, t->dev, t->context, t->device, t->source, t->source_length, options, 0,
+                                NULL, &err);
+    }
+
+    double ms = program ? tune_measure(t, program, cfg) : -1.0;
+    t->tried++;
+
+    config_describe(t->variant, cfg, config, sizeof(config));
+    if (ms < 0) printf("  [tune %s] %-48s rejected\n", t->variant->name, config);
+    else printf("  [tune %s] %-48s %8.2f ms\n", t->variant->name, config, ms);
+
+    if (ms >= 0 && (t->best_ms < 0 || ms < t->best_ms)) {
+        if (t->best_program && t->best_program != program) clReleaseProgram(t->best_program);
+        t->best = *cfg;
+        t->best_program = program;
+        t->best_ms = ms;
+    } else if (program && program != t->best_program) {
+        clReleaseProgram(program);
+    }
+}
+
+int tune_variant(tuner_t* t, const gemm_config_t* start) {
+    const gemm_kind_t kind = t->variant->kind;
+    const int uses_vec = kind != GEMM_BT;
+    const int uses_local = kind != GEMM_TILED;
+    gemm_config_t c;
+
+    t->best = *start;
+    t->best_program = NULL;
+    t->best_ms = -1.0;
+    t->tried = 0;
+    tune_try(t, start);
+
+    // Stage 1: compiler flags and vector width
+    for (int f = 0; f < COUNT_OF(TUNE_FLAGS); f++) {
+        for (int w = 0; w < (uses_vec ? COUNT_OF(TUNE_VECS) : 1); w++) {
+            c = t->best;
+            snprintf(c.flags, sizeof(c.flags), "%s", TUNE_FLAGS[f]);
+            if (uses_vec) c.vec = TUNE_VECS[w];
+            tune_try(t, &c);
+        }
+    }
+
+    // Stage 2: blocking
+    if (kind == GEMM_TILED) {
+        const gemm_config_t base = t->best;
+        for (int r = 0; r < COUNT_OF(TUNE_TILE_ROWS); r++) {
+            for (int v = 0; v < COUNT_OF(TUNE_TILE_VECS); v++) {
+                for (int k = 0; k < COUNT_OF(TUNE_TILE_K); k++) {
+                    c = base;
+                    c.tile_rows = TUNE_TILE_ROWS[r];
+                    c.tile_vecs = TUNE_TILE_VECS[v];
+                    c.tile_k = TUNE_TILE_K[k];
+                    tune_try(t, &c);
+                }
+            }
+        }
+    } else if (kind == GEMM_ROWS) {
+        const gemm_config_t base = t->best;
+        for (int r = 0; r < COUNT_OF(TUNE_ROWS_PER_ITEM); r++) {
+            c = base;
+            c.rows_per_item = TUNE_ROWS_PER_ITEM[r];
+            tune_try(t, &c);
+        }
+    }
+
+    // Stage 3: work-group size (same program, no rebuilds)
+    if (uses_local) {
+        const gemm_config_t base = t->best;
+        c = base;
+        c.local_x = c.local_y = 0;
+        tune_try(t, &c);
+        for (int x = 0; x < COUNT_OF(TUNE_LOCAL); x++) {
+            for (int y = 0; y < COUNT_OF(TUNE_LOCAL); y++) {
+                c = base;
+                c.local_x = TUNE_LOCAL[x];
+                c.local_y = TUNE_LOCAL[y];
+                tune_try(t, &c);
+            }
+        }
+    }
+
+    return t->best_ms < 0 ? 1 : 0;
+}
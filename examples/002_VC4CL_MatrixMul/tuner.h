@@ -0,0 +1,49 @@
+/**
+ * Autotuner for the kernel variants (--tune)
+ *
+ * Coordinate descent over a variant's configuration: compiler flags and
+ * vector width, then its tile or row blocking, then work-group sizes. Each
+ * candidate is timed on the whole problem and must reproduce the CPU
+ * reference; the fastest one's program is kept for the benchmark.
+ */
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "bench_common.h"
+#include "gemm_kernels.h"
+#include "tune_cache.h"
+
+typedef struct {
+    cl_context context;
+    cl_device_id device;
+    const tune_device_t* dev;
+    cl_command_queue queue;
+    const char* source;
+    size_t source_length;
+    const char* cache_dir;    // program binary cache; NULL = always compile
+    size_t max_work_group_size;
+    int iterations;           // timed runs per candidate
+    const gemm_variant_t* variant;
+    gemm_launch_t launch;     // whole problem, untiled
+    const reference_t* ref;
+    float* C_gpu;
+
+    gemm_config_t best;
+    cl_program best_program;
+    double best_ms;           // < 0 until a candidate validates
+    int tried;
+} tuner_t;
+
+// Coordinate descent from `start`: flags x VEC, then the variant's tile or
+// row blocking, then work-group sizes. Returns 0 if some candidate validated;
+// t->best_program is then the caller's to release.
+int tune_variant(tuner_t* t, const gemm_config_t* start);
+
+#endif // TUNER_H
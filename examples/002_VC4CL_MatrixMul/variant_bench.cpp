@@ -0,0 +1,216 @@
+/**
+ * Benchmark of one GEMM variant
+ */
+
+#include "variant_bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "half_float.h"
+
+static float* map_for_variant(cl_command_queue queue, cl_mem buf, cl_map_flags flags, size_t bytes,
+                              profile_log_t* log, const char* name, const char* variant, cl_int* err) {
+    cl_event event = NULL;
+    double start = get_time_ms();
+    float* p = map_matrix(queue, buf, flags, bytes, log ? &event : NULL, err);
+    if (!p || *err != CL_SUCCESS) return NULL;
+
+    if (log) {
+        char label[32];
+        snprintf(label, sizeof(label), "map %s", name);
+        profile_record(log, event, label, strcmp(variant, "") ? "read" : "write", variant, bytes,
+                       get_time_ms() - start);
+    }
+    return p;
+}
+
+float* map_for_host(cl_command_queue queue, cl_mem buf, cl_map_flags flags, size_t bytes,
+                    profile_log_t* log, const char* name, cl_int* err) {
+    return map_for_variant(queue, buf, flags, bytes, log, name, "", err);
+}
+
+cl_int upload(cl_command_queue queue, mem_mode_t mode, cl_mem buf, const void* host, size_t bytes,
+              profile_log_t* log, const char* name, double* host_ms) {
+    cl_event event = NULL;
+    cl_int err;
+    double start = get_time_ms();
+    if (mode == MEM_COPY) {
+        err = clEnqueueWriteBuffer(queue, buf, CL_TRUE, 0, bytes, host, 0, NULL, log ? &event : NULL);
+    } else {
+        err = clEnqueueUnmapMemObject(queue, buf, (void*)host, 0, NULL, log ? &event : NULL);
+        if (err == CL_SUCCESS) err = clFinish(queue);
+    }
+    *host_ms = get_time_ms() - start;
+    if (err != CL_SUCCESS) return err;
+
+    if (log) {
+        char label[32];
+        snprintf(label, sizeof(label), "%s %s", mode == MEM_COPY ? "write" : "unmap", name);
+        profile_record(log, event, label, "write", "", bytes, *host_ms);
+    }
+    return CL_SUCCESS;
+}
+
+// Device time spent moving one matrix: its write or read in copy mode, its
+// map and unmap in the zero-copy modes
+static double transfer_ms(const profile_log_t* log, const char* matrix, const char* variant) {
+    static const char* ops[] = { "write", "read", "map", "unmap" };
+    double ms = 0.0;
+    for (int i = 0; i < (int)(sizeof(ops) / sizeof(ops[0])); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s %s", ops[i], matrix);
+        const profile_event_t* e = profile_find(log, name, variant);
+        if (e) ms += profile_event_ms(e);
+    }
+    return ms;
+}
+
+// Fill in the --profile fields of `res` from the variant's events. Kernel
+// time is per multiply (summed over its `launches_per_run` tiles); the launch
+// overheads are per launch.
+static void summarize_profile(const profile_log_t* log, const gemm_variant_t* v, const gemm_shape_t* shape,
+                              int launches_per_run, variant_result_t* res) {
+    int launches = 0;
+    double kernel_ms = 0.0, enqueue_ms = 0.0, latency_ms = 0.0;
+    for (int i = 0; i < log->count; i++) {
+        const profile_event_t* e = &log->events[i];
+        if (strcmp(e->phase, "kernel") != 0 || strcmp(e->variant, v->name) != 0) continue;
+        launches++;
+        kernel_ms += profile_event_ms(e);
+        enqueue_ms += e->host_enqueue_ms;
+        latency_ms += (double)(e->start - e->queued) * 1e-6;
+    }
+    if (launches == 0) return;
+
+    const double flops = gemm_flops(shape);
+
+    res->profiled = 1;
+    res->kernel_ms = kernel_ms * launches_per_run / launches;
+    res->kernel_gflops = flops / (res->kernel_ms * 1e6);
+    res->enqueue_us = enqueue_ms / launches * 1e3;
+    res->latency_us = latency_ms / launches * 1e3;
+    const int half = v->kind == GEMM_HALF;
+    res->e2e_ms = res->kernel_ms + transfer_ms(log, half ? "A16" : "A", "") +
+                  transfer_ms(log, half ? "B16" : v->transposed_b ? "BT" : "B", "") + transfer_ms(log, "C", v->name);
+    res->e2e_gflops = flops / (res->e2e_ms * 1e6);
+}
+
+int run_variant(const variant_params_t* p, variant_result_t* res) {
+    const cl_command_queue queue = p->queue;
+    const gemm_variant_t* v = p->variant;
+    const gemm_shape_t* shape = &p->shape;
+    const gemm_launch_t* launches = p->launches;
+    const int num_launches = p->num_launches;
+    const gemm_tiling_t* tiling = p->tiling;
+    const int iterations = p->iterations;
+    float* C_gpu = p->C_gpu;
+    profile_log_t* log = p->log;
+    cl_int err;
+    const cl_mem buf_C = launches[0].c;
+    const size_t bytes = (size_t)shape->m * shape->n * sizeof(float);
+    const gemm_geometry_t g = variant_geometry(v, &res->config);
+    char config[256];
+    config_describe(v, &res->config, config, sizeof(config));
+
+    size_t global[2];
+    gemm_global_size(&g, shape, global);
+    printf("--- GPU Variant: %s (%s) ---\n", v->name, v->description);
+    printf("Config (%s): %s\n", res->config_source, config);
+    if (g.local_x > 0) {
+        printf("Work size: %zu x %zu global, %d x %d local\n", global[0], global[1], g.local_x, g.local_y);
+    } else {
+        printf("Work size: %zu x %zu global, driver-chosen local\n", global[0], global[1]);
+    }
+    if (num_launches > 1) {
+        printf("Tiled: %d launches of up to %d x %d per multiply\n",
+               num_launches, tiling->mb, tiling->nb);
+    }
+
+    double gpu_total = 0.0;
+    err = launch_timed(queue, p->kernel, &g, launches, num_launches, iterations, &gpu_total, log, v->name);
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Kernel execution failed (%s)\n", cl_error_string(err));
+        return 1;
+    }
+
+    res->avg_ms = gpu_total / iterations;
+    res->gflops = gemm_flops(shape) / (res->avg_ms * 1e6);
+
+    printf("GPU Total Time: %.2f ms (%d iterations)\n", gpu_total, iterations);
+    printf("GPU Avg Time: %.2f ms per matmul\n", res->avg_ms);
+    printf("GPU Performance: %.3f GFLOPS\n", res->gflops);
+
+    // Read back results, or map C in place in the zero-copy modes
+    const float* C_result = C_gpu;
+    if (tiling) {
+        // One read per panel; not profiled, so end-to-end covers uploads and kernels only
+        err = gemm_tiling_read_c(queue, tiling, C_gpu);
+    } else if (p->mode == MEM_COPY) {
+        cl_event read_event = NULL;
+        double read_start = get_time_ms();
+        err = clEnqueueReadBuffer(queue, buf_C, CL_TRUE, 0, bytes, C_gpu, 0, NULL, log ? &read_event : NULL);
+        if (err == CL_SUCCESS && log) {
+            profile_record(log, read_event, "read C", "read", v->name, bytes, get_time_ms() - read_start);
+        }
+    } else {
+        C_result = map_for_variant(queue, buf_C, CL_MAP_READ, bytes, log, "C", v->name, &err);
+    }
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Failed to read results (%s)\n", cl_error_string(err));
+        return 1;
+    }
+
+    compare_results(p->ref, C_result, res);
+    if (C_result != C_gpu) {
+        cl_event unmap_event = NULL;
+        double unmap_start = get_time_ms();
+        err = clEnqueueUnmapMemObject(queue, buf_C, (void*)C_result, 0, NULL, log ? &unmap_event : NULL);
+        clFinish(queue);
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to unmap C (%s)\n", cl_error_string(err));
+            return 1;
+        }
+        if (log) profile_record(log, unmap_event, "unmap C", "read", v->name, bytes, get_time_ms() - unmap_start);
+    }
+
+    if (log) {
+        summarize_profile(log, v, shape, num_launches, res);
+        printf("Kernel (events): %.3f ms avg, %.3f GFLOPS kernel-only\n", res->kernel_ms, res->kernel_gflops);
+        printf("End-to-end (upload + kernel + read): %.3f ms, %.3f GFLOPS\n", res->e2e_ms, res->e2e_gflops);
+        printf("Launch overhead: %.1f us in clEnqueueNDRangeKernel, %.1f us queued to start\n",
+               res->enqueue_us, res->latency_us);
+    }
+    printf("Max Error: %.6f (%d errors > 0.001)\n\n", res->max_error, res->error_count);
+    return 0;
+}
+
+void summarize_half(const variant_result_t* results, const reference_t* ref, double convert_ms) {
+    const variant_result_t* half = NULL;
+    const variant_result_t* fp32 = NULL;
+    for (int v = 0; v < GEMM_NUM_VARIANTS; v++) {
+        if (results[v].skipped) continue;
+        if (GEMM_VARIANTS[v].kind == GEMM_HALF) half = &results[v];
+        if (GEMM_VARIANTS[v].kind == GEMM_SIMPLE) fp32 = &results[v];
+    }
+    if (!half) return;
+
+    double c_max = 0.0;
+    for (size_t s = 0; s < ref->count; s++) {
+        double c = fabs((double)ref->c[ref->idx ? ref->idx[s] : s]);
+        if (c > c_max) c_max = c;
+    }
+    printf("\nHalf storage: %s conversion of A and B %.2f ms (once per matrix), max error %.6f = %.2e of max |C|\n",
+           half_float_describe(), convert_ms, half->max_error, c_max > 0.0 ? half->max_error / c_max : 0.0);
+    if (!fp32) {
+        printf("  Run 'simple' as well for the fp32 comparison\n");
+        return;
+    }
+    printf("  vs fp32 'simple': %.2fx GFLOPS (%.3f vs %.3f), max error %.6f vs %.6f\n",
+           half->gflops / fp32->gflops, half->gflops, fp32->gflops, half->max_error, fp32->max_error);
+    if (half->profiled && fp32->profiled) {
+        printf("  Kernel only: %.2fx, end-to-end: %.2fx\n", half->kernel_gflops / fp32->kernel_gflops,
+               half->e2e_gflops / fp32->e2e_gflops);
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * Benchmark of one GEMM variant
+ *
+ * Moves the operands to the device under a memory mode, times a variant's
+ * multiplies, reads C back and checks it against the CPU reference. With a
+ * profile log the result also gets kernel-only and end-to-end figures from
+ * the event timestamps.
+ */
+
+#ifndef VARIANT_BENCH_H
+#define VARIANT_BENCH_H
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+#include <stddef.h>
+
+#include "bench_common.h"
+#include "gemm_kernels.h"
+#include "host_buffers.h"
+#include "profile.h"
+#include "tiling.h"
+
+typedef struct {
+    cl_command_queue queue;
+    cl_kernel kernel;
+    const gemm_variant_t* variant;
+    gemm_shape_t shape;
+    const gemm_launch_t* launches;  // cover the whole M x N product
+    int num_launches;
+    const gemm_tiling_t* tiling;  // C is gathered from its panels; NULL = launches[0].c holds all of C
+    mem_mode_t mode;          // how C comes back when untiled
+    int iterations;
+    const reference_t* ref;
+    float* C_gpu;             // host C for copy mode and tiled runs
+    profile_log_t* log;       // NULL = host timers only
+} variant_params_t;
+
+// Blocking map for host access; with a profile log the map's event is
+// recorded as "map <name>"
+float* map_for_host(cl_command_queue queue, cl_mem buf, cl_map_flags flags, size_t bytes,
+                    profile_log_t* log, const char* name, cl_int* err);
+
+// Make a host matrix visible to the device: a blocking write in copy mode,
+// an unmap of the mapping `host` in the zero-copy modes. With a profile log
+// the event is recorded as "write <name>" or "unmap <name>".
+cl_int upload(cl_command_queue queue, mem_mode_t mode, cl_mem buf, const void* host, size_t bytes,
+              profile_log_t* log, const char* name, double* host_ms);
+
+// Time the variant, read back C and fill in `res`, whose config and
+// config_source must already be set. Returns nonzero on an OpenCL error.
+int run_variant(const variant_params_t* p, variant_result_t* res);
+
+// Half storage next to its fp32 twin 'simple'. Half rounding error grows
+// with K, so it is also given relative to the largest element of C.
+void summarize_half(const variant_result_t* results, const reference_t* ref, double convert_ms);
+
+#endif // VARIANT_BENCH_H
@@ -0,0 +1,352 @@
+/**
+ * gpu_pool.c - Pooled GPU Memory Allocator Implementation
+ *
+ * Size-class free lists over a few large regions from gpu_mem_alloc(),
+ * carved by a bump pointer.
+ *
+ * Target: Raspberry Pi 3B (BCM2837)
+ * Author: HPC_GPGPU Course
+ * License: MIT
+ */
+
+#include "gpu_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Initial capacity of a free list; doubled as it fills */
+#define FREE_LIST_INITIAL 64
+
+
+/* ============================================================================
+ * Internal Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief Round up to next multiple of alignment (a power of 2).
+ */
+static inline uint32_t align_up(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @brief Size class of a request: the smallest power of 2 block that holds it.
+ */
+static uint32_t class_of(uint32_t size) {
+    uint32_t c = 0;
+    uint32_t block = GPU_POOL_MIN_BLOCK;
+    while (block < size) {
+        block <<= 1;
+        c++;
+    }
+    return c;
+}
+
+static inline uint32_t class_size(uint32_t c) {
+    return (uint32_t)GPU_POOL_MIN_BLOCK << c;
+}
+
+static inline uint32_t class_align(uint32_t c) {
+    uint32_t size = class_size(c);
+    return size < GPU_POOL_MAX_ALIGN ? size : GPU_POOL_MAX_ALIGN;
+}
+
+/**
+ * @brief Reserve one more region: the only place the pool talks to the mailbox.
+ */
+static int add_region(gpu_pool_t *pool) {
+    if (pool->num_regions >= pool->max_regions) {
+        return -1;
+    }
+
+    gpu_mem_t *region = &pool->regions[pool->num_regions];
+    if (gpu_mem_alloc(pool->mbox, pool->region_size, GPU_POOL_MAX_ALIGN,
+                      pool->flags, region) < 0) {
+        return -1;
+    }
+
+    pool->num_regions++;
+    pool->stats.regions++;
+    pool->stats.reserved_bytes += region->size;
+    return 0;
+}
+
+/**
+ * @brief Index of the region a view points into, or -1.
+ */
+static int find_region(const gpu_pool_t *pool, const gpu_mem_t *view) {
+    for (uint32_t r = 0; r < pool->num_regions; r++) {
+        const gpu_mem_t *region = &pool->regions[r];
+        if (view->mem_handle == region->mem_handle &&
+            view->bus_addr >= region->bus_addr &&
+            view->bus_addr - region->bus_addr < region->size) {
+            return (int)r;
+        }
+    }
+    return -1;
+}
+
+static int free_list_push(gpu_pool_free_list_t *list, gpu_pool_block_t block) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : FREE_LIST_INITIAL;
+        gpu_pool_block_t *grown = (gpu_pool_block_t *)realloc(list->blocks,
+                                                              capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        list->blocks = grown;
+        list->capacity = capacity;
+    }
+    list->blocks[list->count++] = block;
+    return 0;
+}
+
+/**
+ * @brief Carve a block of class c from the current region, moving on to the
+ * next region (reserving it if needed) when it does not fit.
+ */
+static int bump_alloc(gpu_pool_t *pool, uint32_t c, gpu_pool_block_t *block) {
+    uint32_t size = class_size(c);
+    uint32_t offset = align_up(pool->bump, class_align(c));
+
+    if (offset + size > pool->region_size) {
+        if (pool->current + 1 >= pool->num_regions && add_region(pool) < 0) {
+            return -1;
+        }
+        pool->stats.tail_waste_bytes += pool->region_size - pool->bump;
+        pool->current++;
+        pool->bump = 0;
+        offset = 0;
+    }
+
+    pool->stats.carved_bytes += offset + size - pool->bump;
+    pool->bump = offset + size;
+    block->region = pool->current;
+    block->offset = offset;
+    return 0;
+}
+
+
+/* ============================================================================
+ * Pool Lifetime
+ * ============================================================================ */
+
+int gpu_pool_create(mbox_handle_t mbox, uint32_t region_size, uint32_t initial_regions,
+                    uint32_t max_regions, uint32_t flags, gpu_pool_t *pool) {
+    if (pool == NULL) {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+
+    if (region_size == 0) {
+        region_size = GPU_POOL_DEFAULT_REGION;
+    }
+    region_size = align_up(region_size, GPU_POOL_MAX_ALIGN);
+    if (region_size < GPU_POOL_MAX_BLOCK) {
+        region_size = GPU_POOL_MAX_BLOCK;
+    }
+    if (max_regions > GPU_POOL_MAX_REGIONS) {
+        max_regions = GPU_POOL_MAX_REGIONS;
+    }
+    if (initial_regions < 1 || initial_regions > max_regions) {
+        fprintf(stderr, "Error: Pool needs 1 to %u initial regions\n", max_regions);
+        return -1;
+    }
+
+    pool->mbox = mbox;
+    pool->region_size = region_size;
+    pool->max_regions = max_regions;
+    pool->flags = flags;
+
+    for (uint32_t r = 0; r < initial_regions; r++) {
+        if (add_region(pool) < 0) {
+            fprintf(stderr, "Error: Failed to reserve pool region %u of %u bytes\n", r, region_size);
+            gpu_pool_destroy(pool);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void gpu_pool_destroy(gpu_pool_t *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    for (uint32_t r = 0; r < pool->num_regions; r++) {
+        gpu_mem_free(&pool->regions[r]);
+    }
+    for (uint32_t c = 0; c < GPU_POOL_NUM_CLASSES; c++) {
+        free(pool->free_lists[c].blocks);
+    }
+    memset(pool, 0, sizeof(*pool));
+}
+
+void gpu_pool_reset(gpu_pool_t *pool) {
+    for (uint32_t c = 0; c < GPU_POOL_NUM_CLASSES; c++) {
+        pool->free_lists[c].count = 0;
+    }
+    pool->current = 0;
+    pool->bump = 0;
+
+    /* Nothing is carved or live any more; totals and high-water marks stay */
+    pool->stats.carved_bytes = 0;
+    pool->stats.tail_waste_bytes = 0;
+    pool->stats.live_bytes = 0;
+    pool->stats.requested_bytes = 0;
+    pool->stats.live_blocks = 0;
+    pool->stats.free_blocks = 0;
+    pool->stats.free_bytes = 0;
+}
+
+
+/* ============================================================================
+ * Allocation
+ * ============================================================================ */
+
+int gpu_pool_alloc(gpu_pool_t *pool, uint32_t size, gpu_mem_t *view) {
+    if (pool == NULL || view == NULL || size == 0) {
+        return -1;
+    }
+
+    pool->stats.allocs++;
+
+    /* Too big for a class: a dedicated allocation, as without the pool */
+    if (size > GPU_POOL_MAX_BLOCK) {
+        if (gpu_mem_alloc(pool->mbox, size, GPU_POOL_MAX_ALIGN, pool->flags, view) < 0) {
+            pool->stats.failures++;
+            return -1;
+        }
+        pool->stats.large_allocs++;
+        pool->stats.large_live++;
+        pool->stats.large_bytes += view->size;
+        return 0;
+    }
+
+    uint32_t c = class_of(size);
+    uint32_t block_size = class_size(c);
+    gpu_pool_free_list_t *list = &pool->free_lists[c];
+    gpu_pool_block_t block;
+
+    if (list->count > 0) {
+        block = list->blocks[--list->count];
+        pool->stats.free_list_hits++;
+        pool->stats.free_blocks--;
+        pool->stats.free_bytes -= block_size;
+    } else if (bump_alloc(pool, c, &block) == 0) {
+        pool->stats.bump_allocs++;
+    } else {
+        pool->stats.failures++;
+        return -1;
+    }
+
+    /* A view into the region: same handle, mapping and flags, offset addresses */
+    const gpu_mem_t *region = &pool->regions[block.region];
+    view->mbox = region->mbox;
+    view->mem_handle = region->mem_handle;
+    view->bus_addr = region->bus_addr + block.offset;
+    view->size = size;
+    view->virt_addr = (char *)region->virt_addr + block.offset;
+    view->flags = region->flags;
+
+    pool->stats.live_blocks++;
+    pool->stats.live_bytes += block_size;
+    pool->stats.requested_bytes += size;
+    if (pool->stats.live_bytes > pool->stats.high_water_bytes) {
+        pool->stats.high_water_bytes = pool->stats.live_bytes;
+    }
+    if (pool->stats.requested_bytes > pool->stats.high_water_requested) {
+        pool->stats.high_water_requested = pool->stats.requested_bytes;
+    }
+
+    return 0;
+}
+
+int gpu_pool_free(gpu_pool_t *pool, gpu_mem_t *view) {
+    if (pool == NULL || view == NULL || view->size == 0) {
+        return -1;
+    }
+
+    int r = find_region(pool, view);
+    if (r < 0) {
+        /* Not in any region: a dedicated allocation, or not ours at all */
+        if (view->size <= GPU_POOL_MAX_BLOCK) {
+            fprintf(stderr, "Error: Bus address 0x%08X is not from this pool\n", view->bus_addr);
+            return -1;
+        }
+        pool->stats.frees++;
+        pool->stats.large_live--;
+        pool->stats.large_bytes -= view->size;
+        return gpu_mem_free(view);
+    }
+
+    /* The view keeps the requested size, which gives back the class */
+    uint32_t c = class_of(view->size);
+    uint32_t block_size = class_size(c);
+
+    /* A stale view (from before gpu_pool_reset()) still points into a region;
+     * refuse it rather than push a block that may be live again */
+    if (pool->stats.live_blocks == 0 || pool->stats.live_bytes < block_size ||
+        pool->stats.requested_bytes < view->size) {
+        fprintf(stderr, "Error: Bus address 0x%08X is not a live pool block\n", view->bus_addr);
+        return -1;
+    }
+    gpu_pool_block_t block = { (uint32_t)r, view->bus_addr - pool->regions[r].bus_addr };
+    if (free_list_push(&pool->free_lists[c], block) < 0) {
+        fprintf(stderr, "Error: Out of host memory for the pool's free list\n");
+        return -1;
+    }
+
+    pool->stats.frees++;
+    pool->stats.free_blocks++;
+    pool->stats.free_bytes += block_size;
+    pool->stats.live_blocks--;
+    pool->stats.live_bytes -= block_size;
+    pool->stats.requested_bytes -= view->size;
+
+    memset(view, 0, sizeof(*view));
+    return 0;
+}
+
+
+/* ============================================================================
+ * Statistics
+ * ============================================================================ */
+
+void gpu_pool_get_stats(const gpu_pool_t *pool, gpu_pool_stats_t *stats) {
+    *stats = pool->stats;
+
+    stats->internal_fragmentation = stats->live_bytes > 0
+        ? 1.0 - (double)stats->requested_bytes / stats->live_bytes : 0.0;
+    stats->external_fragmentation = stats->carved_bytes > 0
+        ? (double)stats->free_bytes / stats->carved_bytes : 0.0;
+}
+
+void gpu_pool_print_stats(const gpu_pool_t *pool, const char *name) {
+    gpu_pool_stats_t s;
+    gpu_pool_get_stats(pool, &s);
+
+    char flags_str[256];
+    mem_flags_to_string(pool->flags, flags_str, sizeof(flags_str));
+
+    printf("GPU Pool [%s]:\n", name ? name : "unnamed");
+    printf("  Regions:      %u of %u x %u KB (%s)\n", s.regions, pool->max_regions,
+           pool->region_size / 1024, flags_str);
+    printf("  Carved:       %.1f KB (%.1f KB skipped at region ends)\n",
+           s.carved_bytes / 1024.0, s.tail_waste_bytes / 1024.0);
+    printf("  Live:         %u blocks, %.1f KB (%.1f KB requested)\n",
+           s.live_blocks, s.live_bytes / 1024.0, s.requested_bytes / 1024.0);
+    printf("  Free lists:   %u blocks, %.1f KB\n", s.free_blocks, s.free_bytes / 1024.0);
+    printf("  High water:   %.1f KB (%.1f KB requested)\n",
+           s.high_water_bytes / 1024.0, s.high_water_requested / 1024.0);
+    printf("  Allocations:  %llu (%llu free list, %llu bump, %llu large, %llu failed)\n",
+           (unsigned long long)s.allocs, (unsigned long long)s.free_list_hits,
+           (unsigned long long)s.bump_allocs, (unsigned long long)s.large_allocs,
+           (unsigned long long)s.failures);
+    printf("  Frees:        %llu (%u large still live)\n", (unsigned long long)s.frees, s.large_live);
+    printf("  Fragmentation: internal %.1f%%, external %.1f%%\n",
+           100.0 * s.internal_fragmentation, 100.0 * s.external_fragmentation);
+}
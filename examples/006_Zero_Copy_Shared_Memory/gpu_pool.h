@@ -0,0 +1,285 @@
+/**
+ * gpu_pool.h - Pooled GPU Memory Allocator for Raspberry Pi VideoCore IV
+ *
+ * Every gpu_mem_alloc() costs three mailbox ioctls (allocate, lock, and
+ * unlock/free on release), an open() of /dev/mem, an mmap() and a close().
+ * A pipeline that allocates hundreds of small GPU buffers per second spends
+ * most of its time in the kernel. This pool pays that cost a few times up
+ * front and sub-allocates from the result.
+ *
+ * Key Concepts:
+ * =============
+ *
+ * 1. REGIONS
+ *    The pool reserves a few large regions with gpu_mem_alloc(). Each one is
+ *    allocated, locked and mapped once, and stays locked for the life of the
+ *    pool, so its bus address never changes.
+ *
+ * 2. SIZE CLASSES
+ *    Requests are rounded up to a power of two from GPU_POOL_MIN_BLOCK to
+ *    GPU_POOL_MAX_BLOCK bytes. A freed block goes onto the free list of its
+ *    class, and the next request of that class takes it back.
+ *
+ *    | Class | Block size | Alignment           |
+ *    |-------|------------|---------------------|
+ *    | 0     | 64 B       | 64 B                |
+ *    | 1     | 128 B      | 128 B               |
+ *    | ...   | ...        | block size          |
+ *    | 6+    | 4 KB+      | 4 KB (page)         |
+ *
+ * 3. POINTER BUMP
+ *    A request whose free list is empty is carved from the current region
+ *    by advancing an offset. No mailbox call, no mmap: an allocation is an
+ *    array pop or an add. A new region is reserved only when the current
+ *    one is full.
+ *
+ * 4. VIEWS
+ *    An allocation is returned as a gpu_mem_t that points into its region.
+ *    Its bus_addr and virt_addr are the region's plus the block's offset;
+ *    mem_handle is the region's handle. It can be used anywhere a gpu_mem_t
+ *    from gpu_mem_alloc() is read, but must be released with
+ *    gpu_pool_free(), never gpu_mem_free(), which would release the whole
+ *    region.
+ *
+ * Requests larger than GPU_POOL_MAX_BLOCK fall back to a dedicated
+ * gpu_mem_alloc(), which gpu_pool_free() also releases.
+ *
+ * The pool keeps its bookkeeping in ordinary host memory, never in the
+ * (typically uncached) GPU memory. It is not thread-safe.
+ *
+ * Target: Raspberry Pi 3B (BCM2837, VideoCore IV)
+ * Author: HPC_GPGPU Course
+ * License: MIT
+ */
+
+#ifndef GPU_POOL_H
+#define GPU_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mailbox.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/** Smallest block handed out (bytes); smaller requests are rounded up */
+#define GPU_POOL_MIN_BLOCK      64
+
+/** Largest pooled block (bytes); larger requests get their own allocation */
+#define GPU_POOL_MAX_BLOCK      (1024 * 1024)
+
+/** Number of size classes: 64 B, 128 B, ... 1 MB */
+#define GPU_POOL_NUM_CLASSES    15
+
+/** Blocks are aligned to their size, but at most to a page */
+#define GPU_POOL_MAX_ALIGN      4096
+
+/** Upper bound on regions per pool */
+#define GPU_POOL_MAX_REGIONS    16
+
+/** Default region size when gpu_pool_create() is given 0 */
+#define GPU_POOL_DEFAULT_REGION (16 * 1024 * 1024)
+
+
+/* ============================================================================
+ * Pool Structures
+ * ============================================================================ */
+
+/**
+ * A free block: which region, and where in it.
+ */
+typedef struct {
+    uint32_t region;
+    uint32_t offset;
+} gpu_pool_block_t;
+
+/**
+ * Free list of one size class (a stack of blocks).
+ */
+typedef struct {
+    gpu_pool_block_t *blocks;
+    uint32_t count;
+    uint32_t capacity;
+} gpu_pool_free_list_t;
+
+/**
+ * Usage and fragmentation counters.
+ *
+ * Byte counts are "now" unless marked as high-water marks. The
+ * fragmentation ratios are derived by gpu_pool_get_stats().
+ */
+typedef struct {
+    /** Regions reserved, and their total size */
+    uint32_t regions;
+    uint64_t reserved_bytes;
+
+    /** Bytes carved off regions so far, alignment gaps included */
+    uint64_t carved_bytes;
+
+    /** Region space skipped when a block did not fit in the current one */
+    uint64_t tail_waste_bytes;
+
+    /** Live pooled blocks: their block sizes, and the sizes requested */
+    uint64_t live_bytes;
+    uint64_t requested_bytes;
+    uint32_t live_blocks;
+
+    /** Blocks on the free lists, and their bytes */
+    uint32_t free_blocks;
+    uint64_t free_bytes;
+
+    /** High-water marks of live_bytes and requested_bytes */
+    uint64_t high_water_bytes;
+    uint64_t high_water_requested;
+
+    /** Calls, and how each allocation was satisfied */
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t free_list_hits;
+    uint64_t bump_allocs;
+    uint64_t large_allocs;
+    uint64_t failures;
+
+    /** Dedicated allocations above GPU_POOL_MAX_BLOCK still live */
+    uint32_t large_live;
+    uint64_t large_bytes;
+
+    /** 1 - requested / live: space lost to size-class rounding */
+    double internal_fragmentation;
+
+    /** free / carved: carved space idle on the free lists */
+    double external_fragmentation;
+} gpu_pool_stats_t;
+
+/**
+ * A pool of GPU memory. Treat the fields as private.
+ */
+typedef struct {
+    mbox_handle_t mbox;
+    uint32_t region_size;
+    uint32_t max_regions;
+    uint32_t flags;
+
+    gpu_mem_t regions[GPU_POOL_MAX_REGIONS];
+    uint32_t num_regions;
+
+    /** Region being carved, and the bump offset into it */
+    uint32_t current;
+    uint32_t bump;
+
+    gpu_pool_free_list_t free_lists[GPU_POOL_NUM_CLASSES];
+    gpu_pool_stats_t stats;
+} gpu_pool_t;
+
+
+/* ============================================================================
+ * Pool Lifetime
+ * ============================================================================ */
+
+/**
+ * @brief Create a pool and reserve its first regions.
+ *
+ * @param mbox            Mailbox handle.
+ * @param region_size     Bytes per region, rounded up to a page; 0 for
+ *                        GPU_POOL_DEFAULT_REGION. At least GPU_POOL_MAX_BLOCK.
+ * @param initial_regions Regions reserved now (at least 1).
+ * @param max_regions     Regions the pool may grow to (at most
+ *                        GPU_POOL_MAX_REGIONS).
+ * @param flags           Allocation flags for every region (MEM_FLAG_*).
+ * @param[out] pool       Pool to initialize.
+ * @return 0 on success, -1 on failure (nothing is left allocated).
+ */
+int gpu_pool_create(mbox_handle_t mbox, uint32_t region_size, uint32_t initial_regions,
+                    uint32_t max_regions, uint32_t flags, gpu_pool_t *pool);
+
+/**
+ * @brief Release every region and the pool's bookkeeping.
+ *
+ * Views still handed out become invalid. Large allocations that were not
+ * freed are not tracked by the pool and are not released.
+ *
+ * @param pool Pool from gpu_pool_create().
+ */
+void gpu_pool_destroy(gpu_pool_t *pool);
+
+/**
+ * @brief Drop every pooled allocation at once.
+ *
+ * Rewinds the bump offset to the start of the first region and empties the
+ * free lists. The regions stay reserved and are carved again in order.
+ * Suited to per-frame scratch memory. Outstanding views must no longer be
+ * used.
+ *
+ * @param pool Pool from gpu_pool_create().
+ */
+void gpu_pool_reset(gpu_pool_t *pool);
+
+
+/* ============================================================================
+ * Allocation
+ * ============================================================================ */
+
+/**
+ * @brief Allocate GPU memory from the pool.
+ *
+ * Takes a block of the request's size class from its free list, or carves
+ * one from the current region. Reserves a new region only when the current
+ * one is full.
+ *
+ * @param pool      Pool from gpu_pool_create().
+ * @param size      Requested size in bytes (> 0).
+ * @param[out] view Filled like gpu_mem_alloc() would: bus_addr, virt_addr,
+ *                  size, flags, mbox and mem_handle. A pooled view carries
+ *                  the requested size and its region's mem_handle; a large
+ *                  one is a dedicated allocation with gpu_mem_alloc()'s
+ *                  page-rounded size.
+ * @return 0 on success, -1 if the pool is exhausted or the request fails.
+ *
+ * @note Memory from the free lists is not cleared, even with MEM_FLAG_ZERO.
+ */
+int gpu_pool_alloc(gpu_pool_t *pool, uint32_t size, gpu_mem_t *view);
+
+/**
+ * @brief Return an allocation to the pool.
+ *
+ * @param pool Pool the view came from.
+ * @param view View from gpu_pool_alloc(); cleared on success.
+ * @return 0 on success, -1 if the view does not belong to the pool or the
+ *         pool has no live block for it (e.g. a view from before
+ *         gpu_pool_reset(), or freed twice).
+ */
+int gpu_pool_free(gpu_pool_t *pool, gpu_mem_t *view);
+
+
+/* ============================================================================
+ * Statistics
+ * ============================================================================ */
+
+/**
+ * @brief Copy the counters and compute the fragmentation ratios.
+ *
+ * @param pool       Pool from gpu_pool_create().
+ * @param[out] stats Counters.
+ */
+void gpu_pool_get_stats(const gpu_pool_t *pool, gpu_pool_stats_t *stats);
+
+/**
+ * @brief Print the counters in human-readable form.
+ *
+ * @param pool Pool from gpu_pool_create().
+ * @param name Optional name/label for the pool.
+ */
+void gpu_pool_print_stats(const gpu_pool_t *pool, const char *name);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GPU_POOL_H */
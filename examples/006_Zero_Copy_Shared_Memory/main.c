@@ -42,6 +42,7 @@
 #include <errno.h>
 
 #include "mailbox.h"
+#include "gpu_pool.h"
 
 /* ============================================================================
  * Configuration
@@ -62,6 +63,12 @@
 /** Pattern for verification */
 #define FILL_PATTERN        0xDEADBEEF
 
+/** Allocator benchmark: live buffers per round, their size range, rounds */
+#define ALLOC_BUFFERS       256
+#define ALLOC_MIN_SIZE      1024
+#define ALLOC_MAX_SIZE      (64 * 1024)
+#define ALLOC_ROUNDS        4
+
 
 /* ============================================================================
  * Timing Utilities
@@ -410,6 +417,176 @@ static int benchmark_baseline_cached(size_t data_size, int iterations,
 }
 
 
+/**
+ * @brief Benchmark 4: Allocator - gpu_mem_alloc() vs gpu_pool_alloc()
+ * 
+ * Allocates ALLOC_BUFFERS small buffers of mixed sizes and frees them again,
+ * ALLOC_ROUNDS times, once through the mailbox and once through a pool.
+ * The pool's first round carves its regions; later rounds reuse the free
+ * lists. Every pooled view is checked: its bus and virtual offsets into the
+ * region must agree, and sorted by region and bus address, each view must
+ * end at or before the next one starts.
+ */
+typedef struct {
+    double mailbox_us;          /* Per alloc + free through the mailbox */
+    double pool_us;             /* Per alloc + free through the pool */
+    double pool_first_us;       /* Same, first (carving) round only */
+    gpu_pool_stats_t stats;     /* Pool counters after the last round */
+    int verified;               /* Views consistent and disjoint */
+} bench_result_alloc_t;
+
+static uint32_t alloc_size(int i) {
+    /* Fixed pseudo-random sizes, the same for both allocators */
+    uint32_t h = (uint32_t)i * 2654435761u;
+    return ALLOC_MIN_SIZE + (h >> 8) % (ALLOC_MAX_SIZE - ALLOC_MIN_SIZE + 1);
+}
+
+/* Orders views by region handle, then by bus address */
+static int compare_views(const void *a, const void *b) {
+    const gpu_mem_t *x = (const gpu_mem_t *)a;
+    const gpu_mem_t *y = (const gpu_mem_t *)b;
+    if (x->mem_handle != y->mem_handle) {
+        return x->mem_handle < y->mem_handle ? -1 : 1;
+    }
+    if (x->bus_addr != y->bus_addr) {
+        return x->bus_addr < y->bus_addr ? -1 : 1;
+    }
+    return 0;
+}
+
+static int verify_pool_views(const gpu_pool_t *pool, const gpu_mem_t *views, int count) {
+    int errors = 0;
+    
+    for (int i = 0; i < count; i++) {
+        const gpu_mem_t *v = &views[i];
+        int found = 0;
+        for (uint32_t r = 0; r < pool->num_regions; r++) {
+            const gpu_mem_t *region = &pool->regions[r];
+            if (v->mem_handle != region->mem_handle) {
+                continue;
+            }
+            uint32_t bus_offset = v->bus_addr - region->bus_addr;
+            size_t virt_offset = (size_t)((char *)v->virt_addr - (char *)region->virt_addr);
+            found = bus_offset == virt_offset && bus_offset + v->size <= region->size;
+        }
+        if (!found && errors++ < 10) {
+            fprintf(stderr, "[Pool] View %d (bus 0x%08X) is not inside its region\n",
+                    i, v->bus_addr);
+        }
+    }
+    
+    /* Sorted by region and address, each view must end before the next starts */
+    gpu_mem_t *sorted = (gpu_mem_t *)malloc(count * sizeof(gpu_mem_t));
+    if (!sorted) {
+        fprintf(stderr, "[Pool] Out of memory for the overlap check\n");
+        return 0;
+    }
+    memcpy(sorted, views, count * sizeof(gpu_mem_t));
+    qsort(sorted, count, sizeof(gpu_mem_t), compare_views);
+    
+    for (int i = 1; i < count; i++) {
+        const gpu_mem_t *prev = &sorted[i - 1];
+        const gpu_mem_t *next = &sorted[i];
+        if (prev->mem_handle == next->mem_handle &&
+            (uint64_t)prev->bus_addr + prev->size > next->bus_addr && errors++ < 10) {
+            fprintf(stderr, "[Pool] View at bus 0x%08X (%u bytes) overlaps the one at 0x%08X\n",
+                    prev->bus_addr, prev->size, next->bus_addr);
+        }
+    }
+    
+    free(sorted);
+    return errors == 0;
+}
+
+static int benchmark_allocator(mbox_handle_t mbox, bench_result_alloc_t *result) {
+    printf("\n  Running Allocator benchmark...\n");
+    printf("    %d buffers of %d-%d KB, %d rounds\n", ALLOC_BUFFERS,
+           ALLOC_MIN_SIZE / 1024, ALLOC_MAX_SIZE / 1024, ALLOC_ROUNDS);
+    
+    gpu_mem_t *views = (gpu_mem_t *)calloc(ALLOC_BUFFERS, sizeof(gpu_mem_t));
+    if (!views) {
+        fprintf(stderr, "  Error: Failed to allocate views\n");
+        return -1;
+    }
+    
+    /* Mailbox: every buffer is allocated, locked, mapped and released */
+    uint64_t t0 = get_time_ns();
+    for (int round = 0; round < ALLOC_ROUNDS; round++) {
+        for (int i = 0; i < ALLOC_BUFFERS; i++) {
+            if (gpu_mem_alloc(mbox, alloc_size(i), GPU_ALIGNMENT,
+                              MEM_FLAG_DIRECT, &views[i]) < 0) {
+                fprintf(stderr, "  Error: Failed to allocate GPU buffer %d\n", i);
+                for (int j = 0; j < i; j++) {
+                    gpu_mem_free(&views[j]);
+                }
+                free(views);
+                return -1;
+            }
+        }
+        for (int i = 0; i < ALLOC_BUFFERS; i++) {
+            gpu_mem_free(&views[i]);
+        }
+    }
+    uint64_t t1 = get_time_ns();
+    result->mailbox_us = (t1 - t0) / 1e3 / (ALLOC_ROUNDS * ALLOC_BUFFERS);
+    
+    /* Pool: the regions are reserved once, outside the timed loop */
+    gpu_pool_t pool;
+    if (gpu_pool_create(mbox, 0, 1, 4, MEM_FLAG_DIRECT, &pool) < 0) {
+        fprintf(stderr, "  Error: Failed to create GPU pool\n");
+        free(views);
+        return -1;
+    }
+    
+    result->verified = 1;
+    double total_us = 0.0;
+    
+    for (int round = 0; round < ALLOC_ROUNDS; round++) {
+        /* The whole alloc loop is one timed block, as for the mailbox */
+        int failed = -1;
+        t0 = get_time_ns();
+        for (int i = 0; i < ALLOC_BUFFERS && failed < 0; i++) {
+            if (gpu_pool_alloc(&pool, alloc_size(i), &views[i]) < 0) {
+                failed = i;
+            }
+        }
+        t1 = get_time_ns();
+        if (failed >= 0) {
+            fprintf(stderr, "  Error: Pool allocation %d failed\n", failed);
+            gpu_pool_destroy(&pool);
+            free(views);
+            return -1;
+        }
+        double round_us = (t1 - t0) / 1e3;
+        
+        /* Verify outside the timed region */
+        result->verified &= verify_pool_views(&pool, views, ALLOC_BUFFERS);
+        
+        /* Free in a different order than allocated, to shuffle the free lists */
+        t0 = get_time_ns();
+        for (int i = ALLOC_BUFFERS - 1; i >= 0; i--) {
+            gpu_pool_free(&pool, &views[(i * 7) % ALLOC_BUFFERS]);
+        }
+        t1 = get_time_ns();
+        round_us += (t1 - t0) / 1e3;
+        
+        if (round == 0) {
+            result->pool_first_us = round_us / ALLOC_BUFFERS;
+        }
+        total_us += round_us;
+    }
+    result->pool_us = total_us / (ALLOC_ROUNDS * ALLOC_BUFFERS);
+    
+    gpu_pool_get_stats(&pool, &result->stats);
+    printf("\n");
+    gpu_pool_print_stats(&pool, "allocator benchmark");
+    
+    gpu_pool_destroy(&pool);
+    free(views);
+    return 0;
+}
+
+
 /* ============================================================================
  * Print Utilities
  * ============================================================================ */
@@ -502,6 +679,7 @@ int main(int argc, char *argv[]) {
     bench_result_baseline_t baseline_result = {0};
     bench_result_standard_t standard_result = {0};
     bench_result_zerocopy_t zerocopy_result = {0};
+    bench_result_alloc_t alloc_result = {0};
     
     int baseline_ok = benchmark_baseline_cached(data_size, NUM_ITERATIONS, 
                                                  &baseline_result);
@@ -511,6 +689,7 @@ int main(int argc, char *argv[]) {
     int zerocopy_ok = benchmark_zero_copy(mbox, data_size, 
                                            NUM_WARMUP, NUM_ITERATIONS, 
                                            &zerocopy_result);
+    int alloc_ok = benchmark_allocator(mbox, &alloc_result);
     
     /* Print Results */
     printf("\n══════════════════════════════════════════════════════════════════════════\n");
@@ -545,6 +724,25 @@ int main(int argc, char *argv[]) {
     
     printf("  └────────────────────────────┴─────────────┴─────────────┴──────────┘\n");
     
+    if (alloc_ok == 0) {
+        printf("\n");
+        printf("  ┌────────────────────────────┬─────────────┬──────────┐\n");
+        printf("  │ Allocator (alloc + free)   │ Time (us)   │ Status   │\n");
+        printf("  ├────────────────────────────┼─────────────┼──────────┤\n");
+        printf("  │ Mailbox: gpu_mem_alloc     │ %9.2f   │  REF     │\n",
+               alloc_result.mailbox_us);
+        printf("  │ Pool: first round (carve)  │ %9.2f   │          │\n",
+               alloc_result.pool_first_us);
+        printf("  │ Pool: all rounds           │ %9.2f   │ [%s]  │\n",
+               alloc_result.pool_us, alloc_result.verified ? "PASS" : "FAIL");
+        printf("  └────────────────────────────┴─────────────┴──────────┘\n");
+        printf("  Pool is %.0fx faster; high water %.1f KB, %.1f%% lost to size classes\n",
+               alloc_result.mailbox_us / alloc_result.pool_us,
+               alloc_result.stats.high_water_bytes / 1024.0,
+               100.0 * (1.0 - (double)alloc_result.stats.high_water_requested /
+                        alloc_result.stats.high_water_bytes));
+    }
+    
     /* Analysis */
     if (standard_ok == 0 && zerocopy_ok == 0) {
         printf("\n");